@@ -0,0 +1,39 @@
+#include "benchmark/benchmark.h"
+#include "audiohandlers/ChannelMatrix.hpp"
+
+#include <cmath>
+#include <vector>
+
+// maps a block of `frames` frames from in to out channels
+template <typename SAMPLE>
+static void BM_ChannelMatrix(benchmark::State& state) {
+  int in = static_cast<int>(state.range(0));
+  int out = static_cast<int>(state.range(1));
+  uint32_t frames = 512;
+
+  ChannelMatrix matrix(in, out);
+  std::vector<SAMPLE> input(frames * in);
+  for (size_t i = 0; i < input.size(); i++) {
+    input[i] = kernels::ConvertSample<float, SAMPLE>(static_cast<float>(sin(i * 0.01)) * 0.5f);
+  }
+
+  std::vector<float> output(frames * out);
+  for (auto _ : state) {
+    matrix.Apply(input.data(), output.data(), frames);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * frames);
+}
+
+BENCHMARK_TEMPLATE(BM_ChannelMatrix, float)
+  ->ArgNames({ "in", "out" })
+  ->Args({ 1, 2 })
+  ->Args({ 2, 2 })
+  ->Args({ 2, 1 })
+  ->Args({ 6, 2 })
+  ->Args({ 8, 2 })
+  ->Args({ 2, 6 });
+BENCHMARK_TEMPLATE(BM_ChannelMatrix, int16_t)->ArgNames({ "in", "out" })->Args({ 2, 2 })->Args({ 6, 2 });
+
+BENCHMARK_MAIN();
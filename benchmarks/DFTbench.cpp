@@ -0,0 +1,50 @@
+#include "benchmark/benchmark.h"
+#include "audiohandlers/DFT.hpp"
+
+#include <cmath>
+#include <vector>
+
+static std::vector<float> MakeSignal(uint32_t len) {
+  std::vector<float> signal(len);
+  for (uint32_t i = 0; i < len; i++) {
+    signal[i] = static_cast<float>(sin(i * 0.05) + 0.5 * sin(i * 0.31));
+  }
+
+  return signal;
+}
+
+static void BM_CalculateDFT(benchmark::State& state) {
+  uint32_t len = static_cast<uint32_t>(state.range(0));
+  std::vector<float> signal = MakeSignal(len);
+  std::vector<float> real(len);
+  std::vector<float> imag(len);
+
+  for (auto _ : state) {
+    dft::CalculateDFT(signal.data(), real.data(), imag.data(), len);
+    benchmark::DoNotOptimize(real.data());
+    benchmark::DoNotOptimize(imag.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * len);
+}
+
+static void BM_GetAmplitudeArray(benchmark::State& state) {
+  uint32_t len = static_cast<uint32_t>(state.range(0));
+  std::vector<float> signal = MakeSignal(len);
+  std::vector<float> real(len);
+  std::vector<float> imag(len);
+  std::vector<float> amplitude(len);
+  dft::CalculateDFT(signal.data(), real.data(), imag.data(), len);
+
+  for (auto _ : state) {
+    dft::GetAmplitudeArray(real.data(), imag.data(), amplitude.data(), len, true);
+    benchmark::DoNotOptimize(amplitude.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * len);
+}
+
+BENCHMARK(BM_CalculateDFT)->RangeMultiplier(2)->Range(256, 65536);
+BENCHMARK(BM_GetAmplitudeArray)->RangeMultiplier(4)->Range(256, 65536);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+# perf regression check, run by ctest as
+#   cmake -DBENCH_EXE=<benchmark binary> -DBASELINE=<json> -P PerfCheck.cmake
+# registered only when configured with -DPERF_GATE=ON and an optimised CMAKE_BUILD_TYPE
+#
+# runs every benchmark listed under the binary's name in the baseline file,
+# and fails if the median of `metric` falls more than `tolerance` percent below `value`.
+# metrics are rates (items/bytes per second), so higher is better.
+#
+# set PERF_UPDATE_BASELINE in the environment to write the measured medians back
+# into the baseline instead of comparing -- baselines are per-machine, so do this
+# once on whatever box is doing the gating.
+
+cmake_minimum_required(VERSION 3.19)
+
+get_filename_component(bench_name ${BENCH_EXE} NAME_WE)
+file(READ ${BASELINE} baseline)
+
+string(JSON case_count ERROR_VARIABLE err LENGTH "${baseline}" ${bench_name})
+if(err)
+  message(STATUS "${bench_name}: no baseline cases")
+  return()
+endif()
+
+# collect the cases, and build a filter which only runs those
+# cmake math is integer only -- truncates a json number (possibly in exponent form) to an integer
+function(to_integer out number)
+  if(NOT number MATCHES "^([0-9]+)(\\.([0-9]*))?([eE]([+-]?[0-9]+))?$")
+    message(FATAL_ERROR "cannot compare '${number}'")
+  endif()
+
+  set(digits "${CMAKE_MATCH_1}${CMAKE_MATCH_3}")
+  string(LENGTH "${CMAKE_MATCH_3}" frac_len)
+  set(exponent 0)
+  if(CMAKE_MATCH_5)
+    math(EXPR exponent "${CMAKE_MATCH_5}")
+  endif()
+
+  math(EXPR shift "${exponent} - ${frac_len}")
+  if(shift GREATER_EQUAL 0)
+    string(REPEAT "0" ${shift} zeros)
+    set(digits "${digits}${zeros}")
+  else()
+    string(LENGTH "${digits}" len)
+    math(EXPR len "${len} + ${shift}")
+    if(len LESS_EQUAL 0)
+      set(digits 0)
+    else()
+      string(SUBSTRING "${digits}" 0 ${len} digits)
+    endif()
+  endif()
+
+  math(EXPR digits "${digits}")
+  set(${out} ${digits} PARENT_SCOPE)
+endfunction()
+
+set(names )
+set(filter )
+math(EXPR last "${case_count} - 1")
+foreach(i RANGE ${last})
+  string(JSON name MEMBER "${baseline}" ${bench_name} ${i})
+  list(APPEND names "${name}")
+  if(filter)
+    set(filter "${filter}|${name}")
+  else()
+    set(filter "${name}")
+  endif()
+endforeach()
+
+set(out_file ${CMAKE_CURRENT_BINARY_DIR}/${bench_name}_perfcheck.json)
+execute_process(COMMAND ${BENCH_EXE}
+                        "--benchmark_filter=^(${filter})$"
+                        --benchmark_repetitions=5
+                        --benchmark_report_aggregates_only=true
+                        --benchmark_out=${out_file}
+                        --benchmark_out_format=json
+                RESULT_VARIABLE result
+                OUTPUT_QUIET
+                ERROR_VARIABLE bench_err)
+if(result)
+  message(FATAL_ERROR "${bench_name} exited with ${result}\n${bench_err}")
+endif()
+
+file(READ ${out_file} measured)
+string(JSON run_count LENGTH "${measured}" benchmarks)
+math(EXPR last_run "${run_count} - 1")
+
+foreach(name IN LISTS names)
+  string(JSON metric GET "${baseline}" ${bench_name} ${name} metric)
+  string(JSON expected GET "${baseline}" ${bench_name} ${name} value)
+  string(JSON tolerance GET "${baseline}" ${bench_name} ${name} tolerance)
+
+  set(value )
+  foreach(i RANGE ${last_run})
+    string(JSON run_name GET "${measured}" benchmarks ${i} run_name)
+    string(JSON aggregate ERROR_VARIABLE err GET "${measured}" benchmarks ${i} aggregate_name)
+    if(run_name STREQUAL name AND aggregate STREQUAL "median")
+      string(JSON value GET "${measured}" benchmarks ${i} ${metric})
+    endif()
+  endforeach()
+
+  if(NOT value)
+    message(SEND_ERROR "${name}: no result")
+    continue()
+  endif()
+
+  if(DEFINED ENV{PERF_UPDATE_BASELINE})
+    string(JSON baseline SET "${baseline}" ${bench_name} ${name} value ${value})
+    message(STATUS "${name}: baseline set to ${value}")
+    continue()
+  endif()
+
+  to_integer(value_int ${value})
+  to_integer(expected_int ${expected})
+  math(EXPR percent "100 * ${value_int} / ${expected_int}")
+  math(EXPR floor "100 - ${tolerance}")
+  if(percent LESS floor)
+    message(SEND_ERROR "${name}: ${metric} ${value} is ${percent}% of baseline ${expected} (floor ${floor}%)")
+  else()
+    message(STATUS "${name}: ${metric} ${value} is ${percent}% of baseline ${expected}")
+  endif()
+endforeach()
+
+if(DEFINED ENV{PERF_UPDATE_BASELINE})
+  file(WRITE ${BASELINE} "${baseline}\n")
+endif()
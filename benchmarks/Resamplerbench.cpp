@@ -0,0 +1,48 @@
+#include "benchmark/benchmark.h"
+#include "audiohandlers/Resampler.hpp"
+
+#include <cmath>
+#include <vector>
+
+// converts a second of stereo per iteration, in 1024 frame blocks
+// realtime_factor is (seconds of audio) / (seconds spent)
+static void BM_Resample(benchmark::State& state) {
+  int in_rate = static_cast<int>(state.range(0));
+  int out_rate = static_cast<int>(state.range(1));
+  uint32_t taps = static_cast<uint32_t>(state.range(2));
+  const uint32_t block = 1024;
+
+  Resampler resampler(in_rate, out_rate, 2, taps, block);
+  std::vector<float> input(static_cast<size_t>(in_rate) * 2);
+  for (size_t i = 0; i < input.size(); i++) {
+    input[i] = static_cast<float>(sin(i * 0.01));
+  }
+
+  std::vector<float> output(resampler.GetMaxOutput(block) * 2);
+  int64_t frames = 0;
+  for (auto _ : state) {
+    for (uint32_t i = 0; i + block <= static_cast<uint32_t>(in_rate); i += block) {
+      resampler.Process(input.data() + 2 * i, block, output.data());
+      frames += block;
+    }
+
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetItemsProcessed(frames);
+  state.counters["realtime_factor"] =
+    benchmark::Counter(static_cast<double>(frames) / in_rate, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_Resample)
+  ->ArgNames({ "in", "out", "taps" })
+  ->Args({ 44100, 48000, 64 })
+  ->Args({ 48000, 44100, 64 })
+  ->Args({ 96000, 44100, 64 })
+  ->Args({ 44100, 96000, 64 })
+  ->Args({ 44100, 44101, 64 })
+  ->Args({ 44100, 48000, 32 })
+  ->Args({ 44100, 48000, 128 })
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,112 @@
+#include "benchmark/benchmark.h"
+#include "audiohandlers/AudioBufferSPSC.hpp"
+#include "audiohandlers/RingStorage.hpp"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// streams the whole ring through in 4096 frame blocks
+// arg: ring size, as a power of two (in stereo frames)
+template <typename POLICY>
+static void BM_LargeRingCopy(benchmark::State& state) {
+  const int channels = 2;
+  const uint32_t block = 4096 * channels;
+  AudioBufferSPSC<float, float, POLICY> buf(static_cast<int>(state.range(0)), channels);
+  std::vector<float> input(block, 0.5f);
+  std::vector<float> output(block);
+  uint32_t blocks = buf.Capacity() / block;
+
+  for (auto _ : state) {
+    for (uint32_t i = 0; i < blocks; i++) {
+      buf.Write(input.data(), block);
+      buf.ReadToBuffer(block, output.data(), channels);
+    }
+
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * blocks * block * sizeof(float) * 2);
+}
+
+// short views scattered across a full ring, as analysis passes looking back through history would --
+// every view touches a different page, so this is where TLB reach shows
+template <typename POLICY>
+static void BM_ScatteredViews(benchmark::State& state) {
+  const int channels = 2;
+  const uint32_t view_frames = 256;
+  int power = static_cast<int>(state.range(0));
+  AudioBufferSPSC<float, float, POLICY> buf(power, channels, BufferLayout::PLANAR, (1u << power) - 1);
+
+  std::vector<float> input(buf.Capacity(), 0.25f);
+  if (!buf.Write(input.data(), buf.Capacity())) {
+    state.SkipWithError("could not fill ring");
+    return;
+  }
+
+  buf.Skip_Chunked(1u << (power - 1));
+
+  std::mt19937 engine(1234);
+  std::uniform_int_distribution<uint64_t> dist(0, (1u << power) - view_frames);
+  std::vector<float> output(view_frames);
+
+  for (auto _ : state) {
+    FrameView<float> view = buf.View_Chunked(dist(engine), view_frames);
+    view.CopyTo(0, output.data());
+    view.CopyTo(1, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetBytesProcessed(state.iterations() * view_frames * channels * sizeof(float));
+}
+
+// the same kernels, on 64 byte aligned memory and then one sample off of it
+// arg: offset in samples
+static void BM_ConvertAlignment(benchmark::State& state) {
+  const size_t count = 1 << 16;
+  size_t offset = static_cast<size_t>(state.range(0));
+  int16_t* src = static_cast<int16_t*>(AlignedStorage::Allocate(sizeof(int16_t) * (count + 16)));
+  float* dst = static_cast<float*>(AlignedStorage::Allocate(sizeof(float) * (count + 16)));
+  for (size_t i = 0; i < count + 16; i++) {
+    src[i] = static_cast<int16_t>((i * 97) & 0x7fff);
+  }
+
+  for (auto _ : state) {
+    kernels::Convert(src + offset, dst + offset, count);
+    benchmark::DoNotOptimize(dst);
+  }
+
+  state.SetBytesProcessed(state.iterations() * count * (sizeof(int16_t) + sizeof(float)));
+  AlignedStorage::Deallocate(src, sizeof(int16_t) * (count + 16));
+  AlignedStorage::Deallocate(dst, sizeof(float) * (count + 16));
+}
+
+static void BM_MixAddAlignment(benchmark::State& state) {
+  const size_t count = 1 << 16;
+  size_t offset = static_cast<size_t>(state.range(0));
+  float* src = static_cast<float*>(AlignedStorage::Allocate(sizeof(float) * (count + 16)));
+  float* dst = static_cast<float*>(AlignedStorage::Allocate(sizeof(float) * (count + 16)));
+  std::fill(src, src + count + 16, 0.25f);
+  std::fill(dst, dst + count + 16, 0.0f);
+
+  for (auto _ : state) {
+    kernels::MixAdd(src + offset, dst + offset, 0.5f, count);
+    benchmark::DoNotOptimize(dst);
+  }
+
+  state.SetBytesProcessed(state.iterations() * count * sizeof(float) * 3);
+  AlignedStorage::Deallocate(src, sizeof(float) * (count + 16));
+  AlignedStorage::Deallocate(dst, sizeof(float) * (count + 16));
+}
+
+BENCHMARK_TEMPLATE(BM_LargeRingCopy, AlignedStorage)->Arg(14)->Arg(18)->Arg(22)->ArgName("twopow");
+BENCHMARK_TEMPLATE(BM_LargeRingCopy, HugePageStorage)->Arg(14)->Arg(18)->Arg(22)->ArgName("twopow");
+BENCHMARK_TEMPLATE(BM_LargeRingCopy, SharedStorage)->Arg(14)->Arg(18)->Arg(22)->ArgName("twopow");
+
+BENCHMARK_TEMPLATE(BM_ScatteredViews, AlignedStorage)->Arg(18)->Arg(22)->ArgName("twopow");
+BENCHMARK_TEMPLATE(BM_ScatteredViews, HugePageStorage)->Arg(18)->Arg(22)->ArgName("twopow");
+
+BENCHMARK(BM_ConvertAlignment)->Arg(0)->Arg(1)->ArgName("offset");
+BENCHMARK(BM_MixAddAlignment)->Arg(0)->Arg(1)->ArgName("offset");
+
+BENCHMARK_MAIN();
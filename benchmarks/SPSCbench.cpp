@@ -0,0 +1,102 @@
+#include "benchmark/benchmark.h"
+#include "audiohandlers/AudioBufferSPSC.hpp"
+
+#include <vector>
+
+// write a block, then consume it -- measures the copy rate through the ring
+// args: block size in frames, channel count
+static void BM_SPSCWriteRead(benchmark::State& state, BufferLayout layout) {
+  uint32_t frames = static_cast<uint32_t>(state.range(0));
+  int channels = static_cast<int>(state.range(1));
+  uint32_t count = frames * channels;
+
+  AudioBufferSPSC<float> buf(16, channels, layout);
+  std::vector<float> block(count, 0.25f);
+  std::vector<float> output(count);
+
+  for (auto _ : state) {
+    buf.Write(block.data(), count);
+    buf.ReadToBuffer(count, output.data(), channels);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * frames);
+  state.SetBytesProcessed(state.iterations() * count * sizeof(float));
+}
+
+// the visualizer's pattern: write a block, read it back chunked
+static void BM_SPSCWriteReadChunked(benchmark::State& state, BufferLayout layout) {
+  uint32_t frames = static_cast<uint32_t>(state.range(0));
+  int channels = static_cast<int>(state.range(1));
+  uint32_t count = frames * channels;
+
+  AudioBufferSPSC<float> buf(16, channels, layout);
+  std::vector<float> block(count, 0.25f);
+
+  for (auto _ : state) {
+    buf.Write(block.data(), count);
+    float** result = buf.Read_Chunked(frames);
+    benchmark::DoNotOptimize(result);
+  }
+
+  state.SetItemsProcessed(state.iterations() * frames);
+  state.SetBytesProcessed(state.iterations() * count * sizeof(float));
+}
+
+// the render loop's pattern: peek at a large window which mostly hasn't changed
+static void BM_SPSCPeekChunked(benchmark::State& state, BufferLayout layout) {
+  uint32_t frames = static_cast<uint32_t>(state.range(0));
+  int channels = static_cast<int>(state.range(1));
+
+  AudioBufferSPSC<float> buf(16, channels, layout);
+  std::vector<float> block(frames * channels, 0.25f);
+  buf.Write(block.data(), frames * channels);
+
+  for (auto _ : state) {
+    float** result;
+    benchmark::DoNotOptimize(buf.Peek_Chunked(frames, &result));
+    benchmark::DoNotOptimize(result);
+  }
+
+  state.SetItemsProcessed(state.iterations() * frames);
+}
+
+// 16-bit storage, converted on the way out
+static void BM_SPSCCompactWriteRead(benchmark::State& state) {
+  uint32_t frames = static_cast<uint32_t>(state.range(0));
+  int channels = static_cast<int>(state.range(1));
+  uint32_t count = frames * channels;
+
+  AudioBufferSPSC<float, int16_t> buf(16, channels);
+  std::vector<int16_t> block(count, 8192);
+  std::vector<float> output(count);
+
+  for (auto _ : state) {
+    buf.Write(block.data(), count);
+    buf.ReadToBuffer(count, output.data(), channels);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * frames);
+  state.SetBytesProcessed(state.iterations() * count * sizeof(float));
+}
+
+static void BlockArgs(benchmark::internal::Benchmark* b) {
+  for (int channels : {1, 2, 6}) {
+    for (int frames : {256, 1024, 8192}) {
+      b->Args({frames, channels});
+    }
+  }
+
+  b->ArgNames({"frames", "channels"});
+}
+
+BENCHMARK_CAPTURE(BM_SPSCWriteRead, interleaved, BufferLayout::INTERLEAVED)->Apply(BlockArgs);
+BENCHMARK_CAPTURE(BM_SPSCWriteRead, planar, BufferLayout::PLANAR)->Apply(BlockArgs);
+BENCHMARK_CAPTURE(BM_SPSCWriteReadChunked, interleaved, BufferLayout::INTERLEAVED)->Apply(BlockArgs);
+BENCHMARK_CAPTURE(BM_SPSCWriteReadChunked, planar, BufferLayout::PLANAR)->Apply(BlockArgs);
+BENCHMARK_CAPTURE(BM_SPSCPeekChunked, interleaved, BufferLayout::INTERLEAVED)->Apply(BlockArgs);
+BENCHMARK_CAPTURE(BM_SPSCPeekChunked, planar, BufferLayout::PLANAR)->Apply(BlockArgs);
+BENCHMARK(BM_SPSCCompactWriteRead)->Apply(BlockArgs);
+
+BENCHMARK_MAIN();
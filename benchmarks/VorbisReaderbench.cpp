@@ -0,0 +1,98 @@
+#include "benchmark/benchmark.h"
+#include "audioreaders/MemoryReader.hpp"
+#include "audioreaders/VorbisReader.hpp"
+
+#include <memory>
+#include <vector>
+
+const std::string benchfile = "resources/flap_jack_scream.ogg";
+
+// decodes the whole file per iteration
+// frames/s lands in items_per_second, and realtime_factor is (seconds of audio) / (seconds spent)
+// MAPPED reads out of a mapping of the file rather than through stdio
+template <typename SAMPLE, bool MAPPED = false>
+static void BM_VorbisDecode(benchmark::State& state) {
+  std::unique_ptr<VorbisReader> reader(MAPPED ? VorbisReader::GetMappedVorbisReader(benchfile)
+                                              : VorbisReader::GetVorbisReader(benchfile));
+  if (reader == nullptr) {
+    state.SkipWithError("could not open test file");
+    return;
+  }
+
+  int channels = reader->GetChannelCount();
+  int block = static_cast<int>(state.range(0)) * channels;
+  std::vector<SAMPLE> output(block);
+  int64_t frames = 0;
+
+  for (auto _ : state) {
+    reader->Seek(0);
+    int read;
+    do {
+      read = reader->GetSamplesInterleaved(block, output.data());
+      frames += read;
+    } while (read * channels == block);
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetItemsProcessed(frames);
+  state.counters["realtime_factor"] =
+    benchmark::Counter(static_cast<double>(frames) / reader->GetSampleRate(), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_TEMPLATE(BM_VorbisDecode, float)->Arg(1024)->Arg(8192)->ArgName("frames")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_VorbisDecode, int16_t)->Arg(1024)->Arg(8192)->ArgName("frames")->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_VorbisDecode, float, true)->Arg(1024)->Arg(8192)->ArgName("frames")->Unit(benchmark::kMillisecond);
+
+// time to fully decoded, including reading the file -- should scale with the thread count
+static void BM_PreDecode(benchmark::State& state) {
+  int64_t frames = 0;
+  int sample_rate = 0;
+  for (auto _ : state) {
+    std::unique_ptr<MemoryReader> reader(MemoryReader::PreDecodeVorbis(benchfile, static_cast<int>(state.range(0))));
+    if (reader == nullptr) {
+      state.SkipWithError("could not open test file");
+      return;
+    }
+
+    frames += reader->GetFrameCount();
+    sample_rate = reader->GetSampleRate();
+    benchmark::DoNotOptimize(reader->GetData());
+  }
+
+  state.SetItemsProcessed(frames);
+  state.counters["realtime_factor"] =
+    benchmark::Counter(static_cast<double>(frames) / sample_rate, benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_PreDecode)->RangeMultiplier(2)->Range(1, 8)->ArgName("threads")->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// long enough that stb_vorbis has to bisect -- it scans anything under 64KB linearly
+const std::string seekfile = "resources/shawty.ogg";
+
+// random seeks, each followed by a short read -- Arg(1) seeks through a page index
+static void BM_Seek(benchmark::State& state) {
+  std::unique_ptr<VorbisReader> reader(state.range(0) ? VorbisReader::GetIndexedVorbisReader(seekfile, ".")
+                                                      : VorbisReader::GetVorbisReader(seekfile));
+  if (reader == nullptr) {
+    state.SkipWithError("could not open test file");
+    return;
+  }
+
+  int channels = reader->GetChannelCount();
+  int64_t length = reader->GetLength();
+  std::vector<float> output(256 * channels);
+  uint64_t target = 12345;
+  for (auto _ : state) {
+    // cheap lcg, so every run seeks to the same places
+    target = (target * 6364136223846793005ull + 1442695040888963407ull);
+    reader->Seek(static_cast<int>((target >> 33) % (length - 256)));
+    reader->GetSamplesInterleaved(256 * channels, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_Seek)->Arg(0)->Arg(1)->ArgName("indexed")->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
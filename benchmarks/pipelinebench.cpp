@@ -0,0 +1,60 @@
+#include "benchmark/benchmark.h"
+#include "audioreaders/VorbisReader.hpp"
+#include "audiohandlers/AudioBufferSPSC.hpp"
+#include "audiohandlers/DFT.hpp"
+
+#include <memory>
+#include <vector>
+
+const std::string benchfile = "resources/flap_jack_scream.ogg";
+
+// decode -> ring -> FFT, without the audio device and the render loop.
+// each iteration pushes the whole file through in blocks, and transforms the
+// most recent `window` frames of the left channel once per block (as the render loop would).
+static void BM_DecodeRingFFT(benchmark::State& state) {
+  std::unique_ptr<VorbisReader> reader(VorbisReader::GetVorbisReader(benchfile));
+  if (reader == nullptr) {
+    state.SkipWithError("could not open test file");
+    return;
+  }
+
+  const uint32_t block_frames = 2048;
+  const uint32_t window = static_cast<uint32_t>(state.range(0));
+  int channels = reader->GetChannelCount();
+
+  AudioBufferSPSC<float> ring(16, channels, BufferLayout::PLANAR, window);
+  std::vector<float> decoded(block_frames * channels);
+  std::vector<float> samples(window);
+  std::vector<float> real(window);
+  std::vector<float> imag(window);
+  std::vector<float> amplitude(window);
+  int64_t frames = 0;
+
+  for (auto _ : state) {
+    reader->Seek(0);
+    ring.Clear();
+    int read;
+    do {
+      read = reader->GetSamplesInterleaved(block_frames * channels, decoded.data());
+      ring.Write(decoded.data(), read * channels);
+      ring.Skip_Chunked(read);
+      frames += read;
+
+      if (ring.GetReadFrame() >= window) {
+        FrameView<float> view = ring.View_Chunked(ring.GetReadFrame() - window, window);
+        view.CopyTo(0, samples.data());
+        dft::CalculateDFT(samples.data(), real.data(), imag.data(), window);
+        dft::GetAmplitudeArray(real.data(), imag.data(), amplitude.data(), window, true);
+        benchmark::DoNotOptimize(amplitude.data());
+      }
+    } while (static_cast<uint32_t>(read) == block_frames);
+  }
+
+  state.SetItemsProcessed(frames);
+  state.counters["realtime_factor"] =
+    benchmark::Counter(static_cast<double>(frames) / reader->GetSampleRate(), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_DecodeRingFFT)->Arg(2048)->Arg(8192)->ArgName("window")->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -279,6 +279,14 @@ extern int stb_vorbis_seek(stb_vorbis *f, unsigned int sample_number);
 // do not need to seek to EXACTLY the target sample when using get_samples_*,
 // you can also use seek_frame().
 
+extern int stb_vorbis_seek_hinted(stb_vorbis *f, unsigned int sample_number,
+                                  unsigned int left_page, unsigned int right_page);
+// the same as stb_vorbis_seek(), but only searches between the pages starting at
+// byte offsets 'left_page' and 'right_page' -- e.g. from an index of page granule
+// positions. the left page should end at least a frame (info.max_frame_size)
+// before 'sample_number', and the right page after it. hints which don't hold
+// (or don't point at a page) are ignored, falling back to a full search.
+
 extern int stb_vorbis_seek_start(stb_vorbis *f);
 // this function is equivalent to stb_vorbis_seek(f,0)
 
@@ -4229,7 +4229,7 @@ static int go_to_page_before(stb_vorbis *f, unsigned int limit_offset)
 // the function succeeds, current_loc_valid will be true and current_loc will
 // be less than or equal to the provided sample number (the closer the
 // better).
-static int seek_to_sample_coarse(stb_vorbis *f, uint32 sample_number)
+static int seek_to_sample_coarse(stb_vorbis *f, uint32 sample_number, const ProbedPage *hint_left, const ProbedPage *hint_right)
 {
    ProbedPage left, right, mid;
    int i, start_seg_with_known_loc, end_pos, page_start;
@@ -4251,14 +4251,14 @@ static int seek_to_sample_coarse(stb_vorbis *f, uint32 sample_number)
    else
       sample_number -= padding;
 
-   left = f->p_first;
+   left = hint_left ? *hint_left : f->p_first;
    while (left.last_decoded_sample == ~0U) {
       // (untested) the first page does not have a 'last_decoded_sample'
       set_file_offset(f, left.page_end);
       if (!get_seek_page_info(f, &left)) goto error;
    }
 
-   right = f->p_last;
+   right = hint_right ? *hint_right : f->p_last;
    assert(right.last_decoded_sample != ~0U);
 
    // starting from the start is handled differently
@@ -4404,14 +4404,14 @@ static int peek_decode_initial(vorb *f, int *p_left_start, int *p_left_end, int
    return 1;
 }
 
-int stb_vorbis_seek_frame(stb_vorbis *f, unsigned int sample_number)
+static int seek_frame(stb_vorbis *f, unsigned int sample_number, const ProbedPage *hint_left, const ProbedPage *hint_right)
 {
    uint32 max_frame_samples;
 
    if (IS_PUSH_MODE(f)) return error(f, VORBIS_invalid_api_mixing);
 
    // fast page-level search
-   if (!seek_to_sample_coarse(f, sample_number))
+   if (!seek_to_sample_coarse(f, sample_number, hint_left, hint_right))
       return 0;
 
    assert(f->current_loc_valid);
@@ -4443,9 +4443,14 @@ int stb_vorbis_seek_frame(stb_vorbis *f, unsigned int sample_number)
    return 1;
 }
 
-int stb_vorbis_seek(stb_vorbis *f, unsigned int sample_number)
+int stb_vorbis_seek_frame(stb_vorbis *f, unsigned int sample_number)
+{
+   return seek_frame(f, sample_number, NULL, NULL);
+}
+
+static int seek_sample(stb_vorbis *f, unsigned int sample_number, const ProbedPage *hint_left, const ProbedPage *hint_right)
 {
-   if (!stb_vorbis_seek_frame(f, sample_number))
+   if (!seek_frame(f, sample_number, hint_left, hint_right))
       return 0;
 
    if (sample_number != f->current_loc) {
@@ -4460,6 +4465,46 @@ int stb_vorbis_seek(stb_vorbis *f, unsigned int sample_number)
    return 1;
 }
 
+int stb_vorbis_seek(stb_vorbis *f, unsigned int sample_number)
+{
+   return seek_sample(f, sample_number, NULL, NULL);
+}
+
+int stb_vorbis_seek_hinted(stb_vorbis *f, unsigned int sample_number, unsigned int left_page, unsigned int right_page)
+{
+   ProbedPage left, right;
+   const ProbedPage *hint_left = NULL, *hint_right = NULL;
+   uint32 padding;
+
+   if (IS_PUSH_MODE(f)) return error(f, VORBIS_invalid_api_mixing);
+
+   // fills in p_last, so the hints can't be checked against a stale end
+   if (stb_vorbis_stream_length_in_samples(f) == 0) return error(f, VORBIS_seek_without_length);
+
+   // seek_to_sample_coarse backs off by this much -- the left page has to end before that
+   padding = ((f->blocksize_1 - f->blocksize_0) >> 2);
+
+   set_file_offset(f, left_page);
+   if (left_page >= f->first_audio_page_offset && left_page < f->stream_len && get_seek_page_info(f, &left)
+         && left.last_decoded_sample != ~0U && left.last_decoded_sample + padding < sample_number)
+      hint_left = &left;
+
+   set_file_offset(f, right_page);
+   if (right_page >= f->first_audio_page_offset && right_page < f->stream_len && get_seek_page_info(f, &right) && right.last_decoded_sample != ~0U
+         && right.last_decoded_sample > sample_number)
+      hint_right = &right;
+
+   // the search assumes the left page is strictly before the right one
+   if (hint_left && hint_right && left.page_end > right.page_start)
+      hint_left = hint_right = NULL;
+   if (hint_left && !hint_right && left.page_end > f->p_last.page_start)
+      hint_left = NULL;
+   if (hint_right && !hint_left && f->p_first.page_end > right.page_start)
+      hint_right = NULL;
+
+   return seek_sample(f, sample_number, hint_left, hint_right);
+}
+
 int stb_vorbis_seek_start(stb_vorbis *f)
 {
    if (IS_PUSH_MODE(f)) { return error(f, VORBIS_invalid_api_mixing); }
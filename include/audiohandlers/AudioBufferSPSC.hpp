@@ -1,37 +1,209 @@
 #ifndef AUDIOBUFFERSPSC_H_
 #define AUDIOBUFFERSPSC_H_
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cmath>
 #include <mutex>
+#include <new>
 
 #include <iostream>
 
+#include "audiohandlers/RingStorage.hpp"
+#include "audiohandlers/SampleKernels.hpp"
+
 struct pc_marker {
-  uint32_t position; // the index which the marker points to (masked 2x)
+  uint64_t position; // absolute index of the next sample -- never wraps, mask before use
   uint32_t safesize;  // minimum number of elements which are guaranteed to be available
 };
 
+/**
+ *  The cursors the reader and writer publish to one another. Kept in the same allocation as
+ *  the samples, so that a ring in SharedStorage is whole in every process which maps it.
+ *  Reader and writer sides get a cache line each.
+ */
+struct ring_cursors {
+  alignas(64) std::atomic_uint64_t read;    // shared ptr for syncing read val
+  std::atomic_uint64_t read_marker;         // tracks number of samples read thus far
+  alignas(64) std::atomic_uint64_t write;   // shared ptr for syncing write val
+};
+
+/**
+ *  How samples are laid out in the buffer's backing storage.
+ *  Writes always take interleaved input, regardless of layout.
+ */
+enum class BufferLayout {
+  INTERLEAVED,  // samples are stored in the order they were written
+  PLANAR        // one contiguous region per channel -- deinterleaved once, at write time
+};
+
+/**
+ *  A read-only window onto a range of frames held in an AudioBufferSPSC. Holds pointers only.
+ *  The window may wrap around the end of the buffer, so each channel comes in two parts:
+ *  Length(0) frames starting at Data(c, 0), followed by Length(1) frames starting at Data(c, 1).
+ *  Consecutive frames within a part are Stride() samples apart (1 for planar buffers).
+ *
+ *  Data() exposes samples as stored (S). At() and CopyTo() convert them to T.
+ */
+template <typename T, typename S = T>
+struct FrameView {
+  uint64_t frame;   // absolute frame number of the first frame in view
+  uint32_t length;  // number of frames in view -- 0 if none of the requested range is held
+
+  const S* Data(int channel, int part) const {
+    uint32_t start = (part == 0 ? offset_ : 0);
+    if (planar_) {
+      return base_ + (static_cast<size_t>(channel) * frame_capacity_) + start;
+    }
+
+    return base_ + (static_cast<size_t>(start) * channel_count_) + channel;
+  }
+
+  uint32_t Length(int part) const {
+    uint32_t first = frame_capacity_ - offset_;
+    first = (length < first ? length : first);
+    return (part == 0 ? first : length - first);
+  }
+
+  int Stride() const {
+    return (planar_ ? 1 : channel_count_);
+  }
+
+  /**
+   *  Returns the `index`th frame of `channel`.
+   */
+  T At(int channel, uint32_t index) const {
+    uint32_t first = Length(0);
+    if (index < first) {
+      return kernels::ConvertSample<S, T>(Data(channel, 0)[static_cast<size_t>(index) * Stride()]);
+    }
+
+    return kernels::ConvertSample<S, T>(Data(channel, 1)[static_cast<size_t>(index - first) * Stride()]);
+  }
+
+  /**
+   *  Copies all frames of `channel` into `dest`, which must hold `length` entries.
+   */
+  void CopyTo(int channel, T* dest) const {
+    int stride = Stride();
+    for (int part = 0; part < 2; part++) {
+      const S* src = Data(channel, part);
+      uint32_t len = Length(part);
+      if (stride == 1) {
+        kernels::Convert(src, dest, len);
+        dest += len;
+        continue;
+      }
+
+      for (uint32_t i = 0; i < len; i++) {
+        *dest++ = kernels::ConvertSample<S, T>(src[static_cast<size_t>(i) * stride]);
+      }
+    }
+  }
+
+  const S* base_;
+  uint32_t frame_capacity_;
+  uint32_t offset_;         // index of `frame` within the buffer, in frames
+  int channel_count_;
+  bool planar_;
+};
+
+/**
+ *  A writable window onto free space in an AudioBufferSPSC, handed out by Reserve.
+ *  Laid out like FrameView: each channel comes in two parts, Length(0) frames at Data(c, 0)
+ *  followed by Length(1) frames at Data(c, 1), with Stride() samples between frames.
+ *  On an interleaved buffer, Data(0, part) is a run of whole interleaved frames.
+ */
+template <typename S>
+struct WriteRegion {
+  uint64_t frame;   // absolute frame number the region starts at
+  uint32_t length;  // number of frames reserved -- may be less than asked for
+
+  S* Data(int channel, int part) const {
+    uint32_t start = (part == 0 ? offset_ : 0);
+    if (planar_) {
+      return base_ + (static_cast<size_t>(channel) * frame_capacity_) + start;
+    }
+
+    return base_ + (static_cast<size_t>(start) * channel_count_) + channel;
+  }
+
+  uint32_t Length(int part) const {
+    uint32_t first = frame_capacity_ - offset_;
+    first = (length < first ? length : first);
+    return (part == 0 ? first : length - first);
+  }
+
+  int Stride() const {
+    return (planar_ ? 1 : channel_count_);
+  }
+
+  S* base_;
+  uint32_t frame_capacity_;
+  uint32_t offset_;
+  int channel_count_;
+  bool planar_;
+};
+
+/**
+ *  A snapshot of an AudioBufferSPSC's counters. See AudioBufferSPSC::GetStats.
+ *  Counts are cumulative since construction -- diff two snapshots to get a rate.
+ */
+struct BufferStats {
+  static const int FILL_BUCKETS = 16;
+
+  uint64_t underruns;       // consuming reads which failed for lack of data
+  uint64_t forced_writes;   // Force_Write calls which had to push the read head along
+  uint64_t dropped_frames;  // frames skipped over by those forced writes
+  uint32_t high_water;      // most samples ever held after a write
+  uint32_t low_water;       // fewest samples held going into a write, once reading began
+  uint64_t writes;          // number of successful writes
+
+  // fill level sampled at each write, in 1/FILL_BUCKETS of capacity
+  uint64_t fill_histogram[FILL_BUCKETS];
+};
+
 // default: interleaved
 // chunked: separate by channel
 
 // only one should be used -- behavior is undefined if mixing
-template <typename BUFFER_UNIT>
+// (in planar mode, every count passed to the buffer must be a whole number of frames)
+//
+// history_frames: number of already-read frames which the writer will not overwrite.
+//                 they stay reachable via View_Chunked, at the cost of write space.
+//
+// STORAGE_UNIT: the sample type held in the ring, if different from what readers receive.
+//               e.g. <float, int16_t> halves the ring's footprint, converting on every read.
+//
+// STORAGE_POLICY: where the ring's samples (and cursors) live -- see RingStorage.hpp.
+//                 64-byte aligned heap memory by default.
+template <typename BUFFER_UNIT, typename STORAGE_UNIT = BUFFER_UNIT, typename STORAGE_POLICY = AlignedStorage>
 class AudioBufferSPSC {
  public:
-  AudioBufferSPSC(int twopow, int channel_count = 1) :
+  AudioBufferSPSC(int twopow, int channel_count = 1, BufferLayout layout = BufferLayout::INTERLEAVED,
+                  uint32_t history_frames = 0) :
     channel_count_(channel_count),
+    layout_(layout),
+    frame_capacity_(1u << twopow),
+    history_capacity_((history_frames < frame_capacity_ ? history_frames : frame_capacity_ - 1) * channel_count),
     buffer_capacity_(pow(2, twopow) * channel_count_),
-    buffer_(new BUFFER_UNIT[buffer_capacity_]),
-    readzone_(new BUFFER_UNIT[buffer_capacity_]),
+    buffer_(static_cast<STORAGE_UNIT*>(STORAGE_POLICY::Allocate(StorageBytes()))),
+    cursors_(new (reinterpret_cast<char*>(buffer_) + SampleBytes()) ring_cursors()),
+    readzone_(nullptr),
+    readzone_capacity_(0),
     channelzone_(new BUFFER_UNIT*[channel_count]),
+    reader_planes_(new STORAGE_UNIT*[channel_count]),
+    writer_planes_(new STORAGE_UNIT*[channel_count]),
     reader_thread_({0, 0}),
-    shared_read_(0),
-    read_marker_(0),
+    shared_read_(cursors_->read),
+    read_marker_(cursors_->read_marker),
     writer_thread_({0, 0}),
-    shared_write_(0)
+    shared_write_(cursors_->write)
     {
+      shared_read_.store(0);
+      read_marker_.store(0);
+      shared_write_.store(0);
       writer_thread_.safesize = buffer_capacity_;
     }
 
@@ -48,7 +220,7 @@ class AudioBufferSPSC {
    */ 
   size_t Peek(uint32_t count, BUFFER_UNIT** output) {
     uint32_t len;
-    std::lock_guard<std::mutex> lock(read_lock_);
+    std::unique_lock<std::mutex> lock = LockReader();
     if (reader_thread_.safesize < count) {
       // no guarantee that we have enough room to read -- check the atomic
       UpdateReaderThread();
@@ -63,15 +235,9 @@ class AudioBufferSPSC {
     if (len == 0) {
       return 0;
     }
-    
-    uint32_t masked_read = Mask(reader_thread_.position);
-    for (uint32_t i = 0; i < len; i++) {
-      if (masked_read >= buffer_capacity_) {
-        masked_read -= buffer_capacity_;
-      }
 
-      readzone_[i] = buffer_[masked_read++];
-    }
+    ReserveReadzone(len);
+    CopyOut(Mask(reader_thread_.position), readzone_, len);
 
     *output = readzone_;
     return len;
@@ -80,6 +246,11 @@ class AudioBufferSPSC {
   /**
    *  Returns samples in a "chunked" format, separating channels into individual buffers.
    *  If used in conjunction with the default "interleaved" formats, behavior is undefined.
+   *
+   *  The samples are always copied out of the ring, since a Force_Write may move the read
+   *  head and overwrite the peeked region while the caller is still using it. The returned
+   *  pointers remain valid until the next Peek or Read on this buffer. To read planar storage
+   *  in place, take a View_Chunked and check IsRetained once finished with it.
    * 
    *  Arguments:
    *    - framecount, the number of samples read from each channel.
@@ -92,9 +263,7 @@ class AudioBufferSPSC {
     uint32_t len;
     uint32_t count = framecount * channel_count_;
 
-    RefreshChannelZone();
-
-    std::lock_guard<std::mutex> lock(read_lock_);
+    std::unique_lock<std::mutex> lock = LockReader();
     if (reader_thread_.safesize < count) {
       UpdateReaderThread();
     }
@@ -105,16 +274,7 @@ class AudioBufferSPSC {
       len = framecount;
     }
 
-    uint32_t masked_read = Mask(reader_thread_.position);
-
-    for (uint32_t i = 0; i < len; i++) {
-      for (int j = 0; j < channel_count_; j++) {
-        if (masked_read >= buffer_capacity_) {
-          masked_read -= buffer_capacity_;
-        }
-        channelzone_[j][i] = buffer_[masked_read++];
-      }
-    }
+    CopyChunked(Mask(reader_thread_.position), len);
 
     *output = channelzone_;
 
@@ -126,7 +286,7 @@ class AudioBufferSPSC {
    *  number of samples read.
    */ 
   bool Skip(uint32_t count) {
-    std::lock_guard<std::mutex> lock(read_lock_);
+    std::unique_lock<std::mutex> lock = LockReader();
     if (reader_thread_.safesize < count) {
       UpdateReaderThread();
     }
@@ -135,10 +295,11 @@ class AudioBufferSPSC {
       return false;
     }
 
-    reader_thread_.position = MaskTwo(reader_thread_.position + count);
+    reader_thread_.position = reader_thread_.position + count;
     reader_thread_.safesize -= count;
 
     shared_read_.store(reader_thread_.position, std::memory_order_release);
+    return true;
   }
 
   bool Skip_Chunked(uint32_t framecount) {
@@ -160,24 +321,20 @@ class AudioBufferSPSC {
    *  - a R/W pointer to the read data.
    */
   BUFFER_UNIT* Read(uint32_t count) {
-    std::lock_guard<std::mutex> lock(read_lock_);
+    std::unique_lock<std::mutex> lock = LockReader();
     if (reader_thread_.safesize < count) {
       UpdateReaderThread();
 
       if (reader_thread_.safesize < count) {
+        RecordUnderrun();
         return nullptr; 
       }
     }
 
-    uint32_t masked_read = Mask(reader_thread_.position);
-    for (uint32_t i = 0; i < count; i++) {
-      if (masked_read >= buffer_capacity_) {
-        masked_read -= buffer_capacity_;
-      }
-      readzone_[i] = buffer_[masked_read++];
-    }
+    ReserveReadzone(count);
+    CopyOut(Mask(reader_thread_.position), readzone_, count);
 
-    reader_thread_.position = MaskTwo(reader_thread_.position + count);
+    reader_thread_.position = reader_thread_.position + count;
     reader_thread_.safesize -= count;
 
     shared_read_.store(reader_thread_.position, std::memory_order_release);
@@ -192,16 +349,18 @@ class AudioBufferSPSC {
    *  was successful.
    * 
    *  @param count - the number of samples we are reading from the buffer.
-   *  @param output - the buffer we're outputting to.
+   *  @param output - the buffer we're outputting to. Receives count * output_channel_count / channel_count samples.
    *  @param output_channel_count - the number of channels in the output.
    *                                used to play mono sound on stereo output, for instance
+   *                                (see ChannelMatrix and ReadInPlace for anything else)
    */ 
   bool ReadToBuffer(uint32_t count, BUFFER_UNIT* output, int output_channel_count) {
-    std::lock_guard<std::mutex> lock(read_lock_);
-    if (reader_thread_.safesize < (count * output_channel_count)) {
+    std::unique_lock<std::mutex> lock = LockReader();
+    if (reader_thread_.safesize < count) {
       UpdateReaderThread();
 
-      if (reader_thread_.safesize < count * output_channel_count) {
+      if (reader_thread_.safesize < count) {
+        RecordUnderrun();
         return false; 
       }
     }
@@ -209,18 +368,23 @@ class AudioBufferSPSC {
     int sample_channel_ratio = output_channel_count / channel_count_;
 
     uint32_t masked_read = Mask(reader_thread_.position);
-    for (uint32_t i = 0; i < count; i++) {
-      if (masked_read >= buffer_capacity_) {
-        masked_read -= buffer_capacity_;
-      }
-      for (int j = 0; j < sample_channel_ratio; j++) {
-        output[i * sample_channel_ratio + j] = buffer_[masked_read];
-      }
+    if (sample_channel_ratio == 1) {
+      CopyOut(masked_read, output, count);
+    } else {
+      for (uint32_t i = 0; i < count; i++) {
+        if (masked_read >= buffer_capacity_) {
+          masked_read -= buffer_capacity_;
+        }
+        for (int j = 0; j < sample_channel_ratio; j++) {
+          output[i * sample_channel_ratio + j] =
+            kernels::ConvertSample<STORAGE_UNIT, BUFFER_UNIT>(buffer_[StorageIndex(masked_read)]);
+        }
 
-      masked_read++;     
+        masked_read++;
+      }
     }
 
-    reader_thread_.position = MaskTwo(reader_thread_.position + count);
+    reader_thread_.position = reader_thread_.position + count;
     reader_thread_.safesize -= count;
 
     shared_read_.store(reader_thread_.position, std::memory_order_release);
@@ -229,30 +393,65 @@ class AudioBufferSPSC {
     return true;
   }
 
+  /**
+   *  Reads up to `framecount` frames without copying them anywhere first: `consume` is handed
+   *  the ring's own storage, as one or two runs of whole interleaved frames --
+   *  consume(const STORAGE_UNIT* data, uint32_t frames) -- and the frames are released once
+   *  it returns. Interleaved buffers only.
+   *
+   *  Returns the number of frames read. Coming up short of framecount counts as an underrun.
+   */
+  template <typename FUNC>
+  uint32_t ReadInPlace(uint32_t framecount, FUNC&& consume) {
+    std::unique_lock<std::mutex> lock = LockReader();
+    uint32_t count = framecount * channel_count_;
+    if (reader_thread_.safesize < count) {
+      UpdateReaderThread();
+    }
+
+    uint32_t frames = Min(framecount, reader_thread_.safesize / channel_count_);
+    if (frames < framecount) {
+      RecordUnderrun();
+    }
+
+    if (frames == 0) {
+      return 0;
+    }
+
+    // capacity is a whole number of frames, so frames never straddle the wrap
+    count = frames * channel_count_;
+    uint32_t start = Mask(reader_thread_.position);
+    uint32_t first = Min(frames, (buffer_capacity_ - start) / channel_count_);
+    consume(static_cast<const STORAGE_UNIT*>(buffer_ + start), first);
+    if (first < frames) {
+      consume(static_cast<const STORAGE_UNIT*>(buffer_), frames - first);
+    }
+
+    reader_thread_.position = reader_thread_.position + count;
+    reader_thread_.safesize -= count;
+
+    shared_read_.store(reader_thread_.position, std::memory_order_release);
+    read_marker_.fetch_add(count, std::memory_order_acq_rel);
+
+    return frames;
+  }
+
   BUFFER_UNIT** Read_Chunked(uint32_t framecount) {
     uint32_t count = framecount * channel_count_;
-    std::lock_guard<std::mutex> lock(read_lock_);
+    std::unique_lock<std::mutex> lock = LockReader();
     if (reader_thread_.safesize < count) {
       UpdateReaderThread();
     }
 
     if (reader_thread_.safesize < count) {
+      RecordUnderrun();
       return nullptr;
     }
 
-    RefreshChannelZone();
-
-    uint32_t masked_read = Mask(reader_thread_.position);
-    for (uint32_t i = 0; i < framecount; i++) {
-      for (int j = 0; j < channel_count_; j++) {
-        if (masked_read >= buffer_capacity_) {
-          masked_read -= buffer_capacity_;
-        }
-        channelzone_[j][i] = buffer_[masked_read++];
-      }
-    }
+    // the region is released below, so the writer may reuse it -- always copy out
+    CopyChunked(Mask(reader_thread_.position), framecount);
 
-    reader_thread_.position = MaskTwo(reader_thread_.position + count);
+    reader_thread_.position = reader_thread_.position + count;
     reader_thread_.safesize -= count;
 
     shared_read_.store(reader_thread_.position, std::memory_order_release);
@@ -262,31 +461,34 @@ class AudioBufferSPSC {
   }
 
   /**
-   *  Synchronizes the audio buffer to a given sample number.
-   *  Note: buffer is emptied if sample_num is larget than the number of entries currently contained
-   *  Adjusts the internal sample counter to the provided value.
+   *  Synchronizes the audio buffer to a given sample number, counted from the last Clear.
+   *  Note: buffer is emptied if sample_num is larger than the number of entries currently contained.
+   *  Sample numbers behind the read position are ignored.
+   *  Adjusts the internal sample counter to the position actually reached.
    */ 
-  void Synchronize(uint32_t sample_num) {
-    std::lock_guard<std::mutex> lock(read_lock_);
+  void Synchronize(uint64_t sample_num) {
+    std::unique_lock<std::mutex> lock = LockReader();
     // take into account cases where the sample point is behind current
-    uint32_t count = sample_num - read_marker_.load(std::memory_order_acquire);
+    if (sample_num <= reader_thread_.position) {
+      return;
+    }
+
+    uint64_t count = sample_num - reader_thread_.position;
     // ensure that we have enough space to leap
-    if (count > 0) {
-      if (count > reader_thread_.safesize) {
-        UpdateReaderThread();
-      }
+    if (count > reader_thread_.safesize) {
+      UpdateReaderThread();
+    }
 
-      // wipes the buffer if necessary
-      int offset = Min(reader_thread_.safesize, count);
+    // wipes the buffer if necessary
+    uint32_t offset = static_cast<uint32_t>(count < reader_thread_.safesize ? count : reader_thread_.safesize);
 
-      reader_thread_.safesize -= offset;
-      reader_thread_.position = MaskTwo(reader_thread_.position + offset);
-      shared_read_.store(reader_thread_.position, std::memory_order_release);
-      read_marker_.store(sample_num, std::memory_order_release);
-    }
+    reader_thread_.safesize -= offset;
+    reader_thread_.position = reader_thread_.position + offset;
+    shared_read_.store(reader_thread_.position, std::memory_order_release);
+    read_marker_.store(reader_thread_.position, std::memory_order_release);
   }
 
-  void Synchronize_Chunked(uint32_t frame_num) {
+  void Synchronize_Chunked(uint64_t frame_num) {
     Synchronize(frame_num * channel_count_);
   }
 
@@ -298,8 +500,11 @@ class AudioBufferSPSC {
    * If mixing this write call with other chunked calls,
    * entries must be interleaved, with a series of n samples
    * containing each sample for all n channels in a frame.
+   *
+   * data may be of any sample type -- it is converted to STORAGE_UNIT on the way in.
    */ 
-  bool Write(const BUFFER_UNIT* data, uint32_t count) {
+  template <typename INPUT_UNIT>
+  bool Write(const INPUT_UNIT* data, uint32_t count) {
     std::lock_guard<std::mutex> lock(write_lock_);
     if (writer_thread_.safesize < count) {
       UpdateWriterThread();
@@ -309,15 +514,10 @@ class AudioBufferSPSC {
       return false;
     }
 
-    uint32_t masked_write = Mask(writer_thread_.position);
-    for (uint32_t i = 0; i < count; i++) {
-      if (masked_write >= buffer_capacity_) {
-        masked_write -= buffer_capacity_;
-      }
-      buffer_[masked_write++] = data[i];
-    }
+    RecordFill(count);
+    CopyIn(Mask(writer_thread_.position), data, count);
 
-    writer_thread_.position = MaskTwo(writer_thread_.position + count);
+    writer_thread_.position = writer_thread_.position + count;
     writer_thread_.safesize -= count;
 
     shared_write_.store(writer_thread_.position, std::memory_order_release);
@@ -325,33 +525,86 @@ class AudioBufferSPSC {
     return true;
   }
 
-  void Force_Write(const BUFFER_UNIT* data, uint32_t count) {
+  /**
+   *  Writes to the buffer, advancing the read head (and the history behind it) if there
+   *  is not enough room. count may not exceed Capacity() less the history window.
+   */
+  template <typename INPUT_UNIT>
+  void Force_Write(const INPUT_UNIT* data, uint32_t count) {
     std::scoped_lock lock(read_lock_, write_lock_);
     UpdateWriterThread();
 
     if (writer_thread_.safesize < count) {
       // need to adjust the write thread
-      int to_skip = count - writer_thread_.safesize;
-      reader_thread_.position = MaskTwo(reader_thread_.position + to_skip);
-      reader_thread_.safesize -= to_skip;
-      writer_thread_.safesize += to_skip;
+      // the read head must end up at least this far along for the data to fit
+      uint64_t target = writer_thread_.position + count + history_capacity_ - buffer_capacity_;
+      Bump(forced_writes_);
+      Bump(dropped_frames_, (target - reader_thread_.position) / channel_count_);
+      reader_thread_.position = target;
+      reader_thread_.safesize = static_cast<uint32_t>(writer_thread_.position - target);
+      writer_thread_.safesize = count;
       shared_read_.store(reader_thread_.position, std::memory_order_release);
     }
 
-    uint32_t masked_write = Mask(writer_thread_.position);
-    for (uint32_t i = 0; i < count; i++) {
-      if (masked_write >= buffer_capacity_) {
-        masked_write -= buffer_capacity_;
-      }
-      buffer_[masked_write++] = data[i];
+    RecordFill(count);
+    CopyIn(Mask(writer_thread_.position), data, count);
+
+    writer_thread_.position = writer_thread_.position + count;
+    writer_thread_.safesize -= count;
+
+    shared_write_.store(writer_thread_.position, std::memory_order_release);
+  }
+
+  /**
+   *  Reserves up to `framecount` frames of free space for the writer to fill in place,
+   *  instead of staging samples elsewhere and copying them in with Write.
+   *  Nothing is visible to the reader until Commit. Writer only -- no other write
+   *  may happen between a Reserve and its Commit.
+   */
+  WriteRegion<STORAGE_UNIT> Reserve(uint32_t framecount) {
+    std::lock_guard<std::mutex> lock(write_lock_);
+    UpdateWriterThread();
+
+    uint32_t room = writer_thread_.safesize / channel_count_;
+    WriteRegion<STORAGE_UNIT> region;
+    region.frame = writer_thread_.position / channel_count_;
+    region.length = (framecount < room ? framecount : room);
+    region.base_ = buffer_;
+    region.frame_capacity_ = frame_capacity_;
+    region.offset_ = static_cast<uint32_t>(region.frame % frame_capacity_);
+    region.channel_count_ = channel_count_;
+    region.planar_ = (layout_ == BufferLayout::PLANAR);
+    return region;
+  }
+
+  /**
+   *  Publishes the first `framecount` frames of the last Reserve to the reader.
+   *  framecount may not exceed the reserved length.
+   */
+  void Commit(uint32_t framecount) {
+    if (framecount == 0) {
+      return;
     }
 
-    writer_thread_.position = MaskTwo(writer_thread_.position + count);
+    std::lock_guard<std::mutex> lock(write_lock_);
+    uint32_t count = framecount * channel_count_;
+    RecordFill(count);
+
+    writer_thread_.position = writer_thread_.position + count;
     writer_thread_.safesize -= count;
 
     shared_write_.store(writer_thread_.position, std::memory_order_release);
   }
 
+  /**
+   *  Promises that the reader has the read head to itself: one thread reads, nothing calls
+   *  Force_Write, and Clear only happens while that thread is idle. Reads then skip read_lock_,
+   *  so the read path takes no lock at all. Call before reading starts.
+   */
+  void SetSingleConsumer() {
+    single_consumer_ = true;
+  }
+
   /**
    *  Wipes the contents of the queue. Not thread safe.
    */ 
@@ -366,6 +619,88 @@ class AudioBufferSPSC {
     read_marker_.store(0);    // wipe history as well
   }
 
+  /**
+   *  Returns a view of frames [frame, frame + framecount), by absolute frame number
+   *  (counted from the last Clear). The view is clipped to the frames currently held:
+   *  the history window behind the read head, plus everything written ahead of it.
+   *
+   *  Lock-free, and does not move the read head -- any number of threads may hold views
+   *  at once. Frames which fall out of the history window may be overwritten while a view
+   *  is in use; if the reader might have moved on in the meantime, check IsRetained(view.frame)
+   *  once finished with the data.
+   */
+  FrameView<BUFFER_UNIT, STORAGE_UNIT> View_Chunked(uint64_t frame, uint32_t framecount) const {
+    uint64_t newest = shared_write_.load(std::memory_order_acquire) / channel_count_;
+    uint64_t oldest = GetOldestFrame();
+
+    uint64_t start = (frame > oldest ? frame : oldest);
+    uint64_t end = frame + framecount;
+    end = (end < newest ? end : newest);
+
+    FrameView<BUFFER_UNIT, STORAGE_UNIT> view;
+    view.frame = start;
+    view.length = (end > start ? static_cast<uint32_t>(end - start) : 0);
+    view.base_ = buffer_;
+    view.frame_capacity_ = frame_capacity_;
+    view.offset_ = static_cast<uint32_t>(start % frame_capacity_);
+    view.channel_count_ = channel_count_;
+    view.planar_ = (layout_ == BufferLayout::PLANAR);
+    return view;
+  }
+
+  /**
+   *  Returns true if `frame` has not yet been released to the writer.
+   */
+  bool IsRetained(uint64_t frame) const {
+    return frame >= GetOldestFrame();
+  }
+
+  /**
+   *  Returns the absolute number of the oldest frame still held in the buffer.
+   */
+  uint64_t GetOldestFrame() const {
+    uint64_t read = shared_read_.load(std::memory_order_acquire);
+    return (read > history_capacity_ ? read - history_capacity_ : 0) / channel_count_;
+  }
+
+  /**
+   *  Returns the absolute number of the next frame the reader will consume.
+   */
+  uint64_t GetReadFrame() const {
+    return shared_read_.load(std::memory_order_acquire) / channel_count_;
+  }
+
+  /**
+   *  Returns the absolute number of the next frame the writer will produce.
+   */
+  uint64_t GetWriteFrame() const {
+    return shared_write_.load(std::memory_order_acquire) / channel_count_;
+  }
+
+  /**
+   *  Returns a snapshot of the buffer's counters. Lock-free, and safe to call from any thread.
+   *  Counters are read one at a time, so a snapshot taken mid-write may be slightly skewed.
+   */
+  BufferStats GetStats() const {
+    BufferStats stats;
+    stats.underruns = underruns_.load(std::memory_order_relaxed);
+    stats.forced_writes = forced_writes_.load(std::memory_order_relaxed);
+    stats.dropped_frames = dropped_frames_.load(std::memory_order_relaxed);
+    stats.high_water = high_water_.load(std::memory_order_relaxed);
+    stats.low_water = low_water_.load(std::memory_order_relaxed);
+    stats.writes = 0;
+    for (int i = 0; i < BufferStats::FILL_BUCKETS; i++) {
+      stats.fill_histogram[i] = fill_histogram_[i].load(std::memory_order_relaxed);
+      stats.writes += stats.fill_histogram[i];
+    }
+
+    return stats;
+  }
+
+  uint32_t GetHistoryFrames() const {
+    return history_capacity_ / channel_count_;
+  }
+
   uint32_t GetMaximumWriteSize() {
     std::lock_guard<std::mutex> lock(write_lock_);
     UpdateWriterThread();
@@ -373,32 +708,39 @@ class AudioBufferSPSC {
   }
 
   uint32_t Size() const {
-    uint32_t size = shared_write_.load(std::memory_order_acquire);
-    size -= shared_read_.load(std::memory_order_acquire);
-    return MaskInclusive(size);
+    uint64_t read = shared_read_.load(std::memory_order_acquire);
+    return static_cast<uint32_t>(shared_write_.load(std::memory_order_acquire) - read);
   }
 
   uint32_t Empty() const {
-    uint32_t write = shared_write_.load(std::memory_order_acquire);
-    return (write == shared_read_.load(std::memory_order_acquire));
+    uint64_t read = shared_read_.load(std::memory_order_acquire);
+    return (shared_write_.load(std::memory_order_acquire) == read);
   }
 
   uint32_t Capacity() const {
     return buffer_capacity_;
   }
 
-  uint32_t GetItemsRead() const {
-    return read_marker_.load(std::memory_order_acq_rel);
+  uint64_t GetItemsRead() const {
+    return read_marker_.load(std::memory_order_acquire);
   }
 
   int GetChannelCount() const {
     return channel_count_;
   }
 
+  BufferLayout GetLayout() const {
+    return layout_;
+  }
+
   ~AudioBufferSPSC() {
-    delete[] buffer_;
-    delete[] readzone_;
+    STORAGE_POLICY::Deallocate(buffer_, StorageBytes());
+    if (readzone_ != nullptr) {
+      AlignedStorage::Deallocate(readzone_, sizeof(BUFFER_UNIT) * readzone_capacity_);
+    }
     delete[] channelzone_;
+    delete[] reader_planes_;
+    delete[] writer_planes_;
   }
 
   void operator=(const AudioBufferSPSC& other) = delete;
@@ -406,65 +748,251 @@ class AudioBufferSPSC {
 
  private:
   const int channel_count_; // number of channels -- used for synchronization of r/w ops
+  const BufferLayout layout_;       // how samples are arranged in buffer_
+  const uint32_t frame_capacity_;   // max number of frames in the buffer (length of a plane)
+  const uint32_t history_capacity_; // samples behind the read head which are kept around
   
   const uint32_t buffer_capacity_;  // max capacity of the buffer
-  BUFFER_UNIT* buffer_;   // pointer to internal buffer
+  STORAGE_UNIT* buffer_;   // pointer to internal buffer
+  ring_cursors* cursors_;  // just past the samples, in the same allocation
 
   BUFFER_UNIT* readzone_;   // read space which can be read/modified by read thread
+  uint32_t readzone_capacity_;  // grown on demand, so compact storage stays compact
   BUFFER_UNIT** channelzone_; // space allocated for per-channel pointers
+  STORAGE_UNIT** reader_planes_;  // scratch plane pointers for the read thread
+  STORAGE_UNIT** writer_planes_;  // scratch plane pointers for the write thread
 
   pc_marker reader_thread_;
-  std::atomic_uint32_t shared_read_;  // shared ptr for syncing read val
-  std::atomic_uint64_t read_marker_;  // tracks number of samples read thus far
+  std::atomic_uint64_t& shared_read_;  // cursors_->read
+  std::atomic_uint64_t& read_marker_;  // cursors_->read_marker
   std::mutex read_lock_;
+  bool single_consumer_ = false;  // see SetSingleConsumer
+
+  // stats owned by the read thread
+  std::atomic_uint64_t underruns_{0};
   
   char CACHE_BUSTER[64];  // yall is playn -_-
 
   pc_marker writer_thread_;
-  std::atomic_uint32_t shared_write_;   // shared ptr for syncing write val
+  std::atomic_uint64_t& shared_write_;  // cursors_->write
   std::mutex write_lock_;
 
-  uint32_t Mask(uint32_t input) const {
-    return input & (buffer_capacity_ - 1);
+  // stats owned by the write thread
+  std::atomic_uint64_t forced_writes_{0};
+  std::atomic_uint64_t dropped_frames_{0};
+  std::atomic_uint32_t high_water_{0};
+  std::atomic_uint32_t low_water_{UINT32_MAX};
+  std::atomic_uint64_t fill_histogram_[BufferStats::FILL_BUCKETS] = {};
+
+  /**
+   *  Increments a counter which only one thread writes to -- plain load and store,
+   *  no need for an atomic RMW.
+   */
+  template <typename T>
+  static void Bump(std::atomic<T>& counter, T amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
   }
 
-  uint32_t MaskInclusive(uint32_t input) const {
-    uint32_t masked_input = Mask(input);
-    if (input != 0 && masked_input == 0) {
-      // multiple of capacity
-      return buffer_capacity_;
+  void RecordUnderrun() {
+    Bump(underruns_);
+  }
+
+  /**
+   *  Samples the fill level on the way into a write of `count` samples. Write thread only.
+   */
+  void RecordFill(uint32_t count) {
+    uint64_t read = shared_read_.load(std::memory_order_relaxed);
+    uint32_t fill = static_cast<uint32_t>(writer_thread_.position - read);
+
+    int bucket = static_cast<int>((static_cast<uint64_t>(fill) * BufferStats::FILL_BUCKETS) / buffer_capacity_);
+    Bump(fill_histogram_[bucket < BufferStats::FILL_BUCKETS ? bucket : BufferStats::FILL_BUCKETS - 1]);
+
+    // the ring starts out empty -- that's not worth reporting
+    if (read > 0 && fill < low_water_.load(std::memory_order_relaxed)) {
+      low_water_.store(fill, std::memory_order_relaxed);
+    }
+
+    if (fill + count > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(fill + count, std::memory_order_relaxed);
     }
+  }
+
+  // samples, rounded up so that the cursors which follow them are aligned
+  size_t SampleBytes() const {
+    return (sizeof(STORAGE_UNIT) * buffer_capacity_ + alignof(ring_cursors) - 1) & ~(alignof(ring_cursors) - 1);
+  }
 
-    return masked_input;
+  size_t StorageBytes() const {
+    return SampleBytes() + sizeof(ring_cursors);
   }
 
   /**
-   * Mask the input to a range of 2 * the buffer length.
-   * 
-   * Arguments:
-   *  - input, the value we are masking.
-   * 
-   * Returns:
-   *  - masked value
-   */ 
-  uint32_t MaskTwo(uint32_t input) const {
-    return input & ((buffer_capacity_ << 1) - 1);
+   *  Maps an absolute position onto an index in the buffer.
+   *  Capacity is only a power of two for 1, 2, 4... channels, so this can't be a bitmask.
+   */
+  uint32_t Mask(uint64_t input) const {
+    return static_cast<uint32_t>(input % buffer_capacity_);
+  }
+
+  /**
+   *  Takes read_lock_, unless the reader has promised it is the only one to move the read head.
+   */
+  std::unique_lock<std::mutex> LockReader() {
+    if (single_consumer_) {
+      return std::unique_lock<std::mutex>(read_lock_, std::defer_lock);
+    }
+
+    return std::unique_lock<std::mutex>(read_lock_);
   }
 
   void UpdateReaderThread() {
-    uint32_t pos = shared_write_.load(std::memory_order_acquire);
-    reader_thread_.safesize = MaskInclusive(pos - reader_thread_.position);
+    uint64_t pos = shared_write_.load(std::memory_order_acquire);
+    reader_thread_.safesize = static_cast<uint32_t>(pos - reader_thread_.position);
   }
 
   void UpdateWriterThread() {
-    uint32_t pos = shared_read_.load(std::memory_order_acquire);
-    writer_thread_.safesize = buffer_capacity_ - MaskInclusive(writer_thread_.position - pos);
+    uint64_t pos = shared_read_.load(std::memory_order_acquire);
+    // keep our hands off of the history window
+    pos = (pos > history_capacity_ ? pos - history_capacity_ : 0);
+    writer_thread_.safesize = buffer_capacity_ - static_cast<uint32_t>(writer_thread_.position - pos);
   }
   
-  void RefreshChannelZone() {
-    int per_channel_capacity = (buffer_capacity_ / channel_count_);
+  /**
+   *  Ensures that the readzone can hold at least `count` samples.
+   */
+  void ReserveReadzone(uint32_t count) {
+    if (readzone_capacity_ < count) {
+      if (readzone_ != nullptr) {
+        AlignedStorage::Deallocate(readzone_, sizeof(BUFFER_UNIT) * readzone_capacity_);
+      }
+
+      readzone_capacity_ = (count < buffer_capacity_ / 2 ? count * 2 : buffer_capacity_);
+      readzone_ = static_cast<BUFFER_UNIT*>(AlignedStorage::Allocate(sizeof(BUFFER_UNIT) * readzone_capacity_));
+    }
+  }
+
+  /**
+   *  Points channelzone_ at room for `frames` frames per channel in the readzone.
+   */
+  void RefreshChannelZone(uint32_t frames) {
+    // always hand out valid pointers, even for empty reads
+    ReserveReadzone((frames > 0 ? frames : 1) * channel_count_);
+    for (int i = 0; i < channel_count_; i++) {
+      channelzone_[i] = readzone_ + (i * frames);
+    }
+  }
+
+  /**
+   *  Maps a masked sample position onto its index in buffer_.
+   */
+  uint32_t StorageIndex(uint32_t pos) const {
+    if (layout_ == BufferLayout::INTERLEAVED) {
+      return pos;
+    }
+
+    return (pos % channel_count_) * frame_capacity_ + (pos / channel_count_);
+  }
+
+  /**
+   *  Points `planes` at frame `frame` of each channel's region. Planar only.
+   */
+  template <typename T>
+  void SetPlanes(T** planes, uint32_t frame) const {
+    for (int i = 0; i < channel_count_; i++) {
+      planes[i] = buffer_ + (i * frame_capacity_) + frame;
+    }
+  }
+
+  /**
+   *  Copies `count` samples starting at masked position `start` to `dest`, interleaved.
+   */
+  void CopyOut(uint32_t start, BUFFER_UNIT* dest, uint32_t count) {
+    if (layout_ == BufferLayout::INTERLEAVED) {
+      uint32_t first = Min(count, buffer_capacity_ - start);
+      kernels::Convert(buffer_ + start, dest, first);
+      kernels::Convert(buffer_, dest + first, count - first);
+      return;
+    }
+
+    uint32_t frames = count / channel_count_;
+    uint32_t frame = start / channel_count_;
+    uint32_t first = Min(frames, frame_capacity_ - frame);
+
+    SetPlanes(reader_planes_, frame);
+    kernels::Interleave(reader_planes_, dest, channel_count_, first);
+    if (first < frames) {
+      SetPlanes(reader_planes_, 0);
+      kernels::Interleave(reader_planes_, dest + first * channel_count_, channel_count_, frames - first);
+    }
+
+    // trailing partial frame
+    for (uint32_t i = frames * channel_count_; i < count; i++) {
+      dest[i] = kernels::ConvertSample<STORAGE_UNIT, BUFFER_UNIT>(
+        buffer_[StorageIndex(Mask(static_cast<uint64_t>(start) + i))]);
+    }
+  }
+
+  /**
+   *  Copies `count` interleaved samples from `data` into the buffer at masked position `start`.
+   */
+  template <typename INPUT_UNIT>
+  void CopyIn(uint32_t start, const INPUT_UNIT* data, uint32_t count) {
+    if (layout_ == BufferLayout::INTERLEAVED) {
+      uint32_t first = Min(count, buffer_capacity_ - start);
+      kernels::Convert(data, buffer_ + start, first);
+      kernels::Convert(data + first, buffer_, count - first);
+      return;
+    }
+
+    uint32_t frames = count / channel_count_;
+    uint32_t frame = start / channel_count_;
+    uint32_t first = Min(frames, frame_capacity_ - frame);
+
+    SetPlanes(writer_planes_, frame);
+    kernels::Deinterleave(data, writer_planes_, channel_count_, first);
+    if (first < frames) {
+      SetPlanes(writer_planes_, 0);
+      kernels::Deinterleave(data + first * channel_count_, writer_planes_, channel_count_, frames - first);
+    }
+
+    for (uint32_t i = frames * channel_count_; i < count; i++) {
+      buffer_[StorageIndex(Mask(static_cast<uint64_t>(start) + i))] =
+        kernels::ConvertSample<INPUT_UNIT, STORAGE_UNIT>(data[i]);
+    }
+  }
+
+  /**
+   *  Copies `frames` frames per channel, starting at masked position `start`, into readzone_,
+   *  and points channelzone_ at them.
+   */
+  void CopyChunked(uint32_t start, uint32_t frames) {
+    uint32_t frame = start / channel_count_;
+    uint32_t first = Min(frames, frame_capacity_ - frame);
+
+    RefreshChannelZone(frames);
+
+    if (layout_ == BufferLayout::INTERLEAVED) {
+      kernels::Deinterleave(buffer_ + start, channelzone_, channel_count_, first);
+      if (first < frames) {
+        // shift the output along temporarily for the wrapped part
+        for (int i = 0; i < channel_count_; i++) {
+          channelzone_[i] += first;
+        }
+
+        kernels::Deinterleave(buffer_, channelzone_, channel_count_, frames - first);
+
+        for (int i = 0; i < channel_count_; i++) {
+          channelzone_[i] -= first;
+        }
+      }
+
+      return;
+    }
+
     for (int i = 0; i < channel_count_; i++) {
-      channelzone_[i] = readzone_ + (i * per_channel_capacity);
+      const STORAGE_UNIT* plane = buffer_ + (i * frame_capacity_);
+      kernels::Convert(plane + frame, channelzone_[i], first);
+      kernels::Convert(plane, channelzone_[i] + first, frames - first);
     }
   }
 
@@ -0,0 +1,104 @@
+#ifndef BLOCK_TIMELINE_H_
+#define BLOCK_TIMELINE_H_
+
+#include "audiohandlers/Seqlock.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/**
+ *  Metadata attached to one block of audio.
+ *  Times are in seconds on the steady clock (see BlockTimeline::Now), so that they
+ *  can be compared against one another and against the reader's own clock.
+ */
+struct BlockStamp {
+  uint64_t frame;      // absolute frame number of the block's first frame
+  uint32_t frames;     // number of frames in the block
+  double decode_time;  // when the block was decoded -- negative if unknown
+  double dac_time;     // when the block's first frame reaches the DAC -- negative if unknown
+};
+
+/**
+ *  A fixed-size ring of BlockStamps, kept alongside an audio buffer so that readers can
+ *  tell exactly which frames were played, and when.
+ *
+ *  Single writer, any number of readers. Nothing locks: each slot is guarded by a Seqlock
+ *  whose sequence also names the block in it, so readers can tell a recycled slot from the
+ *  block they asked for, and move on.
+ *
+ *  Blocks must be published in order of frame, and of dac_time where it is known --
+ *  that's what makes them searchable.
+ */
+class BlockTimeline {
+ public:
+  /**
+   *  Creates a timeline which remembers the last 2^twopow blocks.
+   */
+  BlockTimeline(int twopow);
+
+  /**
+   *  Appends a block. Writer only.
+   */
+  void Publish(const BlockStamp& stamp);
+
+  /**
+   *  Finds the block which holds absolute frame `frame`.
+   *  Returns false if that frame is older than anything remembered, or not yet published.
+   */
+  bool FindFrame(uint64_t frame, BlockStamp* output) const;
+
+  /**
+   *  Finds the block playing at `time` (on the steady clock): the latest block
+   *  whose dac_time is no later than `time`. Only meaningful if every block has a dac_time.
+   *  Returns false if no remembered block had started playing by then.
+   */
+  bool FindTime(double time, BlockStamp* output) const;
+
+  /**
+   *  Copies out the most recently published block. Returns false if there isn't one.
+   */
+  bool Latest(BlockStamp* output) const;
+
+  /**
+   *  Returns the number of blocks published since construction (or the last Clear).
+   */
+  uint64_t GetPublished() const;
+
+  /**
+   *  Forgets every block. Writer only.
+   */
+  void Clear();
+
+  /**
+   *  Returns the current time on the steady clock, in seconds.
+   */
+  static double Now();
+
+ private:
+  struct Slot {
+    // 2 * index + 2 once block `index` is in the slot
+    Seqlock lock;
+    std::atomic<uint64_t> frame;
+    std::atomic<uint32_t> frames;
+    std::atomic<double> decode_time;
+    std::atomic<double> dac_time;
+  };
+
+  // reads block `index` into output, failing if it has been (or is being) overwritten
+  bool Read(uint64_t index, BlockStamp* output) const;
+
+  // index of the last block for which `before` is true, searching the remembered blocks.
+  // `before` must be true for some prefix of the blocks and false for the rest
+  template <typename PREDICATE>
+  bool Search(PREDICATE before, BlockStamp* output) const;
+
+  const uint64_t capacity_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> published_;
+
+  // index of the first block since the last Clear
+  std::atomic<uint64_t> first_;
+};
+
+#endif  // BLOCK_TIMELINE_H_
@@ -0,0 +1,79 @@
+#ifndef CHANNEL_MATRIX_H_
+#define CHANNEL_MATRIX_H_
+
+#include "audiohandlers/SampleKernels.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Maps frames with one channel count onto another -- upmixing, downmixing, or just reordering --
+ *  as a matrix of gains from each input channel to each output channel.
+ *
+ *  The default matrices assume the input is laid out the way Vorbis orders its channels
+ *  (L, C, R, ... for 3 or more) and the output the way devices do (L, R, C, LFE, ...):
+ *    - channels the output has are passed straight through.
+ *    - mono goes to both front speakers.
+ *    - centre folds into left and right at -3dB, and so do surrounds the output is missing
+ *      (onto the surrounds it does have, if any).
+ *    - LFE is dropped unless the output has one.
+ *  Where that would let an output channel clip, the whole matrix is scaled down to unity.
+ *  Layouts past 8 channels just map channel n to channel n.
+ *
+ *  Applying the matrix is one pass over the input, converting from the storage type as it goes.
+ */
+class ChannelMatrix {
+ public:
+  /**
+   *  Builds the default matrix for mapping in_channels onto out_channels.
+   */
+  ChannelMatrix(int in_channels, int out_channels);
+
+  /**
+   *  Builds a matrix from explicit gains, row by row -- gains[o * in_channels + i] is the gain
+   *  from input channel i to output channel o.
+   */
+  ChannelMatrix(int in_channels, int out_channels, const std::vector<float>& gains);
+
+  /**
+   *  Maps `frames` interleaved frames from src onto dst.
+   *
+   *  Arguments:
+   *    - src, `frames * GetInputChannels()` samples.
+   *    - dst, room for `frames * GetOutputChannels()` samples.
+   */
+  template <typename S>
+  void Apply(const S* src, float* dst, uint32_t frames) const {
+    if (identity_) {
+      kernels::Convert(src, dst, static_cast<size_t>(frames) * in_channels_);
+    } else {
+      kernels::MatrixMix(src, dst, columns_.data(), stride_, in_channels_, out_channels_, frames);
+    }
+  }
+
+  /**
+   *  Returns the gain from input channel `in` to output channel `out`.
+   */
+  float GetGain(int out, int in) const;
+
+  int GetInputChannels() const;
+  int GetOutputChannels() const;
+
+  /**
+   *  True if Apply is a straight copy.
+   */
+  bool IsIdentity() const;
+
+ private:
+  // lays the gains out for MatrixMix
+  void SetGains(const std::vector<float>& gains);
+
+  int in_channels_;
+  int out_channels_;
+  size_t stride_;
+  bool identity_;
+
+  std::vector<float> columns_;
+};
+
+#endif  // CHANNEL_MATRIX_H_
@@ -0,0 +1,192 @@
+#ifndef CONSUMER_REGISTRY_H_
+#define CONSUMER_REGISTRY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ *  A set of consumers which one hot path needs to visit over and over, while
+ *  other threads occasionally add or drop entries.
+ *
+ *  RCU-style: readers walk an immutable snapshot (a flat array of raw pointers) published
+ *  through an atomic pointer, so the read path takes no lock and touches no reference counts.
+ *  Every change copies the snapshot, swaps in the copy, and retires the old one -- retired
+ *  snapshots are freed once no reader could still be inside them.
+ *
+ *  The registry holds exactly one shared_ptr to each entry, on the writer side -- snapshots only
+ *  watch it, through weak_ptrs, so a snapshot lingering on the retired list never props an entry up.
+ *  Entries which nobody else holds any more are orphans, and Prune drops them. A dropped entry is
+ *  kept until the snapshots which still list it are freed, so it is never destroyed under a reader.
+ */
+template <typename T>
+class ConsumerRegistry {
+ public:
+  ConsumerRegistry() : current_(new Snapshot()), readers_(0) { }
+
+  /**
+   *  Adds an entry. Takes the writer lock and allocates.
+   */
+  void Add(std::shared_ptr<T> item) {
+    std::lock_guard<std::mutex> lock(writer_lock_);
+    Snapshot* next = new Snapshot(*current_.load(std::memory_order_relaxed));
+    next->items.push_back(item.get());
+    next->watchers.push_back(item);
+    owners_.push_back(std::move(item));
+    Publish(next);
+  }
+
+  /**
+   *  Drops every entry which is held only by the registry.
+   *  Returns the number of entries dropped. Takes the writer lock, and allocates if anything changes.
+   */
+  size_t Prune() {
+    return Filter([](const std::shared_ptr<T>& owner) { return owner.use_count() > 1; });
+  }
+
+  /**
+   *  Drops every entry for which drop(T*) returns true, whether or not anyone else still holds it.
+   *  Returns the number of entries dropped. Takes the writer lock, and allocates if anything changes.
+   */
+  template <typename PRED>
+  size_t RemoveIf(PRED&& drop) {
+    return Filter([&drop](const std::shared_ptr<T>& owner) { return !drop(owner.get()); });
+  }
+
+  /**
+   *  Calls func(T*) on every entry in the current snapshot. No lock, no allocation.
+   *  Entries added or dropped during the call may or may not be visited.
+   */
+  template <typename FUNC>
+  void ForEach(FUNC&& func) const {
+    const Snapshot* snapshot = Enter();
+    for (T* item : snapshot->items) {
+      func(item);
+    }
+
+    Exit();
+  }
+
+  /**
+   *  Returns true if some entry is held only by the registry -- i.e. Prune would drop something.
+   *  Lock-free, so the hot path can check cheaply and prune only when needed.
+   */
+  bool HasOrphans() const {
+    const Snapshot* snapshot = Enter();
+    bool result = false;
+    for (const auto& watcher : snapshot->watchers) {
+      result = result || (watcher.use_count() == 1);
+    }
+
+    Exit();
+    return result;
+  }
+
+  /**
+   *  Returns the number of entries in the current snapshot.
+   */
+  size_t Size() const {
+    const Snapshot* snapshot = Enter();
+    size_t result = snapshot->items.size();
+    Exit();
+    return result;
+  }
+
+  /**
+   *  Frees retired snapshots, if no reader is mid-walk. Changes do this on their own --
+   *  this is for catching up after a burst of changes which raced with readers.
+   */
+  void Reclaim() {
+    std::lock_guard<std::mutex> lock(writer_lock_);
+    Reclaim_Locked();
+  }
+
+  ConsumerRegistry(const ConsumerRegistry&) = delete;
+  void operator=(const ConsumerRegistry&) = delete;
+
+  /**
+   *  No reader may still be inside the registry.
+   */
+  ~ConsumerRegistry() {
+    delete current_.load(std::memory_order_relaxed);
+    for (Snapshot* snapshot : retired_) {
+      delete snapshot;
+    }
+  }
+
+ private:
+  struct Snapshot {
+    std::vector<T*> items;                   // what readers walk
+    std::vector<std::weak_ptr<T>> watchers;  // for counting owners without becoming one, parallel to items
+  };
+
+  // the reader count goes up before the snapshot is loaded, and the writer checks it after the swap --
+  // both seq_cst, so if the writer sees zero, any later reader must see the new snapshot
+  const Snapshot* Enter() const {
+    readers_.fetch_add(1, std::memory_order_seq_cst);
+    return current_.load(std::memory_order_seq_cst);
+  }
+
+  void Exit() const {
+    readers_.fetch_sub(1, std::memory_order_release);
+  }
+
+  // rebuilds the current snapshot from the entries for which keep(owner) is true
+  template <typename PRED>
+  size_t Filter(PRED&& keep) {
+    std::lock_guard<std::mutex> lock(writer_lock_);
+    Snapshot* next = new Snapshot();
+    std::vector<std::shared_ptr<T>> kept;
+    for (auto& owner : owners_) {
+      if (keep(owner)) {
+        next->items.push_back(owner.get());
+        next->watchers.push_back(owner);
+        kept.push_back(std::move(owner));
+      } else {
+        // the old snapshot may still be walked -- free it along with that
+        retired_owners_.push_back(std::move(owner));
+      }
+    }
+
+    size_t dropped = owners_.size() - kept.size();
+    owners_ = std::move(kept);
+    if (dropped == 0) {
+      delete next;
+      Reclaim_Locked();
+    } else {
+      Publish(next);
+    }
+
+    return dropped;
+  }
+
+  void Publish(Snapshot* next) {
+    retired_.push_back(current_.exchange(next, std::memory_order_seq_cst));
+    Reclaim_Locked();
+  }
+
+  void Reclaim_Locked() {
+    if (retired_.empty() || readers_.load(std::memory_order_seq_cst) != 0) {
+      return;
+    }
+
+    for (Snapshot* snapshot : retired_) {
+      delete snapshot;
+    }
+
+    retired_.clear();
+    retired_owners_.clear();
+  }
+
+  std::atomic<Snapshot*> current_;
+  mutable std::atomic<uint32_t> readers_;
+
+  std::mutex writer_lock_;
+  std::vector<Snapshot*> retired_;  // swapped out, but possibly still being walked
+  std::vector<std::shared_ptr<T>> owners_;          // the registry's reference to each entry, parallel to the current snapshot
+  std::vector<std::shared_ptr<T>> retired_owners_;  // pruned, but possibly listed in a retired snapshot
+};
+
+#endif  // CONSUMER_REGISTRY_H_
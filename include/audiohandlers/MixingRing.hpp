@@ -0,0 +1,182 @@
+#ifndef MIXING_RING_H_
+#define MIXING_RING_H_
+
+#include "audiohandlers/AudioBufferSPSC.hpp"
+#include "audiohandlers/ConsumerRegistry.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ *  One producer's lane into a MixingRing. Shared between the producer and the ring.
+ *
+ *  Blocks are tagged with the absolute output frame they should play at (see MixingRing::GetMixFrame).
+ *  Only one thread may push to a given source -- give each decoder its own.
+ */
+class MixSource {
+ public:
+  /**
+   *  Queues interleaved frames, the first of which plays at output frame `frame`.
+   *  A gap after the previous push is filled with silence, and frames overlapping
+   *  ones already queued are discarded.
+   *
+   *  Arguments:
+   *    - frame, the output frame at which data[0] should play.
+   *    - data, `frames * channel_count` interleaved samples.
+   *    - frames, the number of frames in data.
+   *
+   *  Returns:
+   *    - the number of frames consumed from data. Less than `frames` if the lane is full --
+   *      push the rest (at frame + the return value) once the mixer catches up.
+   */
+  uint32_t Push(uint64_t frame, const float* data, uint32_t frames);
+
+  /**
+   *  Queues frames directly after the previous push (or at the current mix frame, if this is the first).
+   */
+  uint32_t Push(const float* data, uint32_t frames);
+
+  void SetGain(float gain);
+  float GetGain() const;
+
+  /**
+   *  Marks the source as finished. The ring lets go of it once its queued frames have played.
+   */
+  void Close();
+
+  /**
+   *  Returns the output frame following the last frame queued, or the current mix frame
+   *  if nothing has been pushed yet.
+   */
+  uint64_t GetEndFrame() const;
+
+  /**
+   *  Returns the number of frames which arrived after the mixer had passed them.
+   *  They are discarded without being heard.
+   */
+  uint64_t GetLateFrames() const;
+
+  /**
+   *  Returns the number of mixes which ran short on this source, after it had started.
+   */
+  uint64_t GetUnderruns() const;
+
+  int GetChannelCount() const;
+
+ private:
+  friend class MixingRing;
+
+  static constexpr uint64_t NO_ORIGIN = UINT64_MAX;
+  static constexpr uint32_t SILENCE_FRAMES = 512;
+
+  MixSource(std::shared_ptr<const std::atomic<uint64_t>> mix_frame, int twopow, int channel_count, float gain);
+
+  // consumer only -- accumulates output frames [start, start + frames) into output
+  void MixInto(float* output, uint64_t start, uint32_t frames);
+
+  // true once closed, and everything queued has been consumed
+  bool IsDrained() const;
+
+  // the ring's mix position -- shared, so that a producer may outlive the ring
+  std::shared_ptr<const std::atomic<uint64_t>> mix_frame_;
+  AudioBufferSPSC<float> lane_;
+  std::vector<float> silence_;
+
+  // output frame corresponding to frame 0 in the lane -- NO_ORIGIN until the first push
+  std::atomic<uint64_t> origin_;
+
+  // producer only
+  uint64_t next_frame_;
+
+  std::atomic<float> gain_;
+  std::atomic<bool> closed_;
+
+  // consumer only
+  std::atomic<uint64_t> late_frames_;
+  std::atomic<uint64_t> underruns_;
+};
+
+/**
+ *  Sums any number of producers into one interleaved output stream.
+ *
+ *  Each producer gets a MixSource with its own SPSC lane, so pushes never contend with one another.
+ *  The consumer (typically an audio callback) calls Mix, which sums every lane's frames for the
+ *  next block with their gains applied. Mix takes no lock and never allocates or frees: sources
+ *  are published through a ConsumerRegistry, drained ones are only let go by Collect, and each
+ *  lane is read by the mixer alone (see AudioBufferSPSC::SetSingleConsumer).
+ *
+ *  Latency is bounded by the lane size: a producer can never be more than 2^twopow frames ahead
+ *  of the mixer, and frames which show up after the mixer has passed them are dropped rather
+ *  than delaying everything else.
+ */
+class MixingRing {
+ public:
+  /**
+   *  Creates a new mixing ring.
+   *
+   *  Arguments:
+   *    - channel_count, the number of channels in each frame, for every source and the output.
+   *    - twopow, the size of each source's lane, as a power of two (in frames).
+   */
+  MixingRing(int channel_count, int twopow);
+
+  /**
+   *  Registers a new source. The caller's reference is the producer's handle --
+   *  the ring keeps its own until the source is closed and drained, and Collect runs.
+   *  Collects first. Not real-time safe.
+   */
+  std::shared_ptr<MixSource> CreateSource(float gain = 1.0f);
+
+  /**
+   *  Mixes the next `frames` frames from all sources into output, overwriting its contents.
+   *  Sources without data for part of the block contribute silence there.
+   *
+   *  Arguments:
+   *    - output, room for `frames * channel_count` interleaved samples.
+   *    - frames, the number of frames to produce.
+   *
+   *  Returns:
+   *    - the output frame at which the mixed block starts.
+   */
+  uint64_t Mix(float* output, uint32_t frames);
+
+  /**
+   *  As Mix, but adds the sources onto whatever output already holds -- for mixing on top of
+   *  another stream, without a scratch block to sum into.
+   */
+  uint64_t MixOnto(float* output, uint32_t frames);
+
+  /**
+   *  Returns the next output frame to be mixed.
+   */
+  uint64_t GetMixFrame() const;
+
+  /**
+   *  Lets go of sources which have closed and finished playing. Mix only flags them, so that
+   *  nothing is freed on the audio thread -- call this now and then from some other thread.
+   *
+   *  Returns:
+   *    - the number of sources let go.
+   */
+  size_t Collect();
+
+  /**
+   *  Returns the number of sources currently held by the ring. Collects first.
+   */
+  size_t GetSourceCount();
+
+  int GetChannelCount() const;
+
+ private:
+  const int channel_count_;
+  const int twopow_;
+
+  ConsumerRegistry<MixSource> sources_;
+  std::atomic<bool> drained_;   // raised by Mix once some source is drained
+
+  std::shared_ptr<std::atomic<uint64_t>> mix_frame_;
+};
+
+#endif  // MIXING_RING_H_
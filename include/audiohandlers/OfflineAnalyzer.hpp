@@ -0,0 +1,121 @@
+#ifndef OFFLINE_ANALYZER_H_
+#define OFFLINE_ANALYZER_H_
+
+#include "audioreaders/AudioReader.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ *  How the analyzer slices up the stream.
+ */
+struct AnalysisOptions {
+  uint32_t window = 2048;       // frames per analysis window -- a power of two, for the FFT
+  uint32_t hop = 1024;          // frames between the starts of successive windows
+  int bands = 16;               // log-spaced bands between min_frequency and nyquist
+  float min_frequency = 40.0f;  // bottom edge of the lowest band, in Hz
+};
+
+/**
+ *  The features of one window, mixed down to mono.
+ */
+struct AnalysisFrame {
+  uint64_t frame;         // the window's first frame
+  float rms;
+  float peak;
+  float zero_crossings;   // sign changes per frame
+  float centroid;         // spectral centroid, in Hz
+  float rolloff;          // frequency below which 85% of the energy lies, in Hz
+  float flux;             // how much louder the spectrum got since the last window
+  const float* bands;     // band levels in dB -- `bands` of them, only valid during the callback
+};
+
+/**
+ *  How long a run took, against how much audio went through it.
+ */
+struct AnalysisSummary {
+  uint64_t frames;
+  uint64_t windows;
+  double audio_seconds;
+  double elapsed_seconds;
+
+  /**
+   *  Seconds of audio analysed per second spent.
+   */
+  double GetRealtimeFactor() const;
+};
+
+/**
+ *  Runs the visualizer's analysis with no device and no window: audio goes in as fast as it can
+ *  be decoded, and features come out of every `hop` frames.
+ *
+ *  Each window is mixed to mono, and has its level measured in the time domain before being
+ *  Hann-windowed and transformed. The spectrum gives the centroid, rolloff, flux and band levels.
+ *
+ *  Single-threaded -- analyse several files at once with one analyzer each.
+ */
+class OfflineAnalyzer {
+ public:
+  typedef std::function<void(const AnalysisFrame&)> Sink;
+
+  /**
+   *  Returns a heap-allocated analyzer, or nullptr if the options don't make sense
+   *  (a window that isn't a power of two, a hop of 0 or longer than the window, no bands).
+   */
+  static OfflineAnalyzer* GetOfflineAnalyzer(int sample_rate, const AnalysisOptions& options = AnalysisOptions());
+
+  /**
+   *  Analyses `frames` interleaved frames, calling `sink` for every window they complete.
+   *  Frames left over are kept for the next call.
+   */
+  void Process(const float* samples, int channels, uint32_t frames, const Sink& sink);
+
+  /**
+   *  Reads `reader` from where it is to the end, analysing as it goes. A trailing partial
+   *  window is dropped.
+   */
+  AnalysisSummary Run(AudioReader* reader, const Sink& sink);
+
+  /**
+   *  Forgets any buffered frames and the previous spectrum, and starts counting frames from 0.
+   */
+  void Reset();
+
+  /**
+   *  Returns the edges of the bands, in Hz -- one more than there are bands.
+   */
+  const std::vector<float>& GetBandEdges() const;
+
+  const AnalysisOptions& GetOptions() const;
+
+ private:
+  OfflineAnalyzer(int sample_rate, const AnalysisOptions& options);
+
+  // analyses the window starting at mono_[offset]
+  void AnalyseWindow(size_t offset, const Sink& sink);
+
+  int sample_rate_;
+  AnalysisOptions options_;
+
+  // mono frames not yet analysed, and the frame number of mono_[0]
+  std::vector<float> mono_;
+  uint64_t mono_frame_;
+
+  std::vector<float> hann_;
+  float hann_gain_;
+  std::vector<float> band_edges_;
+  // first bin of each band -- bands_ + 1 entries
+  std::vector<uint32_t> band_bins_;
+
+  // scratch, sized once
+  std::vector<float> windowed_;
+  std::vector<float> real_;
+  std::vector<float> imag_;
+  std::vector<float> magnitude_;
+  std::vector<float> previous_;
+  std::vector<float> levels_;
+  bool has_previous_;
+};
+
+#endif  // OFFLINE_ANALYZER_H_
@@ -0,0 +1,87 @@
+#ifndef PLAYBACK_CLOCK_H_
+#define PLAYBACK_CLOCK_H_
+
+#include "audiohandlers/Seqlock.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ *  The last block handed to the device: `frames` frames starting at absolute frame `frame`,
+ *  the first of which reaches the DAC at `time` (seconds, on the steady clock -- see BlockTimeline::Now).
+ *  `rate` is the measured playback rate, in frames per second.
+ */
+struct ClockAnchor {
+  uint64_t frame;
+  uint32_t frames;
+  double time;
+  double rate;
+};
+
+/**
+ *  Answers "which frame is coming out of the speakers right now?".
+ *
+ *  The audio callback publishes an anchor for every block it plays, stamped with the time that
+ *  block reaches the DAC -- so output latency and callback buffering are already accounted for.
+ *  Readers take the latest anchor and extrapolate from it to the time they ask about.
+ *
+ *  Drift between the device's clock and ours is measured rather than assumed away: the rate
+ *  used for extrapolation is frames played over time elapsed since playback last started (or
+ *  last glitched), which settles on the device's real rate after a second or so.
+ *
+ *  One writer, any number of readers. Anchors are published through a seqlock: readers never
+ *  store to shared memory, and retry in the rare case the writer moves the anchor mid-read.
+ */
+class PlaybackClock {
+ public:
+  PlaybackClock();
+
+  /**
+   *  Forgets every anchor, and sets the nominal sample rate. Writer only.
+   */
+  void Reset(double sample_rate);
+
+  /**
+   *  Records a block handed to the device. Writer only -- wait-free.
+   *
+   *  Arguments:
+   *    - frame, the absolute frame number of the block's first frame.
+   *    - frames, the number of frames in the block.
+   *    - dac_time, when the block's first frame reaches the DAC, on the steady clock.
+   */
+  void Publish(uint64_t frame, uint32_t frames, double dac_time);
+
+  /**
+   *  Copies out the latest anchor. Returns false if nothing has been published since the last Reset.
+   */
+  bool GetAnchor(ClockAnchor* output) const;
+
+  /**
+   *  Returns the frame audible at `time` (on the steady clock), or -1 if nothing has played.
+   *  Never runs past the end of the last block published -- if the callback stops feeding the
+   *  device, the clock stops with it.
+   */
+  int64_t GetFrame(double time) const;
+
+  /**
+   *  Returns the frame audible now.
+   */
+  int64_t GetFrame() const;
+
+ private:
+  // guards the anchor
+  Seqlock lock_;
+  std::atomic<uint64_t> frame_;
+  std::atomic<uint32_t> frames_;
+  std::atomic<double> time_;
+  std::atomic<double> rate_;
+
+  // writer only -- where the current run of unbroken playback started, for measuring the rate
+  double nominal_rate_;
+  uint64_t base_frame_;
+  double base_time_;
+  uint64_t next_frame_;
+  double next_time_;
+};
+
+#endif  // PLAYBACK_CLOCK_H_
@@ -0,0 +1,154 @@
+#ifndef PLAYLIST_H_
+#define PLAYLIST_H_
+
+#include "audioreaders/AudioReader.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ *  A point in the output where one track hands over to the next.
+ */
+struct TrackSplice {
+  uint64_t frame;       // output frame at which the track's first frame plays
+  std::string file;     // the track which starts there
+};
+
+/**
+ *  Plays a queue of tracks back to back, as one continuous stream.
+ *
+ *  The playlist is itself an AudioReader, so a VorbisManager driving it keeps its PortAudio
+ *  stream open from the first track to the last -- there's no device to reopen between tracks,
+ *  and the last frame of one track is followed directly by the first frame of the next.
+ *
+ *  As soon as a track starts playing, a background thread opens the next one and decodes its
+ *  first `preload_seconds` into memory. The read which runs off the end of the current track
+ *  carries straight on into that buffer, so the handover never waits on opening a file or
+ *  priming a decoder -- reads come from the decode thread, which has a playback ring to keep
+ *  topped up, and openers may take a while (main's decodes whole tracks up front). The read
+ *  only waits if a track is shorter than the time it takes to open the one after it.
+ *
+ *  The first track sets the stream's format. Tracks at other sample rates are resampled to
+ *  match (see ResamplingReader), and tracks with a different channel count are skipped.
+ */
+class Playlist : public AudioReader {
+ public:
+  /**
+   *  Opens a track. Returns a heap-allocated reader, or nullptr if the file can't be played.
+   *  Called from the preload thread, so it must not touch anything the caller is using.
+   */
+  typedef std::function<AudioReader*(const std::string&)> Opener;
+
+  /**
+   *  Creates a playlist and opens its first playable track.
+   *
+   *  Arguments:
+   *    - files, the tracks to play, in order.
+   *    - opener, used to open each track. Defaults to VorbisReader::GetMappedVorbisReader.
+   *    - preload_seconds, how much of the next track is decoded ahead of the handover.
+   *
+   *  Returns:
+   *    - a heap-allocated playlist.
+   *    - nullptr if none of the files could be opened.
+   */
+  static Playlist* GetPlaylist(std::vector<std::string> files, Opener opener = nullptr, int preload_seconds = 5);
+
+  /**
+   *  Adds a track to the end of the queue. Safe to call while playing.
+   */
+  void Enqueue(std::string file);
+
+  /**
+   *  Returns every handover so far, starting with the first track at frame 0.
+   */
+  std::vector<TrackSplice> GetSplices();
+
+  /**
+   *  Returns the number of tracks still queued, not counting the current one.
+   */
+  size_t GetQueuedCount();
+
+  /**
+   *  Reads straight across track boundaries. Only returns short once the queue has run dry.
+   */
+  int GetSamplesInterleaved(int count, float* output) override;
+  int GetSampleRate() override;
+  int GetChannelCount() override;
+
+  /**
+   *  Seek(0) rewinds to the start of the playlist -- every track it has been given, in order,
+   *  finished or not -- so that VorbisManager can restart it like any other reader.
+   *  Any other position seeks within the current track.
+   *
+   *  Rewinding reopens the first track, and waits for a preload in flight. Not for the decode thread.
+   */
+  void Seek(int sample) override;
+
+  void operator=(const Playlist& rhs) = delete;
+  Playlist(const Playlist& other) = delete;
+  ~Playlist();
+
+ private:
+  /**
+   *  A track which has been opened, with the start of it decoded already.
+   */
+  struct Track {
+    std::unique_ptr<AudioReader> reader;
+    std::string file;
+    std::vector<float> head;    // the first frames of the track, interleaved
+    size_t head_offset;         // samples of head already handed out
+    int64_t length;             // in frames, or -1 if unknown
+    int64_t position;           // frames handed out so far
+  };
+
+  Playlist(std::unique_ptr<Track> first, Opener opener, int preload_seconds);
+
+  // pops tracks off the queue until one opens with a matching format -- nullptr if none do
+  std::unique_ptr<Track> OpenNext(bool decode_head);
+
+  // starts opening the next track on the preload thread, if it isn't already
+  void StartPreload();
+
+  // true while the preload thread is still opening the next track
+  bool IsPreloading() const;
+
+  // reaps the preload thread (normally long finished), and makes whatever it opened the current
+  // track -- or opens the next one here if it came up empty. Returns false if there was nothing left to play
+  bool Advance();
+
+  // puts every track back on the queue, behind the first. Returns true if the first track is
+  // still the current one, and only needs seeking back to its start
+  bool Rewind();
+
+  // reads from the current track, head first -- returns frames read
+  int ReadCurrent(int frames, float* output);
+
+  Opener opener_;
+  int channel_count_;
+  int sample_rate_;
+  uint32_t preload_frames_;
+
+  std::mutex queue_lock_;
+  std::deque<std::string> queue_;
+  std::vector<TrackSplice> splices_;
+  std::vector<std::string> files_;    // every track ever queued, in order -- for rewinding
+
+  // reader only
+  std::mutex read_lock_;
+  std::unique_ptr<Track> current_;
+  uint64_t frame_;
+
+  // filled by preload_thread_ -- only touched by the reader once preload_done_ is up
+  std::thread preload_thread_;
+  std::atomic<bool> preload_done_;
+  std::unique_ptr<Track> next_;
+};
+
+#endif  // PLAYLIST_H_
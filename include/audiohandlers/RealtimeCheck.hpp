@@ -0,0 +1,117 @@
+#ifndef REALTIME_CHECK_H_
+#define REALTIME_CHECK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/**
+ *  Debug instrumentation for code which must never block -- in practice, the audio callback.
+ *
+ *  Built with RTCHECK defined (`set(rtcheck ON)` in CMake), malloc/free, mutex locks and
+ *  writes are interposed for the whole program. Any which happen on a thread inside a
+ *  RealtimeScope are counted, and the first few are kept with a backtrace. Each outermost
+ *  scope's running time also goes into a histogram, for percentiles.
+ *
+ *  Without RTCHECK, RealtimeScope compiles to nothing and reports come back empty.
+ *  Interposing is glibc-only -- elsewhere, only the timings are collected.
+ */
+
+/**
+ *  What a real-time scope wasn't supposed to do.
+ */
+enum class RealtimeViolation {
+  ALLOCATION,   // malloc, calloc, realloc, free and friends (so new and delete as well)
+  LOCK,         // pthread_mutex_lock, and read/write locks
+  WRITE,        // write and fwrite -- where iostreams and printf end up
+  COUNT
+};
+
+/**
+ *  One violation, as it was caught.
+ */
+struct ViolationRecord {
+  static const int MAX_DEPTH = 24;
+
+  RealtimeViolation kind;
+  int depth;                    // frames in the backtrace
+  void* frames[MAX_DEPTH];
+};
+
+struct RealtimeReport {
+  bool enabled;                 // false if built without RTCHECK
+
+  uint64_t scopes;              // outermost scopes completed
+  double p50;                   // scope running times, in seconds
+  double p99;
+  double p999;
+  double max;
+
+  uint64_t violations[static_cast<int>(RealtimeViolation::COUNT)];  // counts, by kind
+  std::vector<ViolationRecord> records;                           // the first few, in order
+};
+
+class RealtimeCheck {
+ public:
+  /**
+   *  True if the program was built with the interposers in.
+   */
+  static bool IsEnabled();
+
+  /**
+   *  Returns everything caught since the start, or the last Reset.
+   */
+  static RealtimeReport GetReport();
+
+  /**
+   *  Forgets all violations and timings. Not safe while a scope is open elsewhere.
+   */
+  static void Reset();
+
+  /**
+   *  Prints a report, with symbolized backtraces, to `out`.
+   */
+  static void PrintReport(std::ostream& out);
+
+  // called by RealtimeScope
+  static void Enter();
+  static void Exit(double elapsed);
+};
+
+#ifdef RTCHECK
+
+/**
+ *  Marks the current thread as real-time until the scope closes.
+ *  Scopes nest -- only the outermost one is timed.
+ */
+class RealtimeScope {
+ public:
+  RealtimeScope() : start_(std::chrono::steady_clock::now()) {
+    RealtimeCheck::Enter();
+  }
+
+  ~RealtimeScope() {
+    RealtimeCheck::Exit(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+  }
+
+  RealtimeScope(const RealtimeScope& other) = delete;
+  RealtimeScope& operator=(const RealtimeScope& other) = delete;
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+};
+
+#else
+
+class RealtimeScope {
+ public:
+  RealtimeScope() {}
+
+  RealtimeScope(const RealtimeScope& other) = delete;
+  RealtimeScope& operator=(const RealtimeScope& other) = delete;
+};
+
+#endif  // RTCHECK
+
+#endif  // REALTIME_CHECK_H_
@@ -0,0 +1,85 @@
+#ifndef REFILL_SCHEDULER_H_
+#define REFILL_SCHEDULER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/**
+ *  Decides when the write thread should refill a playback ring, and by how much.
+ *
+ *  The audio callback reports each block it consumes (OnConsumed). That is wait-free: it updates
+ *  a couple of relaxed atomics, and raises a flag once the ring has drained below the watermark.
+ *  It never notifies -- waking another thread isn't something the audio thread should do.
+ *
+ *  The writer sleeps in Wait for a fixed timeout (or until Signal), then tops the ring up if it
+ *  is below the watermark. The watermark is a fixed fraction of the ring, so there is always most
+ *  of a ring's worth of cushion behind a late wakeup or a slow decode, and refills come in a few
+ *  big batches rather than one per callback. Refill sizes follow the callback's burst size (the
+ *  largest block it has asked for lately), so the ring is topped up in whole blocks.
+ */
+class RefillScheduler {
+ public:
+  /**
+   *  Arguments:
+   *    - capacity, the size of the ring in frames.
+   */
+  RefillScheduler(uint32_t capacity);
+
+  /**
+   *  Called by the consumer after each block. Wait-free.
+   *
+   *  Arguments:
+   *    - frames, the number of frames the consumer asked for.
+   *    - remaining, the number of frames left in the ring afterwards.
+   */
+  void OnConsumed(uint32_t frames, uint32_t remaining);
+
+  /**
+   *  Wakes the writer regardless of fill level (e.g. to shut it down).
+   */
+  void Signal();
+
+  /**
+   *  Blocks until Signal, or `timeout` passes -- the consumer never wakes the writer itself,
+   *  so the timeout is what paces refills.
+   *  Returns true if signalled, or if the consumer flagged the ring as low in the meantime.
+   */
+  bool Wait(std::chrono::milliseconds timeout);
+
+  /**
+   *  Returns the number of frames the writer should decode, given `free_frames` of room:
+   *  as much of the free space as divides into whole bursts, or 0 if there isn't a burst's worth.
+   */
+  uint32_t GetRefillFrames(uint32_t free_frames) const;
+
+  /**
+   *  Fill level, in frames, below which the writer should top the ring up.
+   */
+  uint32_t GetWatermark() const;
+
+  /**
+   *  The largest block the consumer has asked for lately, in frames (decays slowly).
+   */
+  uint32_t GetBurst() const;
+
+  /**
+   *  Number of times the consumer has flagged the ring as low.
+   */
+  uint64_t GetWakeups() const;
+
+ private:
+  const uint32_t capacity_;
+
+  // consumer owned
+  std::atomic<uint32_t> burst_;
+  std::atomic<uint64_t> wakeups_;
+
+  std::atomic<bool> pending_;
+  std::mutex wait_lock_;
+  std::condition_variable wait_cond_;
+};
+
+#endif  // REFILL_SCHEDULER_H_
@@ -0,0 +1,115 @@
+#ifndef RESAMPLER_H_
+#define RESAMPLER_H_
+
+#include <cstdint>
+#include <vector>
+
+/**
+ *  Streaming polyphase sample rate converter, for interleaved float frames.
+ *
+ *  The ratio is reduced to out/in = L/M. Each output frame sits L/M of the way between input
+ *  frames at some phase p/L, and is the inner product of the `taps` input frames around it with
+ *  the filter for that phase -- a windowed sinc, low-passed below the lower of the two Nyquist
+ *  frequencies. Every phase is computed up front, so the inner loop is just SIMD dot products.
+ *
+ *  When L is too large for one filter per phase (rates with no small common factor), the bank
+ *  holds MAX_PHASES evenly spaced filters and each output interpolates between its two
+ *  neighbours. Positions are still tracked exactly, so the ratio never drifts.
+ *
+ *  Output frame k lines up with input time k * M / L -- the filter's delay is absorbed by holding
+ *  back output until enough input has arrived, and Flush pushes out the remainder. Feeding F
+ *  frames and flushing produces exactly ceil(F * L / M) frames.
+ *
+ *  Nothing allocates after construction.
+ */
+class Resampler {
+ public:
+  static constexpr uint32_t MAX_PHASES = 512;
+
+  /**
+   *  Creates a new resampler.
+   *
+   *  Arguments:
+   *    - in_rate, the sample rate of the input.
+   *    - out_rate, the sample rate to convert to.
+   *    - channels, the number of channels per frame.
+   *    - taps, the length of each phase's filter. More taps give a sharper cutoff and cost
+   *      proportionally more. Rounded up to a multiple of 8.
+   *    - max_block, the most input frames processed in one pass. Longer inputs are split up.
+   */
+  Resampler(int in_rate, int out_rate, int channels, uint32_t taps = 64, uint32_t max_block = 1024);
+
+  /**
+   *  Converts a block of input.
+   *
+   *  Arguments:
+   *    - input, `frames * channels` interleaved samples. All of them are consumed.
+   *    - frames, the number of input frames.
+   *    - output, room for GetMaxOutput(frames) interleaved frames.
+   *
+   *  Returns:
+   *    - the number of frames written to output.
+   */
+  uint32_t Process(const float* input, uint32_t frames, float* output);
+
+  /**
+   *  Pushes out the frames still held back by the filter delay, as if the input were followed
+   *  by silence. Call once at the end of the stream. output needs room for GetMaxOutput(GetDelay()) frames.
+   */
+  uint32_t Flush(float* output);
+
+  /**
+   *  Forgets all input, so the next Process starts a fresh stream.
+   */
+  void Reset();
+
+  /**
+   *  Returns the most frames a call to Process with `frames` input frames can produce.
+   */
+  uint32_t GetMaxOutput(uint32_t frames) const;
+
+  /**
+   *  Returns the number of input frames held back before output for them can be produced.
+   */
+  uint32_t GetDelay() const;
+
+  int GetChannelCount() const;
+
+  /**
+   *  Returns the reduced ratio: output rate = input rate * GetUpFactor() / GetDownFactor().
+   */
+  uint32_t GetUpFactor() const;
+  uint32_t GetDownFactor() const;
+
+ private:
+  // converts one chunk of at most max_block_ frames
+  uint32_t ProcessChunk(const float* input, uint32_t frames, float* output);
+
+  // fills in the filter bank
+  void DesignFilters(double cutoff);
+
+  int channels_;
+  uint32_t taps_;
+  uint32_t max_block_;
+
+  // reduced ratio -- output advances by step_ / up_ input frames per frame
+  uint32_t up_;
+  uint32_t step_;
+
+  // phases in the bank -- equal to up_ unless that's more than MAX_PHASES
+  uint32_t phases_;
+
+  // (phases_ + 1) filters of taps_ coefficients, reversed so they line up with the input
+  // the extra filter is phase 0 shifted by a frame, for interpolating past the last phase
+  std::vector<float> bank_;
+
+  // per channel: taps_ - 1 frames of history, then the current chunk
+  std::vector<std::vector<float>> work_;
+  std::vector<float*> work_input_;
+
+  // next output's position: input frame position_ of the current chunk, plus phase_ / up_
+  int64_t position_;
+  uint32_t phase_;
+};
+
+#endif  // RESAMPLER_H_
@@ -0,0 +1,88 @@
+#ifndef RING_DECODER_H_
+#define RING_DECODER_H_
+
+#include "audiohandlers/AudioBufferSPSC.hpp"
+#include "audioreaders/AudioReader.hpp"
+
+#include <type_traits>
+#include <vector>
+
+/**
+ *  Helpers which decode straight into a ring's free space, so that each sample is copied
+ *  exactly once on its way in: from the decoder's output into ring memory.
+ *
+ *  Interleaved rings take the reader's interleaved output (float or int16, matching storage).
+ *  Planar float rings take GetSamplesPlanar, so no interleave happens at all.
+ */
+
+/**
+ *  Decodes into a region handed out by AudioBufferSPSC::Reserve, without committing it.
+ *  Returns the number of frames decoded -- less than region.length if the stream ended.
+ */
+template <typename S>
+uint32_t DecodeToRegion(AudioReader* reader, const WriteRegion<S>& region) {
+  int channels = region.channel_count_;
+  uint32_t decoded = 0;
+  std::vector<S*> planes(region.planar_ ? channels : 0);
+
+  for (int part = 0; part < 2; part++) {
+    uint32_t len = region.Length(part);
+    if (len == 0) {
+      break;
+    }
+
+    int read = 0;
+    if (!region.planar_) {
+      read = reader->GetSamplesInterleaved(static_cast<int>(len) * channels, region.Data(0, part));
+    } else {
+      for (int c = 0; c < channels; c++) {
+        planes[c] = region.Data(c, part);
+      }
+
+      if constexpr (std::is_same_v<S, float>) {
+        read = reader->GetSamplesPlanar(static_cast<int>(len), planes.data());
+      } else {
+        // readers only decode planar to float -- stage small chunks of interleaved samples instead
+        S scratch[1024];
+        int chunk = 1024 / channels;
+        uint32_t done = 0;
+        while (done < len) {
+          int want = static_cast<int>(len - done < static_cast<uint32_t>(chunk) ? len - done : chunk);
+          int got = reader->GetSamplesInterleaved(want * channels, scratch);
+          kernels::Deinterleave(scratch, planes.data(), channels, static_cast<uint32_t>(got));
+          for (S*& plane : planes) {
+            plane += got;
+          }
+
+          done += got;
+          if (got < want) {
+            break;
+          }
+        }
+
+        read = static_cast<int>(done);
+      }
+    }
+
+    decoded += read;
+    if (static_cast<uint32_t>(read) < len) {
+      break;
+    }
+  }
+
+  return decoded;
+}
+
+/**
+ *  Reserves up to `framecount` frames in buf, decodes into them and commits the result.
+ *  Returns the number of frames written -- fewer than asked if the ring is full or the stream ends.
+ */
+template <typename B, typename S, typename P>
+uint32_t DecodeToRing(AudioReader* reader, AudioBufferSPSC<B, S, P>* buf, uint32_t framecount) {
+  WriteRegion<S> region = buf->Reserve(framecount);
+  uint32_t decoded = DecodeToRegion(reader, region);
+  buf->Commit(decoded);
+  return decoded;
+}
+
+#endif  // RING_DECODER_H_
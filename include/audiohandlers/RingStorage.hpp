@@ -0,0 +1,155 @@
+#ifndef RING_STORAGE_H_
+#define RING_STORAGE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RING_STORAGE_MMAP
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/**
+ *  Storage policies for AudioBufferSPSC's sample memory.
+ *
+ *  The allocation holds the samples, followed by the ring's cursors.
+ *  A policy is a type with two static functions:
+ *    - void* Allocate(size_t bytes), returning zeroed memory aligned to at least 64 bytes
+ *      (throws std::bad_alloc on failure).
+ *    - void Deallocate(void* ptr, size_t bytes), given the same byte count.
+ */
+
+/**
+ *  Default: cache-line aligned heap memory. Planes and frames line up with SIMD loads,
+ *  and the ring never shares a line with anything else.
+ */
+struct AlignedStorage {
+  static constexpr size_t ALIGNMENT = 64;
+
+  static void* Allocate(size_t bytes) {
+    // round up -- aligned allocators want whole multiples of the alignment
+    bytes = (bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    void* result;
+#if defined(_WIN32)
+    result = _aligned_malloc(bytes, ALIGNMENT);
+#else
+    if (posix_memalign(&result, ALIGNMENT, bytes) != 0) {
+      result = nullptr;
+    }
+#endif
+    if (result == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    std::fill(static_cast<char*>(result), static_cast<char*>(result) + bytes, 0);
+    return result;
+  }
+
+  static void Deallocate(void* ptr, size_t bytes) {
+#if defined(_WIN32)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+};
+
+/**
+ *  Backs the ring with huge pages, for multi-second rings where 4K pages mean
+ *  thousands of TLB entries per pass.
+ *
+ *  Tries explicit huge pages (MAP_HUGETLB) first. Those need pages reserved by the admin,
+ *  so otherwise it falls back to a 2MB-aligned mapping advised for transparent huge pages.
+ *  Where mmap isn't available this is just AlignedStorage.
+ */
+struct HugePageStorage {
+  static constexpr size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+  static void* Allocate(size_t bytes) {
+#if defined(RING_STORAGE_MMAP)
+    size_t length = RoundUp(bytes);
+    void* result = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    result = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (result != MAP_FAILED) {
+      return result;
+    }
+
+    // over-allocate, then trim so the mapping starts on a huge page boundary
+    char* raw = static_cast<char*>(mmap(nullptr, length + HUGE_PAGE, PROT_READ | PROT_WRITE,
+                                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (raw == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+
+    char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(raw) + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1));
+    if (aligned > raw) {
+      munmap(raw, aligned - raw);
+    }
+
+    size_t tail = (raw + length + HUGE_PAGE) - (aligned + length);
+    if (tail > 0) {
+      munmap(aligned + length, tail);
+    }
+
+#if defined(MADV_HUGEPAGE)
+    madvise(aligned, length, MADV_HUGEPAGE);
+#endif
+    return aligned;
+#else
+    return AlignedStorage::Allocate(bytes);
+#endif
+  }
+
+  static void Deallocate(void* ptr, size_t bytes) {
+#if defined(RING_STORAGE_MMAP)
+    munmap(ptr, RoundUp(bytes));
+#else
+    AlignedStorage::Deallocate(ptr, bytes);
+#endif
+  }
+
+ private:
+  static size_t RoundUp(size_t bytes) {
+    return (bytes + HUGE_PAGE - 1) & ~(HUGE_PAGE - 1);
+  }
+};
+
+/**
+ *  Places the ring in an anonymous shared mapping, so that a process forked after the ring
+ *  is created (e.g. an out-of-process analysis worker) can read what the parent writes, or
+ *  vice versa. The samples and the read/write cursors both live in the mapping.
+ *
+ *  One process writes and one reads, as usual. The locks and stats stay per-process, so
+ *  Force_Write and Clear -- which move the other side's cursor -- aren't safe across processes.
+ *  Where mmap isn't available this is just AlignedStorage.
+ */
+struct SharedStorage {
+  static void* Allocate(size_t bytes) {
+#if defined(RING_STORAGE_MMAP)
+    void* result = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (result == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+
+    return result;
+#else
+    return AlignedStorage::Allocate(bytes);
+#endif
+  }
+
+  static void Deallocate(void* ptr, size_t bytes) {
+#if defined(RING_STORAGE_MMAP)
+    munmap(ptr, bytes);
+#else
+    AlignedStorage::Deallocate(ptr, bytes);
+#endif
+  }
+};
+
+#endif  // RING_STORAGE_H_
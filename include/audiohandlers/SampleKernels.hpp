@@ -0,0 +1,448 @@
+#ifndef SAMPLE_KERNELS_H_
+#define SAMPLE_KERNELS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SAMPLE_KERNELS_SSE
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#define SAMPLE_KERNELS_NEON
+#include <arm_neon.h>
+#endif
+
+/**
+ *  Small copy kernels shared by the audio buffers.
+ *  float gets a vectorized path where one exists -- everything else falls back to scalar loops.
+ *
+ *  Kernels which take two sample types convert between them on the way through.
+ *  int16 <-> float conversions scale by 32768 (float samples live in [-1, 1]).
+ */
+namespace kernels {
+
+/**
+ *  Converts a single sample from S to D.
+ */
+template <typename S, typename D>
+inline D ConvertSample(S sample) {
+  if constexpr (std::is_same_v<S, D>) {
+    return sample;
+  } else if constexpr (std::is_same_v<S, int16_t> && std::is_same_v<D, float>) {
+    return sample * (1.0f / 32768.0f);
+  } else if constexpr (std::is_same_v<S, float> && std::is_same_v<D, int16_t>) {
+    float scaled = sample * 32768.0f;
+    scaled = (scaled > 32767.0f ? 32767.0f : (scaled < -32768.0f ? -32768.0f : scaled));
+    // round to nearest even, same as the vector paths
+    return static_cast<int16_t>(std::lrint(scaled));
+  } else {
+    return static_cast<D>(sample);
+  }
+}
+
+/**
+ *  Converts `count` contiguous samples from S to D.
+ */
+template <typename S, typename D>
+void Convert(const S* src, D* dst, size_t count) {
+  if constexpr (std::is_same_v<S, D>) {
+    std::copy(src, src + count, dst);
+    return;
+  }
+
+  size_t i = 0;
+  // where the 8-wide loops stop -- spelled out, so the compiler can bound the scalar tail
+  [[maybe_unused]] const size_t whole = count & ~static_cast<size_t>(7);
+#if defined(SAMPLE_KERNELS_SSE)
+  if constexpr (std::is_same_v<S, int16_t> && std::is_same_v<D, float>) {
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    for (; i < whole; i += 8) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+      // widen to 32 bits -- duplicate into the high half, then shift down to sign extend
+      __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+      __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+      _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+      _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+  } else if constexpr (std::is_same_v<S, float> && std::is_same_v<D, int16_t>) {
+    const __m128 scale = _mm_set1_ps(32768.0f);
+    for (; i < whole; i += 8) {
+      // cvtps rounds to nearest, packs saturates
+      __m128i lo = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+      __m128i hi = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(lo, hi));
+    }
+  }
+#elif defined(SAMPLE_KERNELS_NEON)
+  if constexpr (std::is_same_v<S, int16_t> && std::is_same_v<D, float>) {
+    for (; i < whole; i += 8) {
+      int16x8_t v = vld1q_s16(src + i);
+      vst1q_f32(dst + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.0f / 32768.0f));
+      vst1q_f32(dst + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.0f / 32768.0f));
+    }
+  } else if constexpr (std::is_same_v<S, float> && std::is_same_v<D, int16_t>) {
+    for (; i < whole; i += 8) {
+      int32x4_t lo = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src + i), 32768.0f));
+      int32x4_t hi = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(src + i + 4), 32768.0f));
+      vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi)));
+    }
+  }
+#endif
+
+  for (; i < count; i++) {
+    dst[i] = ConvertSample<S, D>(src[i]);
+  }
+}
+
+/**
+ *  Accumulates `count` samples of src into dst, scaled by gain (dst[i] += src[i] * gain).
+ */
+inline void MixAdd(const float* src, float* dst, float gain, size_t count) {
+  size_t i = 0;
+  [[maybe_unused]] const size_t whole = count & ~static_cast<size_t>(7);
+#if defined(SAMPLE_KERNELS_SSE)
+  const __m128 g = _mm_set1_ps(gain);
+  for (; i < whole; i += 8) {
+    __m128 lo = _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), g));
+    __m128 hi = _mm_add_ps(_mm_loadu_ps(dst + i + 4), _mm_mul_ps(_mm_loadu_ps(src + i + 4), g));
+    _mm_storeu_ps(dst + i, lo);
+    _mm_storeu_ps(dst + i + 4, hi);
+  }
+#elif defined(SAMPLE_KERNELS_NEON)
+  for (; i < whole; i += 8) {
+    vst1q_f32(dst + i, vmlaq_n_f32(vld1q_f32(dst + i), vld1q_f32(src + i), gain));
+    vst1q_f32(dst + i + 4, vmlaq_n_f32(vld1q_f32(dst + i + 4), vld1q_f32(src + i + 4), gain));
+  }
+#endif
+
+  for (; i < count; i++) {
+    dst[i] += src[i] * gain;
+  }
+}
+
+/**
+ *  Returns the inner product of `count` samples of a and b.
+ *  The vector paths sum in a different order to the scalar loop, so results may differ in the last bits.
+ */
+inline float Dot(const float* a, const float* b, size_t count) {
+  size_t i = 0;
+  [[maybe_unused]] const size_t whole = count & ~static_cast<size_t>(7);
+  float result = 0.0f;
+#if defined(SAMPLE_KERNELS_SSE)
+  // two accumulators, to keep the adds from waiting on one another
+  __m128 acc0 = _mm_setzero_ps();
+  __m128 acc1 = _mm_setzero_ps();
+  for (; i < whole; i += 8) {
+    acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+
+  __m128 acc = _mm_add_ps(acc0, acc1);
+  acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+  acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+  result = _mm_cvtss_f32(acc);
+#elif defined(SAMPLE_KERNELS_NEON)
+  float32x4_t acc0 = vdupq_n_f32(0.0f);
+  float32x4_t acc1 = vdupq_n_f32(0.0f);
+  for (; i < whole; i += 8) {
+    acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+
+  float32x4_t acc = vaddq_f32(acc0, acc1);
+  float32x2_t half = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+  result = vget_lane_f32(vpadd_f32(half, half), 0);
+#endif
+
+  for (; i < count; i++) {
+    result += a[i] * b[i];
+  }
+
+  return result;
+}
+
+/**
+ *  Multiplies every interleaved frame by a channel matrix, converting to float on the way:
+ *  output channel o of a frame is the sum over i of gain(o, i) * input channel i.
+ *
+ *  Arguments:
+ *    - src, `frames * in_channels` interleaved samples.
+ *    - dst, room for `frames * out_channels` interleaved samples.
+ *    - columns, the matrix stored by column -- the gains from input channel i to each output
+ *      start at columns + i * stride. stride is a multiple of 4, at least out_channels,
+ *      and the padding is zero.
+ */
+template <typename S>
+void MatrixMix(const S* src, float* dst, const float* columns, size_t stride,
+               int in_channels, int out_channels, uint32_t frames) {
+  uint32_t f = 0;
+
+  // mono and stereo sources get paths which work across four frames at a time
+  if constexpr (std::is_same_v<S, float>) {
+    const bool mono_up = (in_channels == 1 && out_channels == 2);
+    const bool stereo = (in_channels == 2 && out_channels <= 2);
+#if defined(SAMPLE_KERNELS_SSE)
+    if (mono_up) {
+      const __m128 g0 = _mm_set1_ps(columns[0]);
+      const __m128 g1 = _mm_set1_ps(columns[1]);
+      for (; f + 4 <= frames; f += 4) {
+        __m128 v = _mm_loadu_ps(src + f);
+        __m128 a = _mm_mul_ps(v, g0);
+        __m128 b = _mm_mul_ps(v, g1);
+        _mm_storeu_ps(dst + 2 * f, _mm_unpacklo_ps(a, b));
+        _mm_storeu_ps(dst + 2 * f + 4, _mm_unpackhi_ps(a, b));
+      }
+    } else if (stereo) {
+      const __m128 g00 = _mm_set1_ps(columns[0]);
+      const __m128 g01 = _mm_set1_ps(columns[stride]);
+      const __m128 g10 = _mm_set1_ps(columns[1]);
+      const __m128 g11 = _mm_set1_ps(columns[stride + 1]);
+      for (; f + 4 <= frames; f += 4) {
+        __m128 lo = _mm_loadu_ps(src + 2 * f);
+        __m128 hi = _mm_loadu_ps(src + 2 * f + 4);
+        __m128 left = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 a = _mm_add_ps(_mm_mul_ps(left, g00), _mm_mul_ps(right, g01));
+        if (out_channels == 1) {
+          _mm_storeu_ps(dst + f, a);
+        } else {
+          __m128 b = _mm_add_ps(_mm_mul_ps(left, g10), _mm_mul_ps(right, g11));
+          _mm_storeu_ps(dst + 2 * f, _mm_unpacklo_ps(a, b));
+          _mm_storeu_ps(dst + 2 * f + 4, _mm_unpackhi_ps(a, b));
+        }
+      }
+    }
+#elif defined(SAMPLE_KERNELS_NEON)
+    if (mono_up) {
+      for (; f + 4 <= frames; f += 4) {
+        float32x4_t v = vld1q_f32(src + f);
+        float32x4x2_t ab = { { vmulq_n_f32(v, columns[0]), vmulq_n_f32(v, columns[1]) } };
+        vst2q_f32(dst + 2 * f, ab);
+      }
+    } else if (stereo) {
+      for (; f + 4 <= frames; f += 4) {
+        float32x4x2_t lr = vld2q_f32(src + 2 * f);
+        float32x4_t a = vmlaq_n_f32(vmulq_n_f32(lr.val[0], columns[0]), lr.val[1], columns[stride]);
+        if (out_channels == 1) {
+          vst1q_f32(dst + f, a);
+        } else {
+          float32x4_t b = vmlaq_n_f32(vmulq_n_f32(lr.val[0], columns[1]), lr.val[1], columns[stride + 1]);
+          float32x4x2_t ab = { { a, b } };
+          vst2q_f32(dst + 2 * f, ab);
+        }
+      }
+    }
+#endif
+    if (mono_up || stereo) {
+      src += static_cast<size_t>(f) * in_channels;
+      dst += static_cast<size_t>(f) * out_channels;
+      frames -= f;
+      f = 0;
+    }
+  }
+
+#if defined(SAMPLE_KERNELS_SSE) || defined(SAMPLE_KERNELS_NEON)
+  // each input sample is broadcast and scaled by its column, so a frame is in_channels
+  // multiply-adds of one or two vectors. Frames store whole vectors -- lanes past out_channels
+  // spill into the following frames, which overwrite them. The last few, whose spill would
+  // run off the end of dst, are left to the scalar loop
+  if (stride <= 8) {
+    const bool wide = (stride == 8);
+    size_t total = static_cast<size_t>(frames) * out_channels;
+    uint32_t vector_frames = (total >= stride ? static_cast<uint32_t>((total - stride) / out_channels + 1) : 0);
+    for (; f < vector_frames; f++) {
+      const S* in = src + static_cast<size_t>(f) * in_channels;
+      float* out = dst + static_cast<size_t>(f) * out_channels;
+#if defined(SAMPLE_KERNELS_SSE)
+      __m128 lo = _mm_setzero_ps();
+      __m128 hi = _mm_setzero_ps();
+      for (int i = 0; i < in_channels; i++) {
+        __m128 x = _mm_set1_ps(ConvertSample<S, float>(in[i]));
+        lo = _mm_add_ps(lo, _mm_mul_ps(x, _mm_loadu_ps(columns + i * stride)));
+        if (wide) {
+          hi = _mm_add_ps(hi, _mm_mul_ps(x, _mm_loadu_ps(columns + i * stride + 4)));
+        }
+      }
+
+      _mm_storeu_ps(out, lo);
+      if (wide) {
+        _mm_storeu_ps(out + 4, hi);
+      }
+#else
+      float32x4_t lo = vdupq_n_f32(0.0f);
+      float32x4_t hi = vdupq_n_f32(0.0f);
+      for (int i = 0; i < in_channels; i++) {
+        float x = ConvertSample<S, float>(in[i]);
+        lo = vmlaq_n_f32(lo, vld1q_f32(columns + i * stride), x);
+        if (wide) {
+          hi = vmlaq_n_f32(hi, vld1q_f32(columns + i * stride + 4), x);
+        }
+      }
+
+      vst1q_f32(out, lo);
+      if (wide) {
+        vst1q_f32(out + 4, hi);
+      }
+#endif
+    }
+  }
+#endif
+
+  for (; f < frames; f++) {
+    const S* in = src + static_cast<size_t>(f) * in_channels;
+    float* out = dst + static_cast<size_t>(f) * out_channels;
+    for (int o = 0; o < out_channels; o++) {
+      float sum = 0.0f;
+      for (int i = 0; i < in_channels; i++) {
+        sum += ConvertSample<S, float>(in[i]) * columns[i * stride + o];
+      }
+
+      out[o] = sum;
+    }
+  }
+}
+
+/**
+ *  Splits interleaved frames into one buffer per channel.
+ *
+ *  Arguments:
+ *    - src, `frames * channels` interleaved samples.
+ *    - dst, an array of `channels` pointers, each with room for `frames` samples.
+ *    - channels, the number of channels in a frame.
+ *    - frames, the number of frames to split.
+ */
+template <typename S, typename D = S>
+void Deinterleave(const S* src, D* const* dst, int channels, uint32_t frames) {
+  if (channels == 1) {
+    Convert(src, dst[0], frames);
+    return;
+  }
+
+  uint32_t i = 0;
+  if constexpr (std::is_same_v<S, float> && std::is_same_v<D, float>) {
+#if defined(SAMPLE_KERNELS_SSE)
+    if (channels == 2) {
+      float* left = dst[0];
+      float* right = dst[1];
+      for (; i + 4 <= frames; i += 4) {
+        __m128 lo = _mm_loadu_ps(src + 2 * i);      // L0 R0 L1 R1
+        __m128 hi = _mm_loadu_ps(src + 2 * i + 4);  // L2 R2 L3 R3
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1)));
+      }
+    } else if (channels == 4) {
+      for (; i + 4 <= frames; i += 4) {
+        __m128 r0 = _mm_loadu_ps(src + 4 * i);
+        __m128 r1 = _mm_loadu_ps(src + 4 * i + 4);
+        __m128 r2 = _mm_loadu_ps(src + 4 * i + 8);
+        __m128 r3 = _mm_loadu_ps(src + 4 * i + 12);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(dst[0] + i, r0);
+        _mm_storeu_ps(dst[1] + i, r1);
+        _mm_storeu_ps(dst[2] + i, r2);
+        _mm_storeu_ps(dst[3] + i, r3);
+      }
+    }
+#elif defined(SAMPLE_KERNELS_NEON)
+    if (channels == 2) {
+      for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t lr = vld2q_f32(src + 2 * i);
+        vst1q_f32(dst[0] + i, lr.val[0]);
+        vst1q_f32(dst[1] + i, lr.val[1]);
+      }
+    } else if (channels == 4) {
+      for (; i + 4 <= frames; i += 4) {
+        float32x4x4_t q = vld4q_f32(src + 4 * i);
+        vst1q_f32(dst[0] + i, q.val[0]);
+        vst1q_f32(dst[1] + i, q.val[1]);
+        vst1q_f32(dst[2] + i, q.val[2]);
+        vst1q_f32(dst[3] + i, q.val[3]);
+      }
+    }
+#endif
+  }
+
+  // remainder, and layouts without a dedicated path
+  // walking one channel at a time keeps each destination stream sequential
+  for (int c = 0; c < channels; c++) {
+    const S* in = src + (static_cast<size_t>(i) * channels) + c;
+    D* out = dst[c];
+    for (uint32_t j = i; j < frames; j++) {
+      out[j] = ConvertSample<S, D>(*in);
+      in += channels;
+    }
+  }
+}
+
+/**
+ *  Inverse of Deinterleave: merges per-channel buffers into interleaved frames.
+ *
+ *  Arguments:
+ *    - src, an array of `channels` pointers, each containing `frames` samples.
+ *    - dst, room for `frames * channels` interleaved samples.
+ *    - channels, the number of channels in a frame.
+ *    - frames, the number of frames to merge.
+ */
+template <typename S, typename D = S>
+void Interleave(const S* const* src, D* dst, int channels, uint32_t frames) {
+  if (channels == 1) {
+    Convert(src[0], dst, frames);
+    return;
+  }
+
+  uint32_t i = 0;
+  if constexpr (std::is_same_v<S, float> && std::is_same_v<D, float>) {
+#if defined(SAMPLE_KERNELS_SSE)
+    if (channels == 2) {
+      const float* left = src[0];
+      const float* right = src[1];
+      for (; i + 4 <= frames; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(dst + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dst + 2 * i + 4, _mm_unpackhi_ps(l, r));
+      }
+    } else if (channels == 4) {
+      for (; i + 4 <= frames; i += 4) {
+        __m128 r0 = _mm_loadu_ps(src[0] + i);
+        __m128 r1 = _mm_loadu_ps(src[1] + i);
+        __m128 r2 = _mm_loadu_ps(src[2] + i);
+        __m128 r3 = _mm_loadu_ps(src[3] + i);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        _mm_storeu_ps(dst + 4 * i, r0);
+        _mm_storeu_ps(dst + 4 * i + 4, r1);
+        _mm_storeu_ps(dst + 4 * i + 8, r2);
+        _mm_storeu_ps(dst + 4 * i + 12, r3);
+      }
+    }
+#elif defined(SAMPLE_KERNELS_NEON)
+    if (channels == 2) {
+      for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t lr = { { vld1q_f32(src[0] + i), vld1q_f32(src[1] + i) } };
+        vst2q_f32(dst + 2 * i, lr);
+      }
+    } else if (channels == 4) {
+      for (; i + 4 <= frames; i += 4) {
+        float32x4x4_t q = { { vld1q_f32(src[0] + i), vld1q_f32(src[1] + i),
+                              vld1q_f32(src[2] + i), vld1q_f32(src[3] + i) } };
+        vst4q_f32(dst + 4 * i, q);
+      }
+    }
+#endif
+  }
+
+  for (int c = 0; c < channels; c++) {
+    const S* in = src[c];
+    D* out = dst + (static_cast<size_t>(i) * channels) + c;
+    for (uint32_t j = i; j < frames; j++) {
+      *out = ConvertSample<S, D>(in[j]);
+      out += channels;
+    }
+  }
+}
+
+}  // namespace kernels
+
+#endif  // SAMPLE_KERNELS_H_
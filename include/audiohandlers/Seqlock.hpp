@@ -0,0 +1,76 @@
+#ifndef SEQLOCK_H_
+#define SEQLOCK_H_
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ *  The sequence half of a seqlock, for a handful of fields written rarely and read often.
+ *
+ *  The guarded fields are atomics, stored and loaded relaxed inside Write and Read.
+ *  The sequence is odd while a writer is inside: readers never store to shared memory,
+ *  and retry (or give up) if it moves underneath them. The writer never waits on a reader.
+ *
+ *  One writer at a time -- callers with several writer threads must serialize them themselves.
+ */
+class Seqlock {
+ public:
+  Seqlock() : sequence_(0) { }
+
+  /**
+   *  Runs `store` with the sequence odd, then advances it to the next even value.
+   */
+  template <typename FUNC>
+  void Write(FUNC&& store) {
+    WriteAs(sequence_.load(std::memory_order_relaxed) + 2, store);
+  }
+
+  /**
+   *  As Write, but leaves the sequence at `next` -- which must be even, and greater than the
+   *  current sequence. For callers which encode something in the sequence, like an index.
+   */
+  template <typename FUNC>
+  void WriteAs(uint64_t next, FUNC&& store) {
+    // the fence keeps the field stores from floating above the odd sequence
+    sequence_.store(next - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    store();
+    sequence_.store(next, std::memory_order_release);
+  }
+
+  /**
+   *  Runs `load` until it sees the fields as one writer left them.
+   *  Spins while a writer is inside -- it's only a handful of stores.
+   */
+  template <typename FUNC>
+  void Read(FUNC&& load) const {
+    for (;;) {
+      uint64_t sequence = sequence_.load(std::memory_order_acquire);
+      if (!(sequence & 1) && TryRead(sequence, load)) {
+        return;
+      }
+    }
+  }
+
+  /**
+   *  Runs `load` once. Returns true if the sequence was `expected` throughout --
+   *  false if the fields have been (or are being) overwritten, in which case the loads mean nothing.
+   */
+  template <typename FUNC>
+  bool TryRead(uint64_t expected, FUNC&& load) const {
+    if (sequence_.load(std::memory_order_acquire) != expected) {
+      return false;
+    }
+
+    load();
+
+    // if the writer got in while we were copying, the sequence has moved on
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return (sequence_.load(std::memory_order_relaxed) == expected);
+  }
+
+ private:
+  std::atomic<uint64_t> sequence_;
+};
+
+#endif  // SEQLOCK_H_
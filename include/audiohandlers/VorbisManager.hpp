@@ -3,31 +3,65 @@
 
 #include "stb_vorbis.h"
 #include "audiohandlers/AudioBufferSPSC.hpp"
-#include "portaudio.h"
+#include "audiohandlers/BlockTimeline.hpp"
+#include "audiohandlers/ChannelMatrix.hpp"
+#include "audiohandlers/ConsumerRegistry.hpp"
+#include "audiohandlers/MixingRing.hpp"
+#include "audiohandlers/PlaybackClock.hpp"
+#include "audiohandlers/RefillScheduler.hpp"
+#include "audiohandlers/Seqlock.hpp"
 #include "audioreaders/AudioReader.hpp"
+#include "audiosinks/AudioSink.hpp"
+#include "threading/ThreadPolicy.hpp"
 
 #include <chrono>
-#include <functional>
-#include <list>
+#include <cstdint>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
 #include <thread>
 
+/**
+ *  Sample type held in the manager's rings. Building with `compact_samples` stores
+ *  16-bit samples instead, halving ring memory -- readers still receive floats.
+ */
+#ifdef COMPACT_SAMPLES
+typedef int16_t SampleStorage;
+#else
+typedef float SampleStorage;
+#endif
+
+typedef AudioBufferSPSC<float, SampleStorage> SampleBuffer;
+
+/**
+ *  Where playback is up to. Written rarely (when the stream starts), read every frame by
+ *  every consumer -- so reads go through a seqlock, and never store to shared memory.
+ */
 struct TimeInfo {
   TimeInfo();
   TimeInfo(int sample_rate);
 
   /**
-   *  Returns the current sample, or -1 if nothing is currently playing.
+   *  Reads the playhead from `clock` once it has heard from the device. Until then
+   *  (and without a clock) the playhead is extrapolated from the playback epoch.
+   */
+  TimeInfo(const PlaybackClock* clock);
+
+  /**
+   *  Returns the current sample (really the current frame), or -1 if nothing is currently playing.
+   *  64 bits wide so that long-running playback doesn't wrap.
    */ 
-  int GetCurrentSample() const;
+  int64_t GetCurrentSample() const;
 
   /**
    *  Returns true if our PA callback thread is running, false otherwise.
    */ 
   bool IsThreadRunning() const;
 
+  /**
+   *  Returns the current sample rate, or 0 if nothing has played.
+   */
+  int GetSampleRate() const;
+
   /**
    *  Modifies the current sample rate.
    */ 
@@ -38,14 +72,22 @@ struct TimeInfo {
    */ 
   void ResetEpoch();               
 
-  int sample_rate_;
-  std::chrono::time_point<std::chrono::high_resolution_clock> playback_epoch_;
  private:
-  // mutable keyword: allows for modification within a const function
-  // DO NOT OVERUSE!!!
-  // it is useful in this case because we need R/W lock access (and only lock access)
-  // within const function calls.
-  mutable std::shared_mutex info_lock_;
+  // publishes a new rate and epoch -- writers hold write_lock_
+  void Store(int sample_rate, double epoch);
+
+  // guards the rate and epoch together
+  Seqlock lock_;
+  std::atomic<int> sample_rate_;
+  // seconds on the steady clock -- see BlockTimeline::Now
+  std::atomic<double> playback_epoch_;
+
+  const PlaybackClock* clock_;
+
+  // writers only -- readers never touch it. SetSampleRate (manager's thread) and ResetEpoch
+  // (write thread) each keep the other's field, and the seqlock takes one writer at a time.
+  // VorbisManager's start handshake happens to order the two today; this keeps the setters safe without it
+  std::mutex write_lock_;
 };
 
 /**
@@ -59,25 +101,51 @@ class ReadOnlyBuffer {
    *  All of the following functions wrap the existing functionality for the AudioBufferSPSC class,
    *  with BUFFER_UNIT = float. Please refer to that class for documentation.
    */
-  ReadOnlyBuffer(std::shared_ptr<AudioBufferSPSC<float>> buffer, const TimeInfo* info);
+  ReadOnlyBuffer(std::shared_ptr<SampleBuffer> buffer, const TimeInfo* info);
 
   size_t Peek_Chunked(uint32_t framecount, float*** output);
 
   float** Read_Chunked(uint32_t framecount);
 
   // use the timeinfo here
-  int Synchronize_Chunked();
+  // both return the frame synchronized to, or -1 if nothing is playing
+  int64_t Synchronize_Chunked();
+
+  int64_t Synchronize_Chunked(float offset);
+
+  /**
+   *  Returns a view of `framecount` frames, starting `offset` seconds from the playhead.
+   *  Does not consume anything, so any number of analysis passes can look behind or
+   *  ahead of the playhead. See AudioBufferSPSC::View_Chunked.
+   *
+   *  The view is empty if nothing is playing.
+   */
+  FrameView<float, SampleStorage> View_Chunked(float offset, uint32_t framecount);
 
-  int Synchronize_Chunked(float offset);
+  /**
+   *  Returns a view of `framecount` frames starting at absolute frame `frame`.
+   */
+  FrameView<float, SampleStorage> View_Chunked(uint64_t frame, uint32_t framecount);
+
+  /**
+   *  Returns true if `frame` is still held -- check once finished with a view starting there.
+   */
+  bool IsRetained(uint64_t frame) const;
 
   int Size();
 
+  /**
+   *  Returns the counters for this reader's buffer -- dropped frames here mean the
+   *  reader fell too far behind the playhead.
+   */
+  BufferStats GetStats() const;
+
   ~ReadOnlyBuffer();
 
   const TimeInfo* info_;
 
  private:
-  std::shared_ptr<AudioBufferSPSC<float>> buffer_;
+  std::shared_ptr<SampleBuffer> buffer_;
 };
 
 /**
@@ -86,14 +154,22 @@ class ReadOnlyBuffer {
 struct ThreadPacket {
   std::atomic_flag thread_signal;     // flag raised by the thread
   std::atomic_flag vm_signal;         // flag raised by the manager
+  std::atomic<bool> sink_started{false};  // set by the thread before it signals, if its sink is playing
 };
 
 /**
- *  A packet of data sent to our PaCallback.
+ *  A packet of data sent to our SinkCallback.
  */ 
 struct CallbackPacket {
-  AudioBufferSPSC<float>* buf;      // the buffer which we are reading from (almost certainly the crit buffer)
-  std::atomic_flag callback_signal; // the signal used to communicate with the write thread
+  SampleBuffer* buf;      // the buffer which we are reading from (almost certainly the crit buffer)
+  const BlockTimeline* decoded;     // blocks as they were decoded, to look up decode times
+  BlockTimeline* played;            // blocks as they were handed to the DAC -- written by the callback
+  RefillScheduler* refill;          // told how much was consumed, so it can flag the ring as low
+  const ChannelMatrix* matrix;      // maps the buffer's channels onto the device's
+  PlaybackClock* clock;             // told which frames reach the DAC, and when
+  MixingRing* mixer;                // sources mixed on top of the stream, on the device's channels
+  std::atomic<bool> decoded_all;    // raised by the write thread once the reader runs out
+  std::atomic<bool> finished;       // raised by the callback once it has played everything
 };
 
 /**
@@ -109,12 +185,17 @@ class VorbisManager {
    *    - twopow, the log_2 of the size of our critical buffer. Must be greater than 1.
    *    - filename, the relative path associated with the desired file. Must point to a
    *      valid Ogg Vorbis file.
+   *    - output_channels, the number of channels to open the device with. The file's
+   *      channels are mapped onto them with a ChannelMatrix.
+   *    - sink, where the audio goes. The manager takes ownership. nullptr plays through
+   *      the default PortAudio device, which needs Pa_Initialize to have been called.
    * 
    *  Returns:
    *    - A pointer to a heap-allocated VorbisManager, if the inputs are valid.
    *    - Returns nullptr otherwise.
    */ 
-  static VorbisManager* GetVorbisManager(int twopow, AudioReader* reader);
+  static VorbisManager* GetVorbisManager(int twopow, AudioReader* reader, int output_channels = 2,
+                                         AudioSink* sink = nullptr);
 
   /**
    *  Creates a heap-allocated read-only buffer instance which can be used to get info
@@ -126,6 +207,14 @@ class VorbisManager {
    */ 
   ReadOnlyBuffer* CreateBufferInstance();
 
+  /**
+   *  Opens a lane which the callback mixes on top of the stream -- interleaved, with as many
+   *  channels as the device, at the stream's sample rate. Frames are numbered by the mixer's
+   *  own count of frames played (see MixingRing::GetMixFrame). Nothing is heard once the
+   *  stream has played out. Not real-time safe.
+   */
+  std::shared_ptr<MixSource> CreateMixSource(float gain = 1.0f);
+
   /**
    *  Starts up the write thread as well as the PortAudio callback, if they are not already running.
    *  
@@ -137,6 +226,12 @@ class VorbisManager {
    */ 
   void StopWriteThread();
 
+  /**
+   *  Sets how the write thread is scheduled. Takes effect from the next StartWriteThread --
+   *  see ThreadPolicy::GetReports for what it actually got.
+   */
+  void SetDecodePolicy(const ThreadPolicy& policy);
+
   /**
    *  Returns whether or not the write thread is running currently.
    */ 
@@ -147,6 +242,23 @@ class VorbisManager {
    */ 
   void ThreadWait();
 
+  /**
+   *  Returns the counters for the critical buffer. Underruns here are dropouts in playback.
+   *  Lock-free, so it is safe to poll from a monitoring thread.
+   */
+  BufferStats GetCriticalBufferStats() const;
+
+  /**
+   *  Returns the blocks handed to PortAudio, stamped with the time they reach the DAC.
+   *  Use FindTime to work out which frame is audible right now. Lock-free.
+   */
+  const BlockTimeline& GetPlaybackTimeline() const;
+
+  /**
+   *  Returns the blocks written by the decode thread, stamped with the time they were decoded.
+   */
+  const BlockTimeline& GetDecodeTimeline() const;
+
   /**
    *  Destructor for the VorbisManager.
    */ 
@@ -156,7 +268,7 @@ class VorbisManager {
  /**
   *   Private constructor called by GetVorbisManager.
   */ 
-  VorbisManager(int twopow, AudioReader* reader);
+  VorbisManager(int twopow, AudioReader* reader, int output_channels, AudioSink* sink);
 
   /**
    *  Function which actually does the reading/writing
@@ -164,47 +276,32 @@ class VorbisManager {
   void WriteThreadFn();
 
   /**
-   *  Prunes expired buffers and performs the call back function on all remaining ones.
-   */ 
-  void EraseOrCallback(const std::function<void(std::shared_ptr<AudioBufferSPSC<float>>)>&);
-
-  /**
-   *  Fills all buffers based on the write capacity of the critical buffer.
+   *  Decodes up to write_size samples and writes them to every buffer. Never writes more
+   *  than the critical buffer has room for.
    *  Returns whether or not there is more content in the vorbis stream to read.
-   *  
    */ 
   bool PopulateBuffers(unsigned int write_size);
 
   // handles cases where the buffer is full when we try to write more shit
-  static void FillBufferListCallback(std::shared_ptr<AudioBufferSPSC<float>> buf, float* input, int write_size);
+  static void FillBufferListCallback(SampleBuffer* buf, const SampleStorage* input, int write_size);
 
   /**
-   *  Callback passed to PortAudio
+   *  Callback passed to the sink -- see SinkCallback.
    */ 
-  static int PaCallback(  const void* inputBuffer,
-                          void* outputBuffer,
-                          unsigned long frameCount,
-                          const PaStreamCallbackTimeInfo* timeInfo,
-                          PaStreamCallbackFlags statusFlags,
-                          void* userData  );
+  static bool SinkCallback(float* output, uint32_t frames, double dac_time, void* userdata);
 
   // PRIVATE FIELDS
 
   /**
-   *  A list of weak pointers to our buffers. If a user is done with their buffer this
-   *  ensures that everything is cleared correctly while still allowing write access.
-   */ 
-  std::list<std::weak_ptr<AudioBufferSPSC<float>>> buffer_list_;
-
-  /**
-   *  The lock associated with all accesses to the buffer list.
+   *  The buffers handed out through CreateBufferInstance. The write thread walks these
+   *  without locking -- buffers whose ReadOnlyBuffer is gone are pruned as they're noticed.
    */ 
-  std::mutex buffer_list_lock_;
+  ConsumerRegistry<SampleBuffer> buffer_list_;
 
   /**
    *  The "critical" buffer which is used by our PortAudio callback function.
    */ 
-  AudioBufferSPSC<float>* critical_buffer_;
+  SampleBuffer* critical_buffer_;
 
   /**
    *  The sample rate of our vorbis file.
@@ -217,9 +314,33 @@ class VorbisManager {
   int channel_count_;
 
   /**
-   *  Used by the write thread as free space when reading via vorbis.
-   */ 
-  float* read_buffer_;
+   *  The number of channels the device is opened with, and the mapping onto them.
+   */
+  int output_channel_count_;
+  ChannelMatrix output_matrix_;
+
+  /**
+   *  Metadata for each block written to the critical buffer (by the write thread),
+   *  and for each block read from it (by the callback).
+   */
+  BlockTimeline decode_timeline_;
+  BlockTimeline playback_timeline_;
+
+  /**
+   *  Which frame is audible right now -- fed by the callback, read through `info`.
+   */
+  PlaybackClock clock_;
+
+  /**
+   *  Tells the write thread when the critical buffer needs topping up, and by how much.
+   */
+  RefillScheduler refill_;
+
+  /**
+   *  Sums the sources from CreateMixSource onto the callback's output. The write thread collects
+   *  the drained ones, so the callback never frees anything.
+   */
+  MixingRing mixer_;
 
   /**
    *  Thread object representing our write thread.
@@ -231,11 +352,21 @@ class VorbisManager {
    */ 
   std::atomic<bool> run_thread_;
 
+  /**
+   *  Applied by the write thread as it starts.
+   */
+  ThreadPolicy decode_policy_;
+
   /**
    *  Reads the audio :)
    */ 
   AudioReader* reader_;
 
+  /**
+   *  Plays it.
+   */
+  AudioSink* sink_;
+
   /**
    *  Two-power used to initialize additional buffers.
    */ 
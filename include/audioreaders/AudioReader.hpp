@@ -1,6 +1,10 @@
 #ifndef AUDIO_READER_H_
 #define AUDIO_READER_H_
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include "audiohandlers/SampleKernels.hpp"
 
 /**
  *  A common interface implemented so that we can read multiple types of files via a single unified interface
@@ -16,6 +20,63 @@ class AudioReader {
    */ 
   virtual int GetSamplesInterleaved(int count, float* output) = 0;
 
+  /**
+   *  Same as above, but outputs 16-bit samples.
+   *  By default this decodes to float and converts. Readers which can produce
+   *  16-bit samples natively should override it.
+   */
+  virtual int GetSamplesInterleaved(int count, int16_t* output) {
+    float scratch[1024];
+    int channels = GetChannelCount();
+    int chunk = (1024 / channels) * channels;
+    int frames_read = 0;
+    while (count > 0) {
+      int len = (count < chunk ? count : chunk);
+      int frames = GetSamplesInterleaved(len, scratch);
+      kernels::Convert(scratch, output, static_cast<size_t>(frames) * channels);
+      output += frames * channels;
+      frames_read += frames;
+      count -= len;
+      if (frames * channels < len) {
+        break;
+      }
+    }
+
+    return frames_read;
+  }
+
+  /**
+   *  Get some number of frames, with each channel in its own buffer.
+   *  By default this decodes interleaved and splits the result. Readers whose decoder
+   *  produces planar output should override it and skip the interleave.
+   *  @param frames - The number of frames we wish to read.
+   *  @param output - one pointer per channel, each with room for `frames` samples.
+   *  Returns the number of frames read.
+   */
+  virtual int GetSamplesPlanar(int frames, float* const* output) {
+    float scratch[1024];
+    int channels = GetChannelCount();
+    int chunk = 1024 / channels;
+    std::vector<float*> planes(output, output + channels);
+    int frames_read = 0;
+    while (frames > 0) {
+      int len = (frames < chunk ? frames : chunk);
+      int read = GetSamplesInterleaved(len * channels, scratch);
+      kernels::Deinterleave(scratch, planes.data(), channels, static_cast<uint32_t>(read));
+      for (float*& plane : planes) {
+        plane += read;
+      }
+
+      frames_read += read;
+      frames -= len;
+      if (read < len) {
+        break;
+      }
+    }
+
+    return frames_read;
+  }
+
   /**
    *  Returns the sample rate of the desired file.
    */ 
@@ -31,6 +92,15 @@ class AudioReader {
    *  but it seems like it would be a good idea to have :)
    */ 
   virtual void Seek(int sample) = 0;
+
+  /**
+   *  Returns the length of the stream in frames, or -1 if the reader can't tell.
+   */
+  virtual int64_t GetLength() {
+    return -1;
+  }
+
+  virtual ~AudioReader() {}
 };
 
 #endif  // AUDIO_READER_H_
\ No newline at end of file
@@ -0,0 +1,53 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ *  A whole file, read-only, in memory. Mapped where the OS can (so every reader of a
+ *  file shares its page cache, and nothing is copied), read into the heap elsewhere.
+ *
+ *  Mappings are advised as sequential, so the kernel reads ahead aggressively and drops
+ *  pages behind the cursor first. Prefetch asks for a range ahead of time.
+ */
+class MappedFile {
+ public:
+  /**
+   *  Maps `file`.
+   *
+   *  Returns:
+   *    - a heap-allocated MappedFile, or nullptr if the file can't be opened, or is empty.
+   */
+  static MappedFile* Open(const std::string& file);
+
+  const unsigned char* GetData() const;
+  size_t GetSize() const;
+
+  /**
+   *  True if the data is mapped, rather than a copy.
+   */
+  bool IsMapped() const;
+
+  /**
+   *  Hints that [offset, offset + length) is about to be read, so the kernel can start
+   *  paging it in. Clamped to the file. Does nothing for a copy.
+   */
+  void Prefetch(size_t offset, size_t length) const;
+
+  MappedFile(const MappedFile& other) = delete;
+  MappedFile& operator=(const MappedFile& other) = delete;
+  ~MappedFile();
+
+ private:
+  MappedFile();
+
+  const unsigned char* data_;
+  size_t size_;
+  bool mapped_;
+  std::vector<unsigned char> copy_;   // only if mapping isn't available
+};
+
+#endif  // MAPPED_FILE_H_
@@ -0,0 +1,81 @@
+#ifndef MEMORY_READER_H_
+#define MEMORY_READER_H_
+
+#include <audioreaders/AudioReader.hpp>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ *  Serves PCM which has already been decoded in full. Reads are just copies, so playback
+ *  never touches a decoder -- the cost is paid up front, and the whole track sits in memory
+ *  (about 21MB per minute of 44.1kHz stereo).
+ */
+class MemoryReader : public AudioReader {
+ public:
+  /**
+   *  Wraps already-decoded audio.
+   *
+   *  Arguments:
+   *    - samples, interleaved float samples. Its length should be a multiple of channels.
+   *    - channels, the number of channels in a frame.
+   *    - sample_rate, the sample rate of the audio.
+   */
+  MemoryReader(std::vector<float> samples, int channels, int sample_rate);
+
+  /**
+   *  Decodes an entire Ogg Vorbis file into memory, splitting the work across threads.
+   *
+   *  The stream is cut at Ogg page boundaries into one range per thread, and each thread
+   *  decodes its range with its own stb_vorbis instance, straight into its slice of the
+   *  output. Each instance starts by decoding the packet before its range, so the
+   *  slices line up with a sequential decode.
+   *
+   *  Arguments:
+   *    - file, the path to an Ogg Vorbis file.
+   *    - threads, the number of decode threads. 0 uses one per hardware thread.
+   *    - max_seconds, the longest stream to accept. 0 accepts anything.
+   *
+   *  Returns:
+   *    - a heap-allocated reader, positioned at the start of the stream.
+   *    - nullptr if the file can't be read, or is longer than max_seconds.
+   */
+  static MemoryReader* PreDecodeVorbis(std::string file, int threads = 0, int max_seconds = 0);
+
+  int GetSamplesInterleaved(int count, float* output) override;
+  int GetSamplesInterleaved(int count, int16_t* output) override;
+  int GetSamplesPlanar(int frames, float* const* output) override;
+  int GetSampleRate() override;
+  int GetChannelCount() override;
+  void Seek(int sample) override;
+  int64_t GetLength() override;
+
+  /**
+   *  Returns the decoded audio, interleaved.
+   */
+  const float* GetData() const;
+
+  /**
+   *  Returns the number of frames held.
+   */
+  uint64_t GetFrameCount() const;
+
+  void operator=(const MemoryReader& rhs) = delete;
+  MemoryReader(const MemoryReader& other) = delete;
+
+ private:
+  // claims up to `frames` frames from the read position -- returns the first frame claimed
+  uint64_t Advance(int& frames);
+
+  std::vector<float> samples_;
+  int channels_;
+  int sample_rate_;
+  uint64_t frame_count_;
+
+  uint64_t position_;
+  std::mutex read_lock_;
+};
+
+#endif  // MEMORY_READER_H_
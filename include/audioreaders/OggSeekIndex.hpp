@@ -0,0 +1,94 @@
+#ifndef OGG_SEEK_INDEX_H_
+#define OGG_SEEK_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ *  An Ogg page which finishes at least one packet: where it starts in the file, and its
+ *  granule position (for Vorbis, the frame count at the end of the page).
+ */
+struct OggPage {
+  uint64_t offset;
+  uint64_t granule;
+};
+
+/**
+ *  Every page of an Ogg stream, by granule position, so that a seek can go straight to the
+ *  page holding its target instead of bisecting the file.
+ *
+ *  Building one takes a single pass over the page headers -- bodies are skipped, so it reads
+ *  a small fraction of the file. It can be saved alongside the file (or in a cache directory)
+ *  and loaded next time; a saved index is only accepted if it still matches the file.
+ */
+class OggSeekIndex {
+ public:
+  /**
+   *  Indexes an Ogg stream held in memory. Returns nullptr if it has no pages.
+   */
+  static OggSeekIndex* Scan(const unsigned char* data, size_t size);
+
+  /**
+   *  Indexes an Ogg file. Returns nullptr if it can't be read, or has no pages.
+   */
+  static OggSeekIndex* Build(const std::string& file);
+
+  /**
+   *  Reads an index saved by Save. Returns nullptr if it can't be read, or no longer
+   *  matches `file` -- the file's size and a sample of its pages are checked.
+   */
+  static OggSeekIndex* Load(const std::string& index_file, const std::string& file);
+
+  /**
+   *  Loads the saved index for `file`, or builds one and saves it for next time.
+   *  Saving is best-effort -- a read-only directory just means building again later.
+   *
+   *  Arguments:
+   *    - file, the path to an Ogg file.
+   *    - cache_dir, where indices are kept. Empty keeps them next to the file.
+   *
+   *  Returns:
+   *    - a heap-allocated index, or nullptr if the file can't be indexed.
+   */
+  static OggSeekIndex* GetIndex(const std::string& file, const std::string& cache_dir = "");
+
+  /**
+   *  Returns where GetIndex keeps the index for `file`.
+   */
+  static std::string GetIndexPath(const std::string& file, const std::string& cache_dir = "");
+
+  /**
+   *  Writes the index to `index_file`. Returns false if it can't be written.
+   */
+  bool Save(const std::string& index_file) const;
+
+  /**
+   *  Finds the pages to search between for `frame`: the last page ending at least `margin`
+   *  frames before it, and the first page ending after it.
+   *
+   *  Arguments:
+   *    - frame, the frame being seeked to.
+   *    - margin, how far before the frame the left page has to end -- a decoder needs the
+   *      packet before its target, so this is at least one frame's worth of samples.
+   *    - left, set to the left page's offset, or 0 if the frame is within the first pages.
+   *    - right, set to the right page's offset, or the last page's if the frame is past it.
+   */
+  void FindPages(uint64_t frame, uint64_t margin, uint64_t* left, uint64_t* right) const;
+
+  const std::vector<OggPage>& GetPages() const;
+
+  /**
+   *  Returns the size of the indexed stream, in bytes.
+   */
+  uint64_t GetSize() const;
+
+ private:
+  OggSeekIndex(std::vector<OggPage> pages, uint64_t size);
+
+  std::vector<OggPage> pages_;
+  uint64_t size_;
+};
+
+#endif  // OGG_SEEK_INDEX_H_
@@ -0,0 +1,55 @@
+#ifndef RESAMPLING_READER_H_
+#define RESAMPLING_READER_H_
+
+#include <audioreaders/AudioReader.hpp>
+#include <audiohandlers/Resampler.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ *  Wraps another reader, converting it to a different sample rate on the fly.
+ *  Lets tracks of any rate share one output stream. See Resampler for the conversion itself.
+ *
+ *  Reads pull input in fixed-size blocks, and nothing allocates after construction.
+ */
+class ResamplingReader : public AudioReader {
+ public:
+  /**
+   *  Arguments:
+   *    - source, the reader to convert. Ownership passes to the ResamplingReader.
+   *    - out_rate, the sample rate to produce.
+   *    - taps, the resampler's filter length -- see Resampler.
+   */
+  ResamplingReader(AudioReader* source, int out_rate, uint32_t taps = 64);
+
+  int GetSamplesInterleaved(int count, float* output) override;
+  int GetSampleRate() override;
+  int GetChannelCount() override;
+
+  /**
+   *  Seeks to a frame at the output rate. The source lands on the input frame at or just before it.
+   */
+  void Seek(int sample) override;
+  int64_t GetLength() override;
+
+  void operator=(const ResamplingReader& rhs) = delete;
+  ResamplingReader(const ResamplingReader& other) = delete;
+
+ private:
+  std::unique_ptr<AudioReader> source_;
+  int out_rate_;
+  int channels_;
+  Resampler resampler_;
+
+  std::vector<float> input_;
+  std::vector<float> pending_;    // converted frames not handed out yet
+  size_t pending_offset_;         // in samples
+  size_t pending_size_;
+  bool flushed_;                  // the source has run dry, and the resampler has been flushed
+
+  std::mutex read_lock_;
+};
+
+#endif  // RESAMPLING_READER_H_
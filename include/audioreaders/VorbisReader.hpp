@@ -1,16 +1,37 @@
 #include <audioreaders/AudioReader.hpp>
+#include <audioreaders/MappedFile.hpp>
+#include <audioreaders/OggSeekIndex.hpp>
 #include <stb_vorbis.h>
 
+#include <memory>
 #include <mutex>
 
 class VorbisReader : public AudioReader {
  public:
   int GetSamplesInterleaved(int count, float* output) override;
+  int GetSamplesInterleaved(int count, int16_t* output) override;
+  int GetSamplesPlanar(int frames, float* const* output) override;
   int GetSampleRate() override;
   int GetChannelCount() override;
   void Seek(int sample) override;
+  int64_t GetLength() override;
   static VorbisReader* GetVorbisReader(std::string file);
 
+  /**
+   *  As GetVorbisReader, but seeks through a page index (see OggSeekIndex::GetIndex) --
+   *  each seek reads the page holding its target, rather than bisecting the file.
+   *  Falls back to unindexed seeking if the file can't be indexed.
+   */
+  static VorbisReader* GetIndexedVorbisReader(std::string file, std::string cache_dir = "");
+
+  /**
+   *  As GetVorbisReader, but decodes straight out of a read-only mapping of the file (see
+   *  MappedFile) -- no stdio reads or copies, and readers of the same file share its page
+   *  cache. The range ahead of the decode cursor is prefetched as it goes.
+   *  Falls back to GetVorbisReader if the file can't be mapped.
+   */
+  static VorbisReader* GetMappedVorbisReader(std::string file);
+
   void operator=(const VorbisReader& rhs) = delete;
   VorbisReader(const VorbisReader& other) = delete;
   ~VorbisReader();
@@ -18,7 +39,17 @@ class VorbisReader : public AudioReader {
 
  private:
   VorbisReader(stb_vorbis* file);
+
+  /**
+   *  Keeps a window ahead of the decode cursor paged in, if the file is mapped.
+   *  Call with read_lock_ held.
+   */
+  void PrefetchAhead();
+
   stb_vorbis* file_;
   stb_vorbis_info info_;
+  std::unique_ptr<OggSeekIndex> index_;
+  std::unique_ptr<MappedFile> mapping_;   // must outlive file_, if it reads from it
+  size_t prefetched_;                     // offset the prefetched window runs up to
   std::mutex read_lock_;
 };
\ No newline at end of file
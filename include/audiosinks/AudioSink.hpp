@@ -0,0 +1,54 @@
+#ifndef AUDIO_SINK_H_
+#define AUDIO_SINK_H_
+
+#include <cstdint>
+
+/**
+ *  Called by a sink whenever it wants more audio, on the sink's own thread.
+ *
+ *  Arguments:
+ *    - output, room for `frames` interleaved frames. Every sample must be written.
+ *    - frames, the number of frames wanted.
+ *    - dac_time, when output's first frame will be heard, in seconds on the steady clock
+ *      (see BlockTimeline::Now).
+ *    - userdata, as passed to Open.
+ *
+ *  Returns:
+ *    - true to keep going, false once there's nothing more to play -- the sink stops
+ *      calling, but keeps its resources until Stop or Close.
+ */
+typedef bool (*SinkCallback)(float* output, uint32_t frames, double dac_time, void* userdata);
+
+/**
+ *  Somewhere for audio to go. A sink pulls audio through its callback at its own pace --
+ *  a device's, a simulated clock's, or as fast as it can.
+ *
+ *  Lifecycle: Open, Start, (Stop, Start)*, Close. Stop and Close block until the callback
+ *  won't be called again.
+ */
+class AudioSink {
+ public:
+  /**
+   *  Prepares to play `channels` channels at `sample_rate`. Returns false if the sink can't.
+   */
+  virtual bool Open(int channels, int sample_rate, SinkCallback callback, void* userdata) = 0;
+
+  /**
+   *  Starts calling the callback. Returns false if the sink couldn't start.
+   */
+  virtual bool Start() = 0;
+
+  /**
+   *  Stops calling the callback.
+   */
+  virtual void Stop() = 0;
+
+  /**
+   *  Stops if need be, and releases whatever Open acquired.
+   */
+  virtual void Close() = 0;
+
+  virtual ~AudioSink() {}
+};
+
+#endif  // AUDIO_SINK_H_
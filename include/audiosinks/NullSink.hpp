@@ -0,0 +1,91 @@
+#ifndef NULL_SINK_H_
+#define NULL_SINK_H_
+
+#include "audiosinks/AudioSink.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+/**
+ *  How a software sink paces its callbacks.
+ */
+enum class SinkClock {
+  REALTIME,       // one block per block's worth of wall time, like a device
+  FREE_RUNNING    // back to back, as fast as the callback can fill them
+};
+
+/**
+ *  A sink with no device behind it: a thread calls back for fixed-size blocks and throws
+ *  them away. Realtime pacing stands in for a sound card; free-running measures how fast
+ *  the pipeline can go.
+ *
+ *  DAC times are the block's deadline plus `latency` when realtime. Free-running, they
+ *  follow the frames played rather than the wall clock -- block n is stamped
+ *  start + n * block_frames / sample_rate, however long it really took.
+ */
+class NullSink : public AudioSink {
+ public:
+  /**
+   *  Arguments:
+   *    - clock, how to pace the callbacks.
+   *    - block_frames, the frames asked for per callback.
+   *    - latency, seconds between a block's deadline and its DAC time (realtime only).
+   */
+  NullSink(SinkClock clock = SinkClock::REALTIME, uint32_t block_frames = 512, double latency = 0.0);
+
+  bool Open(int channels, int sample_rate, SinkCallback callback, void* userdata) override;
+  bool Start() override;
+  void Stop() override;
+  void Close() override;
+
+  /**
+   *  Returns the frames handed to the callback so far. Safe from any thread.
+   */
+  uint64_t GetFramesPlayed() const;
+
+  /**
+   *  True once the callback has asked to stop.
+   */
+  bool IsFinished() const;
+
+  ~NullSink();
+
+ protected:
+  /**
+   *  Called after Open succeeds, before the first block -- false fails the Open.
+   */
+  virtual bool OnOpen(int channels, int sample_rate);
+
+  /**
+   *  Called on the sink thread with every block the callback fills.
+   */
+  virtual void OnBlock(const float* data, uint32_t frames);
+
+  /**
+   *  Called by Close, once the sink thread has stopped.
+   */
+  virtual void OnClose();
+
+ private:
+  void ThreadFn();
+
+  SinkClock clock_;
+  uint32_t block_frames_;
+  double latency_;
+
+  int channels_;
+  int sample_rate_;
+  SinkCallback callback_;
+  void* userdata_;
+  bool open_;
+
+  std::vector<float> block_;
+  std::thread thread_;
+  std::atomic<bool> running_;
+  std::atomic<bool> finished_;
+  std::atomic<uint64_t> frames_played_;
+};
+
+#endif  // NULL_SINK_H_
@@ -0,0 +1,39 @@
+#ifndef PORT_AUDIO_SINK_H_
+#define PORT_AUDIO_SINK_H_
+
+#include "audiosinks/AudioSink.hpp"
+#include "portaudio.h"
+
+/**
+ *  Plays through the default output device. PortAudio must already be initialized
+ *  (Pa_Initialize), and stay that way until the sink is closed.
+ *
+ *  PortAudio reports times on the stream's own clock -- they're shifted onto the steady
+ *  clock before reaching the callback.
+ */
+class PortAudioSink : public AudioSink {
+ public:
+  PortAudioSink();
+
+  bool Open(int channels, int sample_rate, SinkCallback callback, void* userdata) override;
+  bool Start() override;
+  void Stop() override;
+  void Close() override;
+
+  ~PortAudioSink();
+
+ private:
+  static int PaCallback(  const void* input,
+                          void* output,
+                          unsigned long frameCount,
+                          const PaStreamCallbackTimeInfo* timeInfo,
+                          PaStreamCallbackFlags statusFlags,
+                          void* userData  );
+
+  PaStream* stream_;
+  bool started_;
+  SinkCallback callback_;
+  void* userdata_;
+};
+
+#endif  // PORT_AUDIO_SINK_H_
@@ -0,0 +1,36 @@
+#ifndef WAV_SINK_H_
+#define WAV_SINK_H_
+
+#include "audiosinks/NullSink.hpp"
+
+#include <cstdio>
+#include <string>
+
+/**
+ *  Records every block the callback produces to a 32-bit float WAV file, bit for bit.
+ *  Free-running by default, so a recording takes as long as the pipeline needs rather
+ *  than as long as the audio. The file is finished (its sizes filled in) on Close.
+ *
+ *  A free-running sink can outpace the decoder -- any underrun is recorded as the
+ *  silence the callback padded it with.
+ */
+class WavSink : public NullSink {
+ public:
+  WavSink(const std::string& path, SinkClock clock = SinkClock::FREE_RUNNING, uint32_t block_frames = 512);
+
+  ~WavSink();
+
+ protected:
+  bool OnOpen(int channels, int sample_rate) override;
+  void OnBlock(const float* data, uint32_t frames) override;
+  void OnClose() override;
+
+ private:
+  std::string path_;
+  FILE* file_;
+  int channels_;
+  int sample_rate_;
+  uint64_t data_bytes_;
+};
+
+#endif  // WAV_SINK_H_
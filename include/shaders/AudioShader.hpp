@@ -19,7 +19,7 @@ class AudioShader {
    *  sample_data: pointer to raw samples
    *  length: number of elements
    */ 
-  virtual void Render(GLFWwindow* window, float* sample_data, size_t length) = 0;
+  virtual void Render(GLFWwindow* window, const float* sample_data, size_t length) = 0;
 
   /**
    *  Returns name of all configurable inputs to the shader.
@@ -11,7 +11,7 @@
 class SimpleShader : public AudioShader {
  public:
   SimpleShader();
-  void Render(GLFWwindow* window, float* sample_data, size_t length) override;
+  void Render(GLFWwindow* window, const float* sample_data, size_t length) override;
   const std::string* GetParameterNames() override;
   void SetParameter(const std::string& param_name, std::any value) override;
   ~SimpleShader();
@@ -0,0 +1,95 @@
+#ifndef THREAD_POLICY_H_
+#define THREAD_POLICY_H_
+
+#include <string>
+#include <vector>
+
+/**
+ *  How the OS should schedule a thread.
+ */
+enum class SchedulingClass {
+  DEFAULT,    // whatever the thread inherited
+  NICE,       // timesharing, at a given nice level
+  FIFO,       // real-time, run until it blocks (SCHED_FIFO)
+  RR          // real-time, round-robin among equal priorities (SCHED_RR)
+};
+
+struct ThreadReport;
+
+/**
+ *  Scheduling class, priority and CPU affinity for one of our threads -- the decode
+ *  thread, analysis workers, the render thread.
+ *
+ *  Asking for more than the process is allowed degrades rather than fails: real-time
+ *  classes fall back to `fallback_nice`, then to the thread's current nice level, and
+ *  CPUs the process can't run on are dropped. Every Apply is recorded, with what the
+ *  thread actually ended up with, for GetReports.
+ *
+ *  Affinity and per-thread nice levels are Linux-only. Elsewhere only the real-time
+ *  classes are tried, and everything else is left alone.
+ */
+struct ThreadPolicy {
+  SchedulingClass scheduling = SchedulingClass::DEFAULT;
+
+  /**
+   *  1 (lowest) to 99 for FIFO and RR, -20 (highest) to 19 for NICE. Ignored for DEFAULT.
+   */
+  int priority = 0;
+
+  /**
+   *  Nice level to try if a real-time class is refused.
+   */
+  int fallback_nice = -10;
+
+  /**
+   *  CPUs the thread may run on -- empty for any.
+   */
+  std::vector<int> cpus;
+
+  /**
+   *  Parses a policy written as `class[:priority][@cpus]`, e.g. "fifo:20@2,3", "nice:-5",
+   *  "rr:10@0-3" or "default@1". Classes are default, nice, fifo and rr.
+   *
+   *  Returns false, leaving `output` alone, if the spec is malformed.
+   */
+  static bool Parse(const std::string& spec, ThreadPolicy* output);
+
+  /**
+   *  The inverse of Parse.
+   */
+  std::string ToString() const;
+
+  /**
+   *  Applies the policy to the calling thread, and records the result under `name`
+   *  (which also becomes the thread's name, where the OS keeps one).
+   */
+  ThreadReport Apply(const std::string& name) const;
+
+  /**
+   *  Reads back the calling thread's scheduling, priority and affinity.
+   */
+  static ThreadPolicy GetCurrent();
+
+  /**
+   *  Returns every Apply so far, oldest first. Threads which applied twice appear twice.
+   */
+  static std::vector<ThreadReport> GetReports();
+};
+
+/**
+ *  What a thread asked for, and what it got.
+ */
+struct ThreadReport {
+  std::string name;
+  ThreadPolicy requested;
+  ThreadPolicy effective;
+  bool degraded;        // true if effective falls short of requested
+  std::string note;     // why, if it did
+
+  /**
+   *  One line, e.g. "dingo-decode: nice:-10 (asked for fifo:20 -- fifo refused (...))".
+   */
+  std::string ToString() const;
+};
+
+#endif  // THREAD_POLICY_H_
@@ -0,0 +1,101 @@
+#include "audiohandlers/BlockTimeline.hpp"
+
+#include <chrono>
+
+BlockTimeline::BlockTimeline(int twopow) : capacity_(1ull << twopow),
+                                           slots_(new Slot[1ull << twopow]),
+                                           published_(0),
+                                           first_(0) { }
+
+void BlockTimeline::Publish(const BlockStamp& stamp) {
+  uint64_t index = published_.load(std::memory_order_relaxed);
+  Slot& slot = slots_[index & (capacity_ - 1)];
+
+  slot.lock.WriteAs(2 * index + 2, [&slot, &stamp] {
+    slot.frame.store(stamp.frame, std::memory_order_relaxed);
+    slot.frames.store(stamp.frames, std::memory_order_relaxed);
+    slot.decode_time.store(stamp.decode_time, std::memory_order_relaxed);
+    slot.dac_time.store(stamp.dac_time, std::memory_order_relaxed);
+  });
+
+  published_.store(index + 1, std::memory_order_release);
+}
+
+bool BlockTimeline::Read(uint64_t index, BlockStamp* output) const {
+  const Slot& slot = slots_[index & (capacity_ - 1)];
+  return slot.lock.TryRead(2 * index + 2, [&slot, output] {
+    output->frame = slot.frame.load(std::memory_order_relaxed);
+    output->frames = slot.frames.load(std::memory_order_relaxed);
+    output->decode_time = slot.decode_time.load(std::memory_order_relaxed);
+    output->dac_time = slot.dac_time.load(std::memory_order_relaxed);
+  });
+}
+
+template <typename PREDICATE>
+bool BlockTimeline::Search(PREDICATE before, BlockStamp* output) const {
+  uint64_t end = published_.load(std::memory_order_acquire);
+  uint64_t lo = (end > capacity_ ? end - capacity_ : 0);
+  uint64_t first = first_.load(std::memory_order_acquire);
+  lo = (lo > first ? lo : first);
+  uint64_t hi = end;
+
+  // invariant: blocks below lo are either overwritten or satisfy `before`,
+  // blocks at hi and above do not.
+  // the writer may overwrite the oldest blocks mid-search -- those count as too old.
+  bool found = false;
+  BlockStamp stamp;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    if (!Read(mid, &stamp) || before(stamp)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  // lo is the first block which does not satisfy `before` -- we want the one behind it
+  if (lo > first && Read(lo - 1, &stamp) && before(stamp)) {
+    *output = stamp;
+    found = true;
+  }
+
+  return found;
+}
+
+bool BlockTimeline::FindFrame(uint64_t frame, BlockStamp* output) const {
+  BlockStamp stamp;
+  if (!Search([frame](const BlockStamp& s) { return s.frame <= frame; }, &stamp)) {
+    return false;
+  }
+
+  if (frame >= stamp.frame + stamp.frames) {
+    // past the end of everything published
+    return false;
+  }
+
+  *output = stamp;
+  return true;
+}
+
+bool BlockTimeline::FindTime(double time, BlockStamp* output) const {
+  return Search([time](const BlockStamp& s) { return s.dac_time >= 0.0 && s.dac_time <= time; }, output);
+}
+
+bool BlockTimeline::Latest(BlockStamp* output) const {
+  uint64_t end = published_.load(std::memory_order_acquire);
+  return (end > first_.load(std::memory_order_acquire) && Read(end - 1, output));
+}
+
+uint64_t BlockTimeline::GetPublished() const {
+  return published_.load(std::memory_order_acquire) - first_.load(std::memory_order_acquire);
+}
+
+void BlockTimeline::Clear() {
+  // indices keep counting up, so stale slots can never be mistaken for new ones
+  first_.store(published_.load(std::memory_order_relaxed), std::memory_order_release);
+}
+
+double BlockTimeline::Now() {
+  std::chrono::duration<double> now = std::chrono::steady_clock::now().time_since_epoch();
+  return now.count();
+}
@@ -0,0 +1,176 @@
+#include "audiohandlers/ChannelMatrix.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+enum Speaker { FL, FR, FC, LFE, BL, BR, SL, SR, BC, NONE };
+
+// vorbis channel order, by channel count (see section 4.3.9 of the vorbis spec)
+const Speaker vorbis_layouts[8][8] = {
+  { FC },
+  { FL, FR },
+  { FL, FC, FR },
+  { FL, FR, BL, BR },
+  { FL, FC, FR, BL, BR },
+  { FL, FC, FR, BL, BR, LFE },
+  { FL, FC, FR, SL, SR, BC, LFE },
+  { FL, FC, FR, SL, SR, BL, BR, LFE }
+};
+
+// device (WAVE / SMPTE) channel order
+const Speaker device_layouts[8][8] = {
+  { FC },
+  { FL, FR },
+  { FL, FR, FC },
+  { FL, FR, BL, BR },
+  { FL, FR, FC, BL, BR },
+  { FL, FR, FC, LFE, BL, BR },
+  { FL, FR, FC, LFE, BC, SL, SR },
+  { FL, FR, FC, LFE, BL, BR, SL, SR }
+};
+
+// -3dB
+const float fold_gain = 0.70710678f;
+
+}  // namespace
+
+ChannelMatrix::ChannelMatrix(int in_channels, int out_channels)
+  : in_channels_(in_channels), out_channels_(out_channels) {
+  std::vector<float> gains(static_cast<size_t>(in_channels) * out_channels, 0.0f);
+  if (in_channels > 8 || out_channels > 8) {
+    for (int c = 0; c < std::min(in_channels, out_channels); c++) {
+      gains[c * in_channels + c] = 1.0f;
+    }
+
+    SetGains(gains);
+    return;
+  }
+
+  const Speaker* in_layout = vorbis_layouts[in_channels - 1];
+  const Speaker* out_layout = device_layouts[out_channels - 1];
+  auto find = [out_layout, out_channels](Speaker speaker) {
+    for (int o = 0; o < out_channels; o++) {
+      if (out_layout[o] == speaker) {
+        return o;
+      }
+    }
+
+    return -1;
+  };
+
+  // routes `speaker` onto output speakers `a` and `b` at `gain` -- false if the output has neither
+  auto route = [&](int in, Speaker a, Speaker b, float gain) {
+    int oa = find(a);
+    int ob = find(b);
+    if (oa >= 0) {
+      gains[oa * in_channels + in] += gain;
+    }
+
+    if (ob >= 0 && ob != oa) {
+      gains[ob * in_channels + in] += gain;
+    }
+
+    return (oa >= 0 || ob >= 0);
+  };
+
+  for (int in = 0; in < in_channels; in++) {
+    Speaker speaker = in_layout[in];
+    if (in_channels == 1) {
+      // mono plays at full level out of both fronts, or the centre if that's all there is
+      route(in, FL, FR, 1.0f) || route(in, FC, NONE, 1.0f);
+      continue;
+    }
+
+    int direct = find(speaker);
+    if (direct >= 0) {
+      gains[direct * in_channels + in] = 1.0f;
+      continue;
+    }
+
+    switch (speaker) {
+      case FL:
+      case FR:
+        // only a mono output lacks a front pair
+        route(in, FC, NONE, fold_gain);
+        break;
+      case FC:
+        route(in, FL, FR, fold_gain);
+        break;
+      case BL:
+        route(in, SL, NONE, 1.0f) || route(in, FL, NONE, fold_gain) || route(in, FC, NONE, fold_gain * fold_gain);
+        break;
+      case BR:
+        route(in, SR, NONE, 1.0f) || route(in, FR, NONE, fold_gain) || route(in, FC, NONE, fold_gain * fold_gain);
+        break;
+      case SL:
+        route(in, BL, NONE, 1.0f) || route(in, FL, NONE, fold_gain) || route(in, FC, NONE, fold_gain * fold_gain);
+        break;
+      case SR:
+        route(in, BR, NONE, 1.0f) || route(in, FR, NONE, fold_gain) || route(in, FC, NONE, fold_gain * fold_gain);
+        break;
+      case BC:
+        route(in, BL, BR, fold_gain) || route(in, SL, SR, fold_gain) || route(in, FL, FR, 0.5f) || route(in, FC, NONE, fold_gain);
+        break;
+      default:
+        // LFE -- bass management is the device's problem
+        break;
+    }
+  }
+
+  // scale down rather than let a full-scale input clip any output
+  float loudest = 0.0f;
+  for (int o = 0; o < out_channels; o++) {
+    float sum = 0.0f;
+    for (int in = 0; in < in_channels; in++) {
+      sum += std::fabs(gains[o * in_channels + in]);
+    }
+
+    loudest = std::max(loudest, sum);
+  }
+
+  if (loudest > 1.0f) {
+    for (float& gain : gains) {
+      gain /= loudest;
+    }
+  }
+
+  SetGains(gains);
+}
+
+ChannelMatrix::ChannelMatrix(int in_channels, int out_channels, const std::vector<float>& gains)
+  : in_channels_(in_channels), out_channels_(out_channels) {
+  SetGains(gains);
+}
+
+float ChannelMatrix::GetGain(int out, int in) const {
+  return columns_[in * stride_ + out];
+}
+
+int ChannelMatrix::GetInputChannels() const {
+  return in_channels_;
+}
+
+int ChannelMatrix::GetOutputChannels() const {
+  return out_channels_;
+}
+
+bool ChannelMatrix::IsIdentity() const {
+  return identity_;
+}
+
+// PRIVATE FUNCTIONS
+
+void ChannelMatrix::SetGains(const std::vector<float>& gains) {
+  stride_ = (static_cast<size_t>(out_channels_) + 3) & ~static_cast<size_t>(3);
+  columns_.assign(stride_ * in_channels_, 0.0f);
+  identity_ = (in_channels_ == out_channels_);
+  for (int o = 0; o < out_channels_; o++) {
+    for (int in = 0; in < in_channels_; in++) {
+      float gain = gains[o * in_channels_ + in];
+      columns_[in * stride_ + o] = gain;
+      identity_ = identity_ && (gain == (o == in ? 1.0f : 0.0f));
+    }
+  }
+}
@@ -0,0 +1,217 @@
+#include "audiohandlers/MixingRing.hpp"
+#include "audiohandlers/SampleKernels.hpp"
+
+#include <algorithm>
+
+// MIXSOURCE CODE
+
+MixSource::MixSource(std::shared_ptr<const std::atomic<uint64_t>> mix_frame,
+                     int twopow, int channel_count, float gain) :
+  mix_frame_(mix_frame),
+  lane_(twopow, channel_count),
+  silence_(static_cast<size_t>(SILENCE_FRAMES) * channel_count, 0.0f),
+  origin_(NO_ORIGIN),
+  next_frame_(0),
+  gain_(gain),
+  closed_(false),
+  late_frames_(0),
+  underruns_(0) {
+  // only the mixer reads the lane, and nothing force-writes it -- so skipping along it takes no lock
+  lane_.SetSingleConsumer();
+}
+
+uint32_t MixSource::Push(uint64_t frame, const float* data, uint32_t frames) {
+  int channels = lane_.GetChannelCount();
+  if (origin_.load(std::memory_order_relaxed) == NO_ORIGIN) {
+    next_frame_ = frame;
+    origin_.store(frame, std::memory_order_release);
+  }
+
+  uint32_t consumed = 0;
+  if (frame < next_frame_) {
+    // overlaps what we've already queued
+    uint64_t overlap = next_frame_ - frame;
+    if (overlap >= frames) {
+      return frames;
+    }
+
+    consumed = static_cast<uint32_t>(overlap);
+    data += static_cast<size_t>(consumed) * channels;
+    frame = next_frame_;
+  }
+
+  while (next_frame_ < frame) {
+    uint64_t gap = frame - next_frame_;
+    uint32_t pad = std::min<uint64_t>({ gap, SILENCE_FRAMES, lane_.GetMaximumWriteSize() / channels });
+    if (pad == 0) {
+      return consumed;
+    }
+
+    lane_.Write(silence_.data(), pad * channels);
+    next_frame_ += pad;
+  }
+
+  uint32_t count = std::min(frames - consumed, lane_.GetMaximumWriteSize() / channels);
+  if (count > 0) {
+    lane_.Write(data, count * channels);
+    next_frame_ += count;
+  }
+
+  return consumed + count;
+}
+
+uint32_t MixSource::Push(const float* data, uint32_t frames) {
+  uint64_t frame = next_frame_;
+  if (origin_.load(std::memory_order_relaxed) == NO_ORIGIN) {
+    frame = mix_frame_->load(std::memory_order_acquire);
+  }
+
+  return Push(frame, data, frames);
+}
+
+void MixSource::SetGain(float gain) {
+  gain_.store(gain, std::memory_order_relaxed);
+}
+
+float MixSource::GetGain() const {
+  return gain_.load(std::memory_order_relaxed);
+}
+
+void MixSource::Close() {
+  closed_.store(true, std::memory_order_release);
+}
+
+uint64_t MixSource::GetEndFrame() const {
+  uint64_t origin = origin_.load(std::memory_order_acquire);
+  if (origin == NO_ORIGIN) {
+    return mix_frame_->load(std::memory_order_acquire);
+  }
+
+  return origin + lane_.GetWriteFrame();
+}
+
+uint64_t MixSource::GetLateFrames() const {
+  return late_frames_.load(std::memory_order_relaxed);
+}
+
+uint64_t MixSource::GetUnderruns() const {
+  return underruns_.load(std::memory_order_relaxed);
+}
+
+int MixSource::GetChannelCount() const {
+  return lane_.GetChannelCount();
+}
+
+void MixSource::MixInto(float* output, uint64_t start, uint32_t frames) {
+  uint64_t origin = origin_.load(std::memory_order_acquire);
+  if (origin == NO_ORIGIN || origin >= start + frames) {
+    // hasn't started yet
+    return;
+  }
+
+  int channels = lane_.GetChannelCount();
+  uint32_t offset = (origin > start ? static_cast<uint32_t>(origin - start) : 0);
+
+  // lane frame which lines up with output frame start + offset
+  uint64_t target = start + offset - origin;
+  uint64_t read = lane_.GetReadFrame();
+  uint64_t written = lane_.GetWriteFrame();
+
+  if (read < target) {
+    // anything queued behind the mixer's position showed up too late to be heard
+    uint32_t late = static_cast<uint32_t>(std::min(target, written) - read);
+    if (late > 0) {
+      lane_.Skip_Chunked(late);
+      late_frames_.store(late_frames_.load(std::memory_order_relaxed) + late, std::memory_order_relaxed);
+      read += late;
+    }
+  }
+
+  uint32_t wanted = frames - offset;
+  uint32_t count = (read == target ? static_cast<uint32_t>(std::min<uint64_t>(written - read, wanted)) : 0);
+  if (count < wanted) {
+    underruns_.store(underruns_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+
+  if (count == 0) {
+    return;
+  }
+
+  float gain = gain_.load(std::memory_order_relaxed);
+  FrameView<float> view = lane_.View_Chunked(read, count);
+  float* dest = output + static_cast<size_t>(offset) * channels;
+  for (int part = 0; part < 2; part++) {
+    uint32_t len = view.Length(part);
+    kernels::MixAdd(view.Data(0, part), dest, gain, static_cast<size_t>(len) * channels);
+    dest += static_cast<size_t>(len) * channels;
+  }
+
+  lane_.Skip_Chunked(count);
+}
+
+bool MixSource::IsDrained() const {
+  return closed_.load(std::memory_order_acquire) && lane_.Empty();
+}
+
+// MIXINGRING CODE
+
+MixingRing::MixingRing(int channel_count, int twopow) :
+  channel_count_(channel_count),
+  twopow_(twopow),
+  drained_(false),
+  mix_frame_(std::make_shared<std::atomic<uint64_t>>(0)) { }
+
+std::shared_ptr<MixSource> MixingRing::CreateSource(float gain) {
+  Collect();
+  std::shared_ptr<MixSource> source(new MixSource(mix_frame_, twopow_, channel_count_, gain));
+  sources_.Add(source);
+  return source;
+}
+
+uint64_t MixingRing::Mix(float* output, uint32_t frames) {
+  std::fill(output, output + static_cast<size_t>(frames) * channel_count_, 0.0f);
+  return MixOnto(output, frames);
+}
+
+uint64_t MixingRing::MixOnto(float* output, uint32_t frames) {
+  uint64_t start = mix_frame_->load(std::memory_order_relaxed);
+  bool drained = false;
+  sources_.ForEach([output, start, frames, &drained](MixSource* source) {
+    // drained sources stay listed until Collect -- skip them rather than count underruns
+    if (!source->IsDrained()) {
+      source->MixInto(output, start, frames);
+    }
+
+    drained = drained || source->IsDrained();
+  });
+
+  if (drained) {
+    drained_.store(true, std::memory_order_release);
+  }
+
+  mix_frame_->store(start + frames, std::memory_order_release);
+  return start;
+}
+
+uint64_t MixingRing::GetMixFrame() const {
+  return mix_frame_->load(std::memory_order_acquire);
+}
+
+size_t MixingRing::Collect() {
+  if (!drained_.exchange(false, std::memory_order_acq_rel)) {
+    // sources dropped while Mix was mid-walk may still be waiting to be freed
+    sources_.Reclaim();
+    return 0;
+  }
+
+  return sources_.RemoveIf([](MixSource* source) { return source->IsDrained(); });
+}
+
+size_t MixingRing::GetSourceCount() {
+  Collect();
+  return sources_.Size();
+}
+
+int MixingRing::GetChannelCount() const {
+  return channel_count_;
+}
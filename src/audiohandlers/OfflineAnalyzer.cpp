@@ -0,0 +1,200 @@
+#define _USE_MATH_DEFINES
+#include "audiohandlers/OfflineAnalyzer.hpp"
+#include "audiohandlers/DFT.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// frames decoded per read in Run
+const int read_frames = 4096;
+
+// share of the spectrum's energy below the rolloff frequency
+const float rolloff_share = 0.85f;
+
+// level reported for silent bands, in dB
+const float silence_db = -120.0f;
+
+double AnalysisSummary::GetRealtimeFactor() const {
+  return (elapsed_seconds > 0.0 ? audio_seconds / elapsed_seconds : 0.0);
+}
+
+OfflineAnalyzer* OfflineAnalyzer::GetOfflineAnalyzer(int sample_rate, const AnalysisOptions& options) {
+  if (sample_rate <= 0 || options.window < 2 || (options.window & (options.window - 1)) != 0 ||
+      options.hop == 0 || options.hop > options.window || options.bands <= 0 ||
+      options.min_frequency <= 0.0f || options.min_frequency >= sample_rate / 2.0f) {
+    return nullptr;
+  }
+
+  return new OfflineAnalyzer(sample_rate, options);
+}
+
+void OfflineAnalyzer::Process(const float* samples, int channels, uint32_t frames, const Sink& sink) {
+  float scale = 1.0f / channels;
+  for (uint32_t i = 0; i < frames; i++) {
+    float sum = 0.0f;
+    for (int c = 0; c < channels; c++) {
+      sum += samples[i * channels + c];
+    }
+
+    mono_.push_back(sum * scale);
+  }
+
+  size_t offset = 0;
+  while (mono_.size() - offset >= options_.window) {
+    AnalyseWindow(offset, sink);
+    offset += options_.hop;
+  }
+
+  // keep what the next window still needs
+  mono_.erase(mono_.begin(), mono_.begin() + offset);
+  mono_frame_ += offset;
+}
+
+AnalysisSummary OfflineAnalyzer::Run(AudioReader* reader, const Sink& sink) {
+  int channels = reader->GetChannelCount();
+  std::vector<float> block(static_cast<size_t>(read_frames) * channels);
+  AnalysisSummary summary = { 0, 0, 0.0, 0.0 };
+  Sink counted = [&summary, &sink](const AnalysisFrame& frame) {
+    summary.windows++;
+    sink(frame);
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  int read;
+  while ((read = reader->GetSamplesInterleaved(read_frames * channels, block.data())) > 0) {
+    Process(block.data(), channels, static_cast<uint32_t>(read), counted);
+    summary.frames += read;
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  summary.audio_seconds = static_cast<double>(summary.frames) / sample_rate_;
+  summary.elapsed_seconds = elapsed.count();
+  return summary;
+}
+
+void OfflineAnalyzer::Reset() {
+  mono_.clear();
+  mono_frame_ = 0;
+  has_previous_ = false;
+}
+
+const std::vector<float>& OfflineAnalyzer::GetBandEdges() const {
+  return band_edges_;
+}
+
+const AnalysisOptions& OfflineAnalyzer::GetOptions() const {
+  return options_;
+}
+
+// PRIVATE FUNCTIONS
+
+OfflineAnalyzer::OfflineAnalyzer(int sample_rate, const AnalysisOptions& options)
+  : sample_rate_(sample_rate),
+    options_(options),
+    mono_frame_(0),
+    hann_(options.window),
+    windowed_(options.window),
+    real_(options.window),
+    imag_(options.window),
+    magnitude_(options.window / 2 + 1),
+    previous_(options.window / 2 + 1),
+    levels_(options.bands),
+    has_previous_(false) {
+  uint32_t window = options.window;
+  float sum = 0.0f;
+  for (uint32_t i = 0; i < window; i++) {
+    hann_[i] = 0.5f - 0.5f * static_cast<float>(std::cos(2.0 * M_PI * i / window));
+    sum += hann_[i];
+  }
+
+  // a full-scale sine reads as a magnitude of 1 in its bin
+  hann_gain_ = 2.0f / sum;
+
+  // log-spaced, but never narrower than a bin -- low bands may end up wider than asked for
+  float nyquist = sample_rate / 2.0f;
+  float bin_width = static_cast<float>(sample_rate) / window;
+  uint32_t bins = window / 2 + 1;
+  band_edges_.resize(options.bands + 1);
+  band_bins_.resize(options.bands + 1);
+  for (int b = 0; b <= options.bands; b++) {
+    band_edges_[b] = options.min_frequency * std::pow(nyquist / options.min_frequency, static_cast<float>(b) / options.bands);
+    uint32_t bin = static_cast<uint32_t>(std::lround(band_edges_[b] / bin_width));
+    if (b > 0) {
+      bin = std::max(bin, band_bins_[b - 1] + 1);
+    }
+
+    band_bins_[b] = std::min(bin, bins);
+  }
+}
+
+void OfflineAnalyzer::AnalyseWindow(size_t offset, const Sink& sink) {
+  uint32_t window = options_.window;
+  uint32_t bins = window / 2 + 1;
+  const float* input = mono_.data() + offset;
+
+  // time domain
+  float energy = 0.0f;
+  float peak = 0.0f;
+  uint32_t crossings = 0;
+  for (uint32_t i = 0; i < window; i++) {
+    energy += input[i] * input[i];
+    peak = std::max(peak, std::fabs(input[i]));
+    crossings += (i > 0 && (input[i] >= 0.0f) != (input[i - 1] >= 0.0f));
+    windowed_[i] = input[i] * hann_[i];
+  }
+
+  // frequency domain
+  dft::CalculateDFT(windowed_.data(), real_.data(), imag_.data(), window);
+  float power = 0.0f;
+  float weighted = 0.0f;
+  float magnitudes = 0.0f;
+  float flux = 0.0f;
+  float bin_width = static_cast<float>(sample_rate_) / window;
+  for (uint32_t k = 0; k < bins; k++) {
+    float m = hann_gain_ * std::sqrt(real_[k] * real_[k] + imag_[k] * imag_[k]);
+    magnitude_[k] = m;
+    power += m * m;
+    magnitudes += m;
+    weighted += m * k * bin_width;
+    if (has_previous_ && m > previous_[k]) {
+      flux += (m - previous_[k]) * (m - previous_[k]);
+    }
+  }
+
+  float rolloff = 0.0f;
+  float cumulative = 0.0f;
+  for (uint32_t k = 0; k < bins; k++) {
+    cumulative += magnitude_[k] * magnitude_[k];
+    if (cumulative >= rolloff_share * power) {
+      rolloff = k * bin_width;
+      break;
+    }
+  }
+
+  for (int b = 0; b < options_.bands; b++) {
+    uint32_t lo = band_bins_[b];
+    uint32_t hi = band_bins_[b + 1];
+    float band_power = 0.0f;
+    for (uint32_t k = lo; k < hi; k++) {
+      band_power += magnitude_[k] * magnitude_[k];
+    }
+
+    levels_[b] = (hi > lo && band_power > 0.0f ? 10.0f * std::log10(band_power / (hi - lo)) : silence_db);
+    levels_[b] = std::max(levels_[b], silence_db);
+  }
+
+  AnalysisFrame frame;
+  frame.frame = mono_frame_ + offset;
+  frame.rms = std::sqrt(energy / window);
+  frame.peak = peak;
+  frame.zero_crossings = static_cast<float>(crossings) / (window - 1);
+  frame.centroid = (magnitudes > 0.0f ? weighted / magnitudes : 0.0f);
+  frame.rolloff = rolloff;
+  frame.flux = std::sqrt(flux);
+  frame.bands = levels_.data();
+  sink(frame);
+
+  magnitude_.swap(previous_);
+  has_previous_ = true;
+}
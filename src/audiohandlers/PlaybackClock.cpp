@@ -0,0 +1,92 @@
+#include "audiohandlers/PlaybackClock.hpp"
+#include "audiohandlers/BlockTimeline.hpp"
+
+#include <cmath>
+
+// playback has to run unbroken for this long (in seconds) before the measured rate is trusted
+const double rate_window = 1.0;
+
+// a measured rate further than this from nominal means something other than drift -- ignore it
+const double max_drift = 0.01;
+
+// dac times jitter -- a block landing further than this (in seconds) from where the last one
+// said it would is a glitch, and restarts the rate measurement
+const double glitch_tolerance = 0.002;
+
+PlaybackClock::PlaybackClock() : frame_(0),
+                                 frames_(0),
+                                 time_(-1.0),
+                                 rate_(0.0),
+                                 nominal_rate_(0.0),
+                                 base_frame_(0),
+                                 base_time_(0.0),
+                                 next_frame_(0),
+                                 next_time_(-1.0) { }
+
+void PlaybackClock::Reset(double sample_rate) {
+  lock_.Write([this, sample_rate] {
+    frame_.store(0, std::memory_order_relaxed);
+    frames_.store(0, std::memory_order_relaxed);
+    time_.store(-1.0, std::memory_order_relaxed);
+    rate_.store(sample_rate, std::memory_order_relaxed);
+  });
+
+  nominal_rate_ = sample_rate;
+  next_time_ = -1.0;
+}
+
+void PlaybackClock::Publish(uint64_t frame, uint32_t frames, double dac_time) {
+  // measure the rate over the current run of unbroken playback
+  bool continuous = (next_time_ >= 0.0 && frame == next_frame_ &&
+                     std::fabs(dac_time - next_time_) <= glitch_tolerance + 0.5 * frames / nominal_rate_);
+  if (!continuous) {
+    base_frame_ = frame;
+    base_time_ = dac_time;
+  }
+
+  double rate = nominal_rate_;
+  double elapsed = dac_time - base_time_;
+  if (elapsed >= rate_window) {
+    double measured = static_cast<double>(frame - base_frame_) / elapsed;
+    if (std::fabs(measured - nominal_rate_) <= max_drift * nominal_rate_) {
+      rate = measured;
+    }
+  }
+
+  next_frame_ = frame + frames;
+  next_time_ = dac_time + frames / rate;
+
+  lock_.Write([this, frame, frames, dac_time, rate] {
+    frame_.store(frame, std::memory_order_relaxed);
+    frames_.store(frames, std::memory_order_relaxed);
+    time_.store(dac_time, std::memory_order_relaxed);
+    rate_.store(rate, std::memory_order_relaxed);
+  });
+}
+
+bool PlaybackClock::GetAnchor(ClockAnchor* output) const {
+  lock_.Read([this, output] {
+    output->frame = frame_.load(std::memory_order_relaxed);
+    output->frames = frames_.load(std::memory_order_relaxed);
+    output->time = time_.load(std::memory_order_relaxed);
+    output->rate = rate_.load(std::memory_order_relaxed);
+  });
+
+  return (output->time >= 0.0);
+}
+
+int64_t PlaybackClock::GetFrame(double time) const {
+  ClockAnchor anchor;
+  if (!GetAnchor(&anchor)) {
+    return -1;
+  }
+
+  double frame = static_cast<double>(anchor.frame) + (time - anchor.time) * anchor.rate;
+  double end = static_cast<double>(anchor.frame + anchor.frames);
+  frame = (frame > end ? end : (frame < 0.0 ? 0.0 : frame));
+  return static_cast<int64_t>(frame);
+}
+
+int64_t PlaybackClock::GetFrame() const {
+  return GetFrame(BlockTimeline::Now());
+}
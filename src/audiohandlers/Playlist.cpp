@@ -0,0 +1,249 @@
+#include "audiohandlers/Playlist.hpp"
+#include "audioreaders/ResamplingReader.hpp"
+#include "audioreaders/VorbisReader.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+Playlist* Playlist::GetPlaylist(std::vector<std::string> files, Opener opener, int preload_seconds) {
+  if (opener == nullptr) {
+    opener = [](const std::string& file) -> AudioReader* { return VorbisReader::GetMappedVorbisReader(file); };
+  }
+
+  // the first track that opens sets the format for the rest
+  for (size_t i = 0; i < files.size(); i++) {
+    AudioReader* reader = opener(files[i]);
+    if (reader == nullptr) {
+      std::cout << "could not open " << files[i] << std::endl;
+      continue;
+    }
+
+    std::unique_ptr<Track> first(new Track{ std::unique_ptr<AudioReader>(reader), files[i], {}, 0, reader->GetLength(), 0 });
+    Playlist* result = new Playlist(std::move(first), opener, preload_seconds);
+    for (i++; i < files.size(); i++) {
+      result->Enqueue(files[i]);
+    }
+
+    return result;
+  }
+
+  return nullptr;
+}
+
+void Playlist::Enqueue(std::string file) {
+  std::lock_guard<std::mutex> lock(queue_lock_);
+  files_.push_back(file);
+  queue_.push_back(std::move(file));
+}
+
+std::vector<TrackSplice> Playlist::GetSplices() {
+  std::lock_guard<std::mutex> lock(queue_lock_);
+  return splices_;
+}
+
+size_t Playlist::GetQueuedCount() {
+  std::lock_guard<std::mutex> lock(queue_lock_);
+  return queue_.size();
+}
+
+int Playlist::GetSamplesInterleaved(int count, float* output) {
+  std::lock_guard<std::mutex> lock(read_lock_);
+  int frames = count / channel_count_;
+  int frames_read = 0;
+  while (frames_read < frames) {
+    if (current_ == nullptr && !Advance()) {
+      break;
+    }
+
+    int read = ReadCurrent(frames - frames_read, output + static_cast<size_t>(frames_read) * channel_count_);
+    frames_read += read;
+    frame_ += read;
+    if (read == 0) {
+      // end of the track -- the next one picks up at exactly this frame
+      current_.reset();
+    } else {
+      // as soon as a track starts, so the next one has all of this one to open in
+      StartPreload();
+    }
+  }
+
+  return frames_read;
+}
+
+int Playlist::GetSampleRate() {
+  return sample_rate_;
+}
+
+int Playlist::GetChannelCount() {
+  return channel_count_;
+}
+
+void Playlist::Seek(int sample) {
+  std::lock_guard<std::mutex> lock(read_lock_);
+  if (sample == 0 && !Rewind()) {
+    // a different track is open (or none is) -- start on the first one afresh
+    current_.reset();
+    Advance();
+    return;
+  }
+
+  if (current_ == nullptr) {
+    return;
+  }
+
+  // the head is only good for a read from the very start
+  current_->head.clear();
+  current_->head_offset = 0;
+  current_->reader->Seek(sample);
+  current_->position = std::max(sample, 0);
+}
+
+Playlist::~Playlist() {
+  if (preload_thread_.joinable()) {
+    preload_thread_.join();
+  }
+}
+
+// PRIVATE FUNCTIONS
+
+Playlist::Playlist(std::unique_ptr<Track> first, Opener opener, int preload_seconds)
+  : opener_(opener),
+    channel_count_(first->reader->GetChannelCount()),
+    sample_rate_(first->reader->GetSampleRate()),
+    preload_frames_(static_cast<uint32_t>(std::max(preload_seconds, 0)) * first->reader->GetSampleRate()),
+    splices_({ { 0, first->file } }),
+    files_({ first->file }),
+    current_(std::move(first)),
+    frame_(0),
+    preload_done_(false) { }
+
+std::unique_ptr<Playlist::Track> Playlist::OpenNext(bool decode_head) {
+  for (;;) {
+    std::string file;
+    {
+      std::lock_guard<std::mutex> lock(queue_lock_);
+      if (queue_.empty()) {
+        return nullptr;
+      }
+
+      file = std::move(queue_.front());
+      queue_.pop_front();
+    }
+
+    std::unique_ptr<AudioReader> reader(opener_(file));
+    if (reader == nullptr) {
+      std::cout << "could not open " << file << std::endl;
+      continue;
+    }
+
+    if (reader->GetChannelCount() != channel_count_) {
+      // can't be spliced into the open stream
+      std::cout << "skipping " << file << ": channel count doesn't match the stream" << std::endl;
+      continue;
+    }
+
+    if (reader->GetSampleRate() != sample_rate_) {
+      reader.reset(new ResamplingReader(reader.release(), sample_rate_));
+    }
+
+    std::unique_ptr<Track> track(new Track{ std::move(reader), file, {}, 0, -1, 0 });
+    track->length = track->reader->GetLength();
+    if (decode_head && preload_frames_ > 0) {
+      track->head.resize(static_cast<size_t>(preload_frames_) * channel_count_);
+      int read = track->reader->GetSamplesInterleaved(static_cast<int>(track->head.size()), track->head.data());
+      track->head.resize(static_cast<size_t>(read) * channel_count_);
+    }
+
+    return track;
+  }
+}
+
+void Playlist::StartPreload() {
+  if (preload_thread_.joinable()) {
+    if (IsPreloading() || next_ != nullptr) {
+      return;
+    }
+
+    {
+      // came up empty -- only worth another go if something has been queued since
+      std::lock_guard<std::mutex> lock(queue_lock_);
+      if (queue_.empty()) {
+        return;
+      }
+    }
+
+    preload_thread_.join();
+  }
+
+  preload_done_.store(false, std::memory_order_relaxed);
+  preload_thread_ = std::thread([this] {
+    next_ = OpenNext(true);
+    preload_done_.store(true, std::memory_order_release);
+  });
+}
+
+bool Playlist::IsPreloading() const {
+  return preload_thread_.joinable() && !preload_done_.load(std::memory_order_acquire);
+}
+
+bool Playlist::Advance() {
+  if (preload_thread_.joinable()) {
+    // started with the track before, so it's done unless that track was shorter than this
+    // one takes to open
+    preload_thread_.join();
+  }
+
+  current_ = std::move(next_);
+  if (current_ == nullptr) {
+    // nothing was preloaded, or the queue was empty when the preload ran -- something may have been added since
+    current_ = OpenNext(false);
+    if (current_ == nullptr) {
+      return false;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(queue_lock_);
+  splices_.push_back({ frame_, current_->file });
+  return true;
+}
+
+bool Playlist::Rewind() {
+  if (preload_thread_.joinable()) {
+    preload_thread_.join();
+  }
+
+  next_.reset();
+  frame_ = 0;
+
+  std::lock_guard<std::mutex> lock(queue_lock_);
+  bool first = (current_ != nullptr && splices_.size() == 1);
+  queue_.assign(files_.begin() + (first ? 1 : 0), files_.end());
+  if (!first) {
+    splices_.clear();
+  }
+
+  return first;
+}
+
+int Playlist::ReadCurrent(int frames, float* output) {
+  Track& track = *current_;
+  int read = 0;
+  if (track.head_offset < track.head.size()) {
+    size_t len = std::min(track.head.size() - track.head_offset, static_cast<size_t>(frames) * channel_count_);
+    std::copy(track.head.begin() + track.head_offset, track.head.begin() + track.head_offset + len, output);
+    track.head_offset += len;
+    read = static_cast<int>(len / channel_count_);
+    if (track.head_offset == track.head.size()) {
+      // done with it
+      std::vector<float>().swap(track.head);
+      track.head_offset = 0;
+    }
+  }
+
+  if (read < frames) {
+    read += track.reader->GetSamplesInterleaved((frames - read) * channel_count_, output + static_cast<size_t>(read) * channel_count_);
+  }
+
+  track.position += read;
+  return read;
+}
@@ -0,0 +1,355 @@
+#include "audiohandlers/RealtimeCheck.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+
+#if defined(RTCHECK) && defined(__GLIBC__)
+#define RTCHECK_INTERPOSE
+#include <cerrno>
+#include <cstdio>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// violations kept with a backtrace -- the rest are only counted
+const uint32_t MAX_RECORDS = 32;
+
+// scope timings are bucketed this finely (in seconds), up to BUCKETS of them
+// anything longer lands in the last bucket, and still counts towards the max
+const double BUCKET_WIDTH = 5e-6;
+const int BUCKETS = 8192;
+
+// nothing here may allocate or lock -- it's all reached from inside the interposers
+std::atomic<uint64_t> violation_counts[static_cast<int>(RealtimeViolation::COUNT)];
+std::atomic<uint32_t> next_record(0);
+std::atomic<bool> record_ready[MAX_RECORDS];
+ViolationRecord records[MAX_RECORDS];
+
+std::atomic<uint32_t> histogram[BUCKETS];
+std::atomic<double> scope_max(0.0);
+
+// how deep in RealtimeScopes this thread is
+thread_local int realtime_depth = 0;
+
+#ifdef RTCHECK_INTERPOSE
+
+// set while a violation is being noted, so the bookkeeping doesn't trip over itself
+thread_local bool in_hook = false;
+
+// backtrace loads libgcc on first use, which allocates -- get that out of the way early
+struct BacktracePrimer {
+  BacktracePrimer() {
+    void* frame;
+    backtrace(&frame, 1);
+  }
+} backtrace_primer;
+
+inline bool ShouldNote() {
+  return (realtime_depth > 0 && !in_hook);
+}
+
+void Note(RealtimeViolation kind) {
+  in_hook = true;
+  violation_counts[static_cast<int>(kind)].fetch_add(1, std::memory_order_relaxed);
+  uint32_t slot = next_record.fetch_add(1, std::memory_order_relaxed);
+  if (slot < MAX_RECORDS) {
+    ViolationRecord& record = records[slot];
+    record.kind = kind;
+    record.depth = backtrace(record.frames, ViolationRecord::MAX_DEPTH);
+    record_ready[slot].store(true, std::memory_order_release);
+  } else {
+    // don't let the counter wrap around onto the records again
+    next_record.store(MAX_RECORDS, std::memory_order_relaxed);
+  }
+
+  in_hook = false;
+}
+
+// the next definition of a symbol along, i.e. libc's -- looked up once, without locking
+template <typename Fn>
+Fn Resolve(std::atomic<Fn>& slot, const char* name) {
+  Fn result = slot.load(std::memory_order_acquire);
+  if (result == nullptr) {
+    bool hooked = in_hook;
+    in_hook = true;
+    result = reinterpret_cast<Fn>(dlsym(RTLD_NEXT, name));
+    in_hook = hooked;
+    slot.store(result, std::memory_order_release);
+  }
+
+  return result;
+}
+
+typedef int (*MutexFn)(pthread_mutex_t*);
+typedef int (*RWLockFn)(pthread_rwlock_t*);
+typedef ssize_t (*WriteFn)(int, const void*, size_t);
+typedef size_t (*FWriteFn)(const void*, size_t, size_t, FILE*);
+
+std::atomic<MutexFn> real_mutex_lock(nullptr);
+std::atomic<RWLockFn> real_rdlock(nullptr);
+std::atomic<RWLockFn> real_wrlock(nullptr);
+std::atomic<WriteFn> real_write(nullptr);
+std::atomic<FWriteFn> real_fwrite(nullptr);
+
+#endif  // RTCHECK_INTERPOSE
+
+const char* ViolationName(RealtimeViolation kind) {
+  switch (kind) {
+    case RealtimeViolation::ALLOCATION:
+      return "allocation";
+    case RealtimeViolation::LOCK:
+      return "lock";
+    case RealtimeViolation::WRITE:
+      return "write";
+    default:
+      return "unknown";
+  }
+}
+
+double Percentile(const std::vector<uint32_t>& buckets, uint64_t count, double max, double p) {
+  if (count == 0) {
+    return 0.0;
+  }
+
+  uint64_t target = static_cast<uint64_t>(std::ceil(p * count));
+  uint64_t total = 0;
+  for (int i = 0; i < BUCKETS; i++) {
+    total += buckets[i];
+    if (total >= target) {
+      // upper edge of the bucket -- never past the longest we actually saw
+      return std::min((i + 1) * BUCKET_WIDTH, max);
+    }
+  }
+
+  return max;
+}
+
+}  // namespace
+
+bool RealtimeCheck::IsEnabled() {
+#ifdef RTCHECK_INTERPOSE
+  return true;
+#else
+  return false;
+#endif
+}
+
+RealtimeReport RealtimeCheck::GetReport() {
+  RealtimeReport report;
+  report.enabled = IsEnabled();
+
+  std::vector<uint32_t> buckets(BUCKETS);
+  uint64_t count = 0;
+  for (int i = 0; i < BUCKETS; i++) {
+    buckets[i] = histogram[i].load(std::memory_order_relaxed);
+    count += buckets[i];
+  }
+
+  report.scopes = count;
+  report.max = scope_max.load(std::memory_order_relaxed);
+  report.p50 = Percentile(buckets, count, report.max, 0.5);
+  report.p99 = Percentile(buckets, count, report.max, 0.99);
+  report.p999 = Percentile(buckets, count, report.max, 0.999);
+
+  for (int i = 0; i < static_cast<int>(RealtimeViolation::COUNT); i++) {
+    report.violations[i] = violation_counts[i].load(std::memory_order_relaxed);
+  }
+
+  uint32_t recorded = std::min(next_record.load(std::memory_order_relaxed), MAX_RECORDS);
+  for (uint32_t i = 0; i < recorded; i++) {
+    if (record_ready[i].load(std::memory_order_acquire)) {
+      report.records.push_back(records[i]);
+    }
+  }
+
+  return report;
+}
+
+void RealtimeCheck::Reset() {
+  for (int i = 0; i < static_cast<int>(RealtimeViolation::COUNT); i++) {
+    violation_counts[i].store(0, std::memory_order_relaxed);
+  }
+
+  for (uint32_t i = 0; i < MAX_RECORDS; i++) {
+    record_ready[i].store(false, std::memory_order_relaxed);
+  }
+
+  next_record.store(0, std::memory_order_relaxed);
+
+  for (int i = 0; i < BUCKETS; i++) {
+    histogram[i].store(0, std::memory_order_relaxed);
+  }
+
+  scope_max.store(0.0, std::memory_order_relaxed);
+}
+
+void RealtimeCheck::PrintReport(std::ostream& out) {
+  RealtimeReport report = GetReport();
+  if (!report.enabled) {
+    out << "realtime check: not built in (set rtcheck ON)" << std::endl;
+    return;
+  }
+
+  out << "realtime check: " << report.scopes << " scopes, "
+      << "p50 " << report.p50 * 1e6 << "us, "
+      << "p99 " << report.p99 * 1e6 << "us, "
+      << "p99.9 " << report.p999 * 1e6 << "us, "
+      << "max " << report.max * 1e6 << "us" << std::endl;
+
+  for (int i = 0; i < static_cast<int>(RealtimeViolation::COUNT); i++) {
+    out << "  " << ViolationName(static_cast<RealtimeViolation>(i)) << ": " << report.violations[i] << std::endl;
+  }
+
+#ifdef RTCHECK_INTERPOSE
+  for (size_t i = 0; i < report.records.size(); i++) {
+    const ViolationRecord& record = report.records[i];
+    out << "  #" << i << " " << ViolationName(record.kind) << std::endl;
+    char** symbols = backtrace_symbols(record.frames, record.depth);
+    if (symbols == nullptr) {
+      continue;
+    }
+
+    // skip ourselves -- Note, and the interposer
+    for (int j = 2; j < record.depth; j++) {
+      out << "      " << symbols[j] << std::endl;
+    }
+
+    free(symbols);
+  }
+#endif
+}
+
+void RealtimeCheck::Enter() {
+  realtime_depth++;
+}
+
+void RealtimeCheck::Exit(double elapsed) {
+  if (--realtime_depth > 0) {
+    return;
+  }
+
+  int bucket = std::min(static_cast<int>(elapsed / BUCKET_WIDTH), BUCKETS - 1);
+  histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+
+  double max = scope_max.load(std::memory_order_relaxed);
+  while (elapsed > max && !scope_max.compare_exchange_weak(max, elapsed, std::memory_order_relaxed));
+}
+
+#ifdef RTCHECK_INTERPOSE
+
+// glibc keeps its allocator reachable under these names, so we can sit in front of it
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+void* malloc(size_t size) noexcept {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::ALLOCATION);
+  }
+
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) noexcept {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::ALLOCATION);
+  }
+
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) noexcept {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::ALLOCATION);
+  }
+
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) noexcept {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::ALLOCATION);
+  }
+
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) noexcept {
+  return memalign(alignment, size);
+}
+
+int posix_memalign(void** output, size_t alignment, size_t size) noexcept {
+  if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) {
+    return EINVAL;
+  }
+
+  void* result = memalign(alignment, size);
+  if (result == nullptr) {
+    return ENOMEM;
+  }
+
+  *output = result;
+  return 0;
+}
+
+void free(void* ptr) noexcept {
+  if (ptr != nullptr && ShouldNote()) {
+    Note(RealtimeViolation::ALLOCATION);
+  }
+
+  __libc_free(ptr);
+}
+
+int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::LOCK);
+  }
+
+  return Resolve(real_mutex_lock, "pthread_mutex_lock")(mutex);
+}
+
+int pthread_rwlock_rdlock(pthread_rwlock_t* lock) noexcept {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::LOCK);
+  }
+
+  return Resolve(real_rdlock, "pthread_rwlock_rdlock")(lock);
+}
+
+int pthread_rwlock_wrlock(pthread_rwlock_t* lock) noexcept {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::LOCK);
+  }
+
+  return Resolve(real_wrlock, "pthread_rwlock_wrlock")(lock);
+}
+
+ssize_t write(int fd, const void* data, size_t size) {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::WRITE);
+  }
+
+  return Resolve(real_write, "write")(fd, data, size);
+}
+
+size_t fwrite(const void* data, size_t size, size_t count, FILE* file) {
+  if (ShouldNote()) {
+    Note(RealtimeViolation::WRITE);
+  }
+
+  return Resolve(real_fwrite, "fwrite")(data, size, count, file);
+}
+
+}  // extern "C"
+
+#endif  // RTCHECK_INTERPOSE
@@ -0,0 +1,56 @@
+#include "audiohandlers/RefillScheduler.hpp"
+
+// refill once a quarter of the ring has played -- the rest covers a late wakeup or a slow decode,
+// and a quarter of a ring is a big enough batch that the writer isn't up every few callbacks
+const uint32_t watermark_quarters = 3;
+
+RefillScheduler::RefillScheduler(uint32_t capacity) : capacity_(capacity),
+                                                      burst_(0),
+                                                      wakeups_(0),
+                                                      pending_(false) { }
+
+void RefillScheduler::OnConsumed(uint32_t frames, uint32_t remaining) {
+  // decaying max -- jumps up to a big block straight away, then closes 1/16th of the gap per smaller block
+  uint32_t burst = burst_.load(std::memory_order_relaxed);
+  burst = (frames >= burst ? frames : burst - ((burst - frames) >> 4));
+  burst_.store(burst, std::memory_order_relaxed);
+
+  // just a flag -- the writer picks it up when its wait runs out
+  if (remaining < GetWatermark() && !pending_.exchange(true, std::memory_order_acq_rel)) {
+    wakeups_.store(wakeups_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+}
+
+void RefillScheduler::Signal() {
+  pending_.store(true, std::memory_order_release);
+  wait_cond_.notify_one();
+}
+
+bool RefillScheduler::Wait(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(wait_lock_);
+  return wait_cond_.wait_for(lock, timeout, [this] {
+    return pending_.exchange(false, std::memory_order_acq_rel);
+  });
+}
+
+uint32_t RefillScheduler::GetRefillFrames(uint32_t free_frames) const {
+  uint32_t burst = GetBurst();
+  if (burst == 0) {
+    // no callbacks yet -- just fill up
+    return free_frames;
+  }
+
+  return (free_frames / burst) * burst;
+}
+
+uint32_t RefillScheduler::GetWatermark() const {
+  return static_cast<uint32_t>((static_cast<uint64_t>(capacity_) * watermark_quarters) / 4);
+}
+
+uint32_t RefillScheduler::GetBurst() const {
+  return burst_.load(std::memory_order_relaxed);
+}
+
+uint64_t RefillScheduler::GetWakeups() const {
+  return wakeups_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,190 @@
+#include "audiohandlers/Resampler.hpp"
+#include "audiohandlers/SampleKernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// kaiser window shape -- about 85dB of stopband attenuation
+const double kaiser_beta = 8.6;
+
+// passband edge, as a fraction of the lower nyquist frequency -- the rest is transition band
+const double rolloff = 0.9;
+
+namespace {
+
+// zeroth-order modified bessel function of the first kind, for the kaiser window
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  for (int k = 1; k < 32; k++) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+
+  return sum;
+}
+
+}  // namespace
+
+Resampler::Resampler(int in_rate, int out_rate, int channels, uint32_t taps, uint32_t max_block)
+  : channels_(channels),
+    taps_((std::max(taps, 8u) + 7) & ~7u),
+    max_block_(std::max(max_block, 1u)),
+    work_(channels),
+    work_input_(channels) {
+  uint32_t divisor = std::gcd(static_cast<uint32_t>(in_rate), static_cast<uint32_t>(out_rate));
+  up_ = static_cast<uint32_t>(out_rate) / divisor;
+  step_ = static_cast<uint32_t>(in_rate) / divisor;
+  phases_ = std::min(up_, MAX_PHASES);
+
+  // downsampling moves the cutoff down to the output's nyquist
+  DesignFilters(rolloff * std::min(1.0, static_cast<double>(up_) / step_));
+
+  for (int c = 0; c < channels_; c++) {
+    work_[c].resize(taps_ - 1 + max_block_);
+    work_input_[c] = work_[c].data() + taps_ - 1;
+  }
+
+  Reset();
+}
+
+uint32_t Resampler::Process(const float* input, uint32_t frames, float* output) {
+  uint32_t written = 0;
+  while (frames > 0) {
+    uint32_t len = std::min(frames, max_block_);
+    written += ProcessChunk(input, len, output + static_cast<size_t>(written) * channels_);
+    input += static_cast<size_t>(len) * channels_;
+    frames -= len;
+  }
+
+  return written;
+}
+
+uint32_t Resampler::Flush(float* output) {
+  uint32_t written = 0;
+  uint32_t frames = GetDelay();
+  while (frames > 0) {
+    uint32_t len = std::min(frames, max_block_);
+    written += ProcessChunk(nullptr, len, output + static_cast<size_t>(written) * channels_);
+    frames -= len;
+  }
+
+  return written;
+}
+
+void Resampler::Reset() {
+  for (auto& work : work_) {
+    std::fill(work.begin(), work.end(), 0.0f);
+  }
+
+  // the first output is centred on input frame 0, so it needs the delay's worth of frames after it
+  position_ = GetDelay();
+  phase_ = 0;
+}
+
+uint32_t Resampler::GetMaxOutput(uint32_t frames) const {
+  // each chunk can round up by one
+  uint64_t chunks = (static_cast<uint64_t>(frames) + max_block_ - 1) / max_block_;
+  return static_cast<uint32_t>((static_cast<uint64_t>(frames) * up_ + step_ - 1) / step_ + chunks + 1);
+}
+
+uint32_t Resampler::GetDelay() const {
+  return taps_ / 2;
+}
+
+int Resampler::GetChannelCount() const {
+  return channels_;
+}
+
+uint32_t Resampler::GetUpFactor() const {
+  return up_;
+}
+
+uint32_t Resampler::GetDownFactor() const {
+  return step_;
+}
+
+// PRIVATE FUNCTIONS
+
+uint32_t Resampler::ProcessChunk(const float* input, uint32_t frames, float* output) {
+  if (input != nullptr) {
+    kernels::Deinterleave(input, work_input_.data(), channels_, frames);
+  } else {
+    for (float* work : work_input_) {
+      std::fill(work, work + frames, 0.0f);
+    }
+  }
+
+  uint32_t written = 0;
+  const bool exact = (phases_ == up_);
+  while (position_ < frames) {
+    // window of taps_ frames ending at position_ -- history covers anything before the chunk
+    size_t start = static_cast<size_t>(position_);
+    if (exact) {
+      const float* filter = bank_.data() + static_cast<size_t>(phase_) * taps_;
+      for (int c = 0; c < channels_; c++) {
+        output[c] = kernels::Dot(filter, work_[c].data() + start, taps_);
+      }
+    } else {
+      // between two of the bank's phases
+      uint64_t scaled = static_cast<uint64_t>(phase_) * phases_;
+      uint32_t phase = static_cast<uint32_t>(scaled / up_);
+      float frac = static_cast<float>(scaled % up_) / up_;
+      const float* lo = bank_.data() + static_cast<size_t>(phase) * taps_;
+      const float* hi = lo + taps_;
+      for (int c = 0; c < channels_; c++) {
+        float a = kernels::Dot(lo, work_[c].data() + start, taps_);
+        float b = kernels::Dot(hi, work_[c].data() + start, taps_);
+        output[c] = a + (b - a) * frac;
+      }
+    }
+
+    output += channels_;
+    written++;
+
+    phase_ += step_;
+    position_ += phase_ / up_;
+    phase_ %= up_;
+  }
+
+  // carry the end of the chunk over as history
+  position_ -= frames;
+  for (auto& work : work_) {
+    std::copy(work.begin() + frames, work.begin() + frames + taps_ - 1, work.begin());
+  }
+
+  return written;
+}
+
+void Resampler::DesignFilters(double cutoff) {
+  // one prototype filter, sampled at phases_ points per input frame, centred on taps_ / 2
+  // coefficient j of phase p weights the input frame (taps_ / 2 - j) frames before the output,
+  // minus p / phases_ -- see ProcessChunk
+  const double length = static_cast<double>(taps_) * phases_;
+  const double centre = length / 2.0;
+  const double pi = std::acos(-1.0);
+  const double window_norm = BesselI0(kaiser_beta);
+
+  bank_.assign(static_cast<size_t>(phases_ + 1) * taps_, 0.0f);
+  std::vector<double> filter(taps_);
+  for (uint32_t p = 0; p <= phases_; p++) {
+    double sum = 0.0;
+    for (uint32_t j = 0; j < taps_; j++) {
+      double n = static_cast<double>(j) * phases_ + p;
+      double x = (n - centre) / phases_;
+      double sinc = (x == 0.0 ? 1.0 : std::sin(pi * cutoff * x) / (pi * cutoff * x));
+      double r = (n - centre) / centre;
+      double window = (r * r < 1.0 ? BesselI0(kaiser_beta * std::sqrt(1.0 - r * r)) / window_norm : 0.0);
+      filter[j] = sinc * window;
+      sum += filter[j];
+    }
+
+    // unity gain at DC for every phase, so a constant signal stays constant
+    // stored reversed -- the oldest frame in the window takes the last coefficient
+    float* dest = bank_.data() + static_cast<size_t>(p) * taps_;
+    for (uint32_t j = 0; j < taps_; j++) {
+      dest[taps_ - 1 - j] = static_cast<float>(filter[j] / sum);
+    }
+  }
+}
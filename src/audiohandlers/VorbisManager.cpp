@@ -1,45 +1,71 @@
 #include "audiohandlers/VorbisManager.hpp"
+#include "audiohandlers/RealtimeCheck.hpp"
+#include "audiohandlers/RingDecoder.hpp"
+#include "audiosinks/PortAudioSink.hpp"
+#include <algorithm>
 #include <iostream>
 #include <string>
 
-typedef AudioBufferSPSC<float> FloatBuf;
-
 // TIMEINFO CODE
 
-TimeInfo::TimeInfo() : sample_rate_(0),
-                       playback_epoch_(std::chrono::high_resolution_clock::now()) { }
+TimeInfo::TimeInfo() : TimeInfo(0) { }
                       
 TimeInfo::TimeInfo(int sample_rate) : sample_rate_(sample_rate),
-                                      playback_epoch_(std::chrono::high_resolution_clock::now()) {}
+                                      playback_epoch_(BlockTimeline::Now()),
+                                      clock_(nullptr) {}
+
+TimeInfo::TimeInfo(const PlaybackClock* clock) : TimeInfo(0) {
+  clock_ = clock;
+}
 
-int TimeInfo::GetCurrentSample() const {
-  std::shared_lock<std::shared_mutex> lock(info_lock_);
-  if (sample_rate_ == 0) {
+int64_t TimeInfo::GetCurrentSample() const {
+  int sample_rate;
+  double epoch;
+  lock_.Read([this, &sample_rate, &epoch] {
+    sample_rate = sample_rate_.load(std::memory_order_relaxed);
+    epoch = playback_epoch_.load(std::memory_order_relaxed);
+  });
+
+  if (sample_rate == 0) {
     return -1;
   }
 
-  std::chrono::duration<double, std::milli> offset =
-    std::chrono::high_resolution_clock::now() - playback_epoch_;
-  return static_cast<int>((sample_rate_ * offset.count()) / 1000);
+  // the device's own idea of what's playing -- latency and drift included
+  int64_t frame = (clock_ != nullptr ? clock_->GetFrame() : -1);
+  if (frame >= 0) {
+    return frame;
+  }
+
+  return static_cast<int64_t>(sample_rate * (BlockTimeline::Now() - epoch));
 }
 
 bool TimeInfo::IsThreadRunning() const {
-  std::shared_lock lock(info_lock_);
-  return !(sample_rate_ <= 0);
+  return !(sample_rate_.load(std::memory_order_acquire) <= 0);
+}
+
+int TimeInfo::GetSampleRate() const {
+  return sample_rate_.load(std::memory_order_acquire);
 }
 
 void TimeInfo::SetSampleRate(int sample_rate) {
-  std::lock_guard<std::shared_mutex> lock(info_lock_);
-  sample_rate_ = sample_rate;
+  std::lock_guard<std::mutex> lock(write_lock_);
+  Store(sample_rate, playback_epoch_.load(std::memory_order_relaxed));
 }
 
 void TimeInfo::ResetEpoch() {
-  std::lock_guard<std::shared_mutex> lock(info_lock_);
-  playback_epoch_ = std::chrono::high_resolution_clock::now();
+  std::lock_guard<std::mutex> lock(write_lock_);
+  Store(sample_rate_.load(std::memory_order_relaxed), BlockTimeline::Now());
+}
+
+void TimeInfo::Store(int sample_rate, double epoch) {
+  lock_.Write([this, sample_rate, epoch] {
+    sample_rate_.store(sample_rate, std::memory_order_relaxed);
+    playback_epoch_.store(epoch, std::memory_order_relaxed);
+  });
 }
 
 // READONLYBUFFER CODE
-ReadOnlyBuffer::ReadOnlyBuffer(std::shared_ptr<AudioBufferSPSC<float>> buffer, 
+ReadOnlyBuffer::ReadOnlyBuffer(std::shared_ptr<SampleBuffer> buffer, 
                                const TimeInfo* info) : info_(info), buffer_(buffer) {}
 
 size_t ReadOnlyBuffer::Peek_Chunked(uint32_t framecount, float*** output) {
@@ -50,59 +76,105 @@ float** ReadOnlyBuffer::Read_Chunked(uint32_t framecount) {
   return buffer_->Read_Chunked(framecount);
 }
 
-int ReadOnlyBuffer::Synchronize_Chunked() {
+int64_t ReadOnlyBuffer::Synchronize_Chunked() {
   return Synchronize_Chunked(0);
 }
 
-int ReadOnlyBuffer::Synchronize_Chunked(float offset) {
-  int samplenum = info_->GetCurrentSample() + (offset * info_->sample_rate_);
+int64_t ReadOnlyBuffer::Synchronize_Chunked(float offset) {
+  int64_t current = info_->GetCurrentSample();
+  if (current == -1) {
+    return -1;
+  }
+
+  int64_t samplenum = current + static_cast<int64_t>(offset * info_->GetSampleRate());
   if (samplenum < 0) {
     samplenum = 0;
-    if (info_->GetCurrentSample() == -1) {
-      return -1;
-    }
   }
 
   buffer_->Synchronize_Chunked(samplenum);
   return samplenum;
 }
 
+FrameView<float, SampleStorage> ReadOnlyBuffer::View_Chunked(float offset, uint32_t framecount) {
+  int64_t current = info_->GetCurrentSample();
+  if (current == -1) {
+    return buffer_->View_Chunked(0, 0);
+  }
+
+  int64_t framenum = current + static_cast<int64_t>(offset * info_->GetSampleRate());
+  if (framenum < 0) {
+    framenum = 0;
+  }
+
+  return buffer_->View_Chunked(static_cast<uint64_t>(framenum), framecount);
+}
+
+FrameView<float, SampleStorage> ReadOnlyBuffer::View_Chunked(uint64_t frame, uint32_t framecount) {
+  return buffer_->View_Chunked(frame, framecount);
+}
+
+bool ReadOnlyBuffer::IsRetained(uint64_t frame) const {
+  return buffer_->IsRetained(frame);
+}
+
 int ReadOnlyBuffer::Size() {
   return buffer_->Size();
 }
 
+BufferStats ReadOnlyBuffer::GetStats() const {
+  return buffer_->GetStats();
+}
+
 ReadOnlyBuffer::~ReadOnlyBuffer() { 
 }
 
 // VORBISMANAGER CODE
 
-VorbisManager* VorbisManager::GetVorbisManager(int twopow, AudioReader* reader) {
+// number of blocks each timeline remembers, as a power of two
+const int timeline_power = 9;
+
+// how often the write thread checks on the critical buffer -- the callback never wakes it
+const int refill_timeout_ms = 20;
 
+VorbisManager* VorbisManager::GetVorbisManager(int twopow, AudioReader* reader, int output_channels,
+                                               AudioSink* sink) {
 
-  if (twopow <= 1) {
+
+  if (twopow <= 1 || output_channels <= 0) {
     // unreasonable
     return nullptr;
   }
-  int err;
 
-  err = Pa_GetDeviceCount();
+  if (sink == nullptr) {
+    int err;
 
-  if (err < 0) {
-    // failed to initialize PA
-    return nullptr;
+    err = Pa_GetDeviceCount();
+
+    if (err < 0) {
+      // failed to initialize PA
+      return nullptr;
+    }
+
+    sink = new PortAudioSink();
   }
 
-  return new VorbisManager(twopow, reader);
+  return new VorbisManager(twopow, reader, output_channels, sink);
 }
 
 ReadOnlyBuffer* VorbisManager::CreateBufferInstance() {
-  std::shared_ptr<FloatBuf> result(new FloatBuf(buffer_power_, channel_count_));
-  std::lock_guard lock(buffer_list_lock_);
-  buffer_list_.push_front(result);
+  // readers only ever ask for chunked data, so deinterleave once on the way in
+  // half of the buffer is kept as history, so readers can look behind the playhead
+  std::shared_ptr<SampleBuffer> result(new SampleBuffer(buffer_power_, channel_count_, BufferLayout::PLANAR,
+                                                        1u << (buffer_power_ - 1)));
+  buffer_list_.Add(result);
   
   return new ReadOnlyBuffer(result, const_cast<const TimeInfo*>(&info));
 }
 
+std::shared_ptr<MixSource> VorbisManager::CreateMixSource(float gain) {
+  return mixer_.CreateSource(gain);
+}
+
 void VorbisManager::StartWriteThread() {
   if (!packet.thread_signal.test_and_set()) {
     // the last thread wrapped up while we were waiting
@@ -120,19 +192,31 @@ void VorbisManager::StartWriteThread() {
     // thread is NOT already running
     // do everything in here
     run_thread_.store(true, std::memory_order_release);
-    auto func = [](std::shared_ptr<FloatBuf> buf) {buf->Clear();};
-    EraseOrCallback(func);
+    decode_timeline_.Clear();
+    playback_timeline_.Clear();
+    clock_.Reset(sample_rate_);
+    // frame numbers start over with the stream, so the clock and the readers agree on them
+    critical_buffer_->Clear();
+    buffer_list_.Prune();
+    buffer_list_.ForEach([](SampleBuffer* buf) {buf->Clear();});
     write_thread_ = std::thread(&VorbisManager::WriteThreadFn, this);
     write_thread_.detach();
     // wait for the write thread to finish setting up
     while (packet.thread_signal.test_and_set());
-    info.SetSampleRate(sample_rate_);
+    // only once something is actually playing -- otherwise readers would see the playhead move
+    // a rate of 0 tells them nothing is
+    info.SetSampleRate(packet.sink_started.load(std::memory_order_acquire) ? sample_rate_ : 0);
   }
 }
 
+void VorbisManager::SetDecodePolicy(const ThreadPolicy& policy) {
+  decode_policy_ = policy;
+}
+
 void VorbisManager::StopWriteThread() {
   if (packet.thread_signal.test_and_set()) {
     packet.vm_signal.clear();
+    refill_.Signal();
     while (packet.thread_signal.test_and_set()) {
       // take it easy
       std::this_thread::sleep_for(std::chrono::milliseconds(5));
@@ -152,106 +236,134 @@ bool VorbisManager::IsThreadRunning() {
   return run_thread_.load(std::memory_order_acquire);
 }
 
+BufferStats VorbisManager::GetCriticalBufferStats() const {
+  return critical_buffer_->GetStats();
+}
+
+const BlockTimeline& VorbisManager::GetPlaybackTimeline() const {
+  return playback_timeline_;
+}
+
+const BlockTimeline& VorbisManager::GetDecodeTimeline() const {
+  return decode_timeline_;
+}
+
 VorbisManager::~VorbisManager() {
   if (run_thread_.load(std::memory_order_acquire)) {
     StopWriteThread();
   }
 
+  delete sink_;
   delete critical_buffer_;
-  delete[] read_buffer_;
   delete reader_;
   // allow our child threads to keep accessing buffers if they want to :)
 }
 
 // PRIVATE FUNCTIONS
 
-VorbisManager::VorbisManager(int twopow, AudioReader* reader) : run_thread_(false), 
-                                                                buffer_power_(twopow + 1), info()
+VorbisManager::VorbisManager(int twopow, AudioReader* reader, int output_channels, AudioSink* sink)
+                                                              : output_channel_count_(output_channels),
+                                                                output_matrix_(reader->GetChannelCount(), output_channels),
+                                                                decode_timeline_(timeline_power),
+                                                                playback_timeline_(timeline_power),
+                                                                refill_(1u << twopow),
+                                                                mixer_(output_channels, twopow),
+                                                                run_thread_(false), 
+                                                                buffer_power_(twopow + 1), info(&clock_)
                                                                 {
   // stores the number of channels on the file
   // we want to have a marker of the number of channels on the output
   channel_count_ = reader->GetChannelCount();
   sample_rate_ = reader->GetSampleRate();
   reader_ = reader;
+  sink_ = sink;
   
-  critical_buffer_ = new FloatBuf(twopow, channel_count_);
-  read_buffer_ = new float[critical_buffer_->Capacity()];
+  critical_buffer_ = new SampleBuffer(twopow, channel_count_);
+  // only the callback reads it, and it's only ever cleared between streams -- so the callback never locks
+  critical_buffer_->SetSingleConsumer();
 }
 
 // todo: make bool :/
 void VorbisManager::WriteThreadFn() {
-  uint32_t write_threshold = critical_buffer_->Capacity() / 2;
-
-  PaError err;
+  decode_policy_.Apply("dingo-decode");
 
-  // TODO: Should this in fact be volatile???
-
-  PaStream* stream;
-  
   // feel like this could be called within StartWriteThread but either/or i guess
-  PopulateBuffers(critical_buffer_->Capacity());
+  bool more = PopulateBuffers(critical_buffer_->Capacity());
 
   CallbackPacket* callback_packet = new CallbackPacket();
   callback_packet->buf = critical_buffer_;
-  callback_packet->callback_signal.test_and_set();
-
-  err = Pa_OpenDefaultStream(&stream,
-                      0,
-                      2,
-                      paFloat32,
-                      sample_rate_,
-                      paFramesPerBufferUnspecified,
-                      VorbisManager::PaCallback,
-                      reinterpret_cast<void*>(callback_packet));
-  Pa_StartStream(stream);
-  // todo: take latency into account
+  callback_packet->decoded = &decode_timeline_;
+  callback_packet->played = &playback_timeline_;
+  callback_packet->refill = &refill_;
+  callback_packet->matrix = &output_matrix_;
+  callback_packet->clock = &clock_;
+  callback_packet->mixer = &mixer_;
+  callback_packet->decoded_all.store(!more);
+  callback_packet->finished.store(false);
+
+  if (!sink_->Open(output_channel_count_, sample_rate_, VorbisManager::SinkCallback,
+                   reinterpret_cast<void*>(callback_packet)) || !sink_->Start()) {
+    // nowhere to play -- wind down as if the stream had finished
+    packet.sink_started.store(false, std::memory_order_release);
+    sink_->Close();
+    run_thread_.store(false, std::memory_order_release);
+    packet.thread_signal.clear();
+    delete callback_packet;
+    return;
+  }
+
+  // only a fallback until the callback publishes to the clock
   info.ResetEpoch();
+  packet.sink_started.store(true, std::memory_order_release);
   packet.thread_signal.clear();
-  if (err != paNoError) {
-    // cleanup again
-  }
 
-  for (;;) {
+  while (more) {
     if (!packet.vm_signal.test_and_set()) {
       break;
     }
-    if (!PopulateBuffers(write_threshold)) {
+
+    // the callback only raises flags, so this sleeps out the timeout unless we're told to stop
+    refill_.Wait(std::chrono::milliseconds(refill_timeout_ms));
+
+    // the callback only flags drained sources -- let go of them here, off the audio thread
+    mixer_.Collect();
+
+    // top up in one go once the ring is below the watermark -- most of it is still left to play
+    if (critical_buffer_->Size() / channel_count_ >= refill_.GetWatermark()) {
+      continue;
+    }
+
+    // decode after waiting, so that what we decode goes straight in
+    uint32_t free_frames = critical_buffer_->GetMaximumWriteSize() / channel_count_;
+    uint32_t frames = refill_.GetRefillFrames(free_frames);
+    if (frames == 0) {
+      continue;
+    }
+
+    if (!PopulateBuffers(frames * channel_count_)) {
       // stream is empty -- done reading
       break;
     }
   }
 
-  // wait for the callback to wind down
-  while (callback_packet->callback_signal.test_and_set());
-  // callback is done -- killit
-  Pa_CloseStream(stream);
-  err = Pa_Terminate();
-  if (err != paNoError) {
-    // something is fucky!
+  // nothing more is coming (or we've been told to stop) -- let the callback play out what's
+  // left, and wait for it to say it's done. the flag only ever goes up, so it can't be missed
+  // however early the callback gets there
+  callback_packet->decoded_all.store(true, std::memory_order_release);
+  while (!callback_packet->finished.load(std::memory_order_acquire)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
   }
 
+  // callback is done -- killit
+  // PortAudio itself stays up (whoever called Pa_Initialize terminates it), so the next
+  // StartWriteThread can open a stream without reinitializing
+  sink_->Close();
+
   run_thread_.store(false, std::memory_order_release);
   packet.thread_signal.clear();
   delete callback_packet;
 }
 
-void VorbisManager::EraseOrCallback(const std::function<void(std::shared_ptr<FloatBuf>)>& func) {
-  std::shared_ptr<AudioBufferSPSC<float>> ptr;
-  std::lock_guard lock(buffer_list_lock_);
-  auto itr = buffer_list_.begin();
-  while (itr != buffer_list_.end()) {
-    ptr = itr->lock();
-    // see if it is in fact expired
-    if (itr->expired()) {
-      // delete it if so
-      itr = buffer_list_.erase(itr);
-    } else {
-      func(ptr);
-    }
-    itr++;
-  }
-}
-
 bool VorbisManager::PopulateBuffers(unsigned int write_size) {
   if (write_size > critical_buffer_->Capacity()) {
     // something is wrong!
@@ -259,28 +371,41 @@ bool VorbisManager::PopulateBuffers(unsigned int write_size) {
     // what the fuck are you doing broh!
   }
 
-  int readsize = reader_->GetSamplesInterleaved(write_size, read_buffer_);
-  // spin until space is available
-  while (critical_buffer_->GetMaximumWriteSize() < write_size) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  // decode straight into the critical buffer's free space -- no staging copy
+  WriteRegion<SampleStorage> region = critical_buffer_->Reserve(write_size / channel_count_);
+  uint32_t readsize = DecodeToRegion(reader_, region);
+
+  // readers get their copy from the same memory, before the callback can see it.
+  // one copy per reader is on purpose: each keeps its own read head and history, and a reader
+  // which falls behind is force-written past -- a shared ring would have to hold everything back
+  // for its slowest reader, or hand the decoder a reader to wait on. readers are few and the
+  // copies are cheap next to decoding
+  uint32_t remaining = readsize;
+  for (int part = 0; part < 2 && remaining > 0; part++) {
+    uint32_t len = (remaining < region.Length(part) ? remaining : region.Length(part));
+    const SampleStorage* input = region.Data(0, part);
+    int writesize = static_cast<int>(len) * channel_count_;
+    buffer_list_.ForEach([input, writesize](SampleBuffer* buf) {
+      FillBufferListCallback(buf, input, writesize);
+    });
+
+    remaining -= len;
   }
-  // todo: this takes up a good chunk of cpu resources afaik
-  // telling the buffer to sleep a bit before checking this might be best
-
-  int writesize = (readsize * channel_count_);
-  auto callback = [this, writesize](std::shared_ptr<FloatBuf> buf) {
-    FillBufferListCallback(buf, read_buffer_, writesize);
-  };
-
-  EraseOrCallback(callback);
-  critical_buffer_->Write(read_buffer_, writesize);
 
+  // someone's let go of their buffer -- stop writing to it
+  if (buffer_list_.HasOrphans()) {
+    buffer_list_.Prune();
+  }
 
+  critical_buffer_->Commit(readsize);
+  if (readsize > 0) {
+    decode_timeline_.Publish({region.frame, readsize, BlockTimeline::Now(), -1.0});
+  }
 
-  return ((write_size / channel_count_) == readsize);
+  return (readsize == region.length);
 }
 
-void VorbisManager::FillBufferListCallback(std::shared_ptr<FloatBuf> buf, float* input, int write_size) {
+void VorbisManager::FillBufferListCallback(SampleBuffer* buf, const SampleStorage* input, int write_size) {
   // try to write
   if (!buf->Write(input, write_size)) {
     // if it fails...
@@ -289,50 +414,48 @@ void VorbisManager::FillBufferListCallback(std::shared_ptr<FloatBuf> buf, float*
   }
 }
 
-int VorbisManager::PaCallback(  const void* input,
-                                void* output,
-                                unsigned long frameCount,
-                                const PaStreamCallbackTimeInfo* info,
-                                PaStreamCallbackFlags statusFlags,
-                                void* userdata  )
-{
+bool VorbisManager::SinkCallback(float* output_data, uint32_t frameCount, double dac_time, void* userdata) {
+  // no allocating, locking or printing past here -- see RealtimeCheck
+  RealtimeScope realtime;
   CallbackPacket* packet = reinterpret_cast<CallbackPacket*>(userdata);
-  float* output_data = reinterpret_cast<float*>(output);
-  FloatBuf* buf = packet->buf;
-  size_t samplecount = frameCount * (buf->GetChannelCount());
-  // ensure that this all matches up -- if input only has one channel then do something else
-  if (!buf->ReadToBuffer(samplecount, output_data, 2)) {
-    if (buf->Empty()) {
-      // send zeroes to the buffer
-      for (size_t i = 0; i < samplecount; i++) {
-        output_data[i] = 0.0f;
-      }
-      packet->callback_signal.clear();
-    } else {
-      // there's at least some data that we can read
-      // read what we can and pad the rest with zeroes
-      float* remaining_data;
-      size_t samples_read = buf->Peek(samplecount, &remaining_data);
-      size_t offset;
-
-      // assumption that audio file has fewer channels than output
-      int sample_channel_ratio = 2 / buf->GetChannelCount();
-      std::cout << sample_channel_ratio;
-      
-      for (offset = 0; offset < samples_read; offset++) { 
-        for (int i = 0; i < sample_channel_ratio; i++) {
-          output_data[sample_channel_ratio * offset + i] = remaining_data[offset];
-        }
-      }
-
-      for (; offset < samplecount; offset++) {
-        output_data[offset] = 0.0f;
-      }
-
-      packet->callback_signal.clear();
-    }
+  SampleBuffer* buf = packet->buf;
+  const ChannelMatrix* matrix = packet->matrix;
+  int output_channels = matrix->GetOutputChannels();
+  uint64_t frame = buf->GetReadFrame();
+
+  // read before the ring, so that a short read after it means everything has played
+  bool decoded_all = packet->decoded_all.load(std::memory_order_acquire);
+
+  // map straight out of the ring onto the device's channels -- one pass, no staging copy
+  float* cursor = output_data;
+  uint32_t frames_played = buf->ReadInPlace(frameCount,
+    [matrix, output_channels, &cursor](const SampleStorage* data, uint32_t frames) {
+      matrix->Apply(data, cursor, frames);
+      cursor += static_cast<size_t>(frames) * output_channels;
+    });
+
+  if (frames_played < frameCount) {
+    // ran dry -- pad the rest with silence
+    std::fill(cursor, output_data + static_cast<size_t>(frameCount) * output_channels, 0.0f);
   }
 
-  return 0;
-}
+  packet->mixer->MixOnto(output_data, frameCount);
+
+  packet->refill->OnConsumed(frameCount,
+                             static_cast<uint32_t>(buf->Size() / buf->GetChannelCount()));
+
+  if (frames_played > 0) {
+    BlockStamp decoded;
+    double decode_time = (packet->decoded->FindFrame(frame, &decoded) ? decoded.decode_time : -1.0);
+    packet->played->Publish({frame, frames_played, decode_time, dac_time});
+    packet->clock->Publish(frame, frames_played, dac_time);
+  }
 
+  // an underrun mid-stream isn't the end -- only stop once everything decoded has played
+  if (decoded_all && frames_played < frameCount) {
+    packet->finished.store(true, std::memory_order_release);
+    return false;
+  }
+
+  return true;
+}
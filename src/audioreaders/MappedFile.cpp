@@ -0,0 +1,100 @@
+#include "audioreaders/MappedFile.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : data_(nullptr), size_(0), mapped_(false) { }
+
+MappedFile* MappedFile::Open(const std::string& file) {
+  if (file.empty()) {
+    return nullptr;
+  }
+
+#if defined(MAPPED_FILE_MMAP)
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+
+  size_t size = static_cast<size_t>(info.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // the mapping holds its own reference to the file
+  close(fd);
+  if (data != MAP_FAILED) {
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    MappedFile* result = new MappedFile();
+    result->data_ = static_cast<const unsigned char*>(data);
+    result->size_ = size;
+    result->mapped_ = true;
+    return result;
+  }
+#endif
+
+  // no mmap, or it refused -- fall back to a copy
+  std::ifstream stream(file, std::ios::binary);
+  if (!stream) {
+    return nullptr;
+  }
+
+  MappedFile* result = new MappedFile();
+  result->copy_.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+  if (result->copy_.empty()) {
+    delete result;
+    return nullptr;
+  }
+
+  result->data_ = result->copy_.data();
+  result->size_ = result->copy_.size();
+  return result;
+}
+
+const unsigned char* MappedFile::GetData() const {
+  return data_;
+}
+
+size_t MappedFile::GetSize() const {
+  return size_;
+}
+
+bool MappedFile::IsMapped() const {
+  return mapped_;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t length) const {
+#if defined(MAPPED_FILE_MMAP)
+  if (!mapped_ || offset >= size_) {
+    return;
+  }
+
+  length = std::min(length, size_ - offset);
+
+  // madvise wants a page-aligned start
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t start = offset - (offset % page);
+  madvise(const_cast<unsigned char*>(data_) + start, length + (offset - start), MADV_WILLNEED);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#if defined(MAPPED_FILE_MMAP)
+  if (mapped_) {
+    munmap(const_cast<unsigned char*>(data_), size_);
+  }
+#endif
+}
@@ -0,0 +1,188 @@
+#include <audioreaders/MappedFile.hpp>
+#include <audioreaders/MemoryReader.hpp>
+#include <audioreaders/OggSeekIndex.hpp>
+#include <stb_vorbis.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// decodes frames [start, start + frames) into output, which holds exactly that many frames
+// the page index takes each thread straight to its first page, instead of bisecting for it
+bool DecodeRange(const MappedFile& data, const OggSeekIndex& index,
+                 uint64_t start, uint64_t frames, float* output) {
+  int err;
+  stb_vorbis* file = stb_vorbis_open_memory(data.GetData(), static_cast<int>(data.GetSize()), &err, NULL);
+  if (file == NULL) {
+    return false;
+  }
+
+  stb_vorbis_info info = stb_vorbis_get_info(file);
+  int channels = info.channels;
+  bool result;
+  if (start == 0) {
+    result = (stb_vorbis_seek_start(file) != 0);
+  } else {
+    uint64_t left, right;
+    index.FindPages(start, static_cast<uint64_t>(info.max_frame_size), &left, &right);
+    result = (stb_vorbis_seek_hinted(file, static_cast<unsigned int>(start),
+                                     static_cast<unsigned int>(left), static_cast<unsigned int>(right)) != 0);
+  }
+
+  while (result && frames > 0) {
+    int len = static_cast<int>(std::min<uint64_t>(frames, 4096));
+    int read = stb_vorbis_get_samples_float_interleaved(file, channels, output, len * channels);
+    if (read == 0) {
+      // stream is shorter than advertised -- leave the rest silent
+      std::fill(output, output + frames * channels, 0.0f);
+      break;
+    }
+
+    output += static_cast<size_t>(read) * channels;
+    frames -= read;
+  }
+
+  stb_vorbis_close(file);
+  return result;
+}
+
+}  // namespace
+
+MemoryReader::MemoryReader(std::vector<float> samples, int channels, int sample_rate)
+  : samples_(std::move(samples)),
+    channels_(channels),
+    sample_rate_(sample_rate),
+    frame_count_(samples_.size() / channels),
+    position_(0) { }
+
+MemoryReader* MemoryReader::PreDecodeVorbis(std::string file, int threads, int max_seconds) {
+  if (file.empty()) {
+    return nullptr;
+  }
+
+  // the decode threads read straight out of the page cache -- no copy of the file
+  std::unique_ptr<MappedFile> mapping(MappedFile::Open(file));
+  if (mapping == nullptr || mapping->GetSize() > static_cast<size_t>(INT_MAX)) {
+    return nullptr;
+  }
+
+  int err;
+  stb_vorbis* header = stb_vorbis_open_memory(mapping->GetData(), static_cast<int>(mapping->GetSize()), &err, NULL);
+  if (header == NULL) {
+    return nullptr;
+  }
+
+  stb_vorbis_info info = stb_vorbis_get_info(header);
+  uint64_t total = stb_vorbis_stream_length_in_samples(header);
+  stb_vorbis_close(header);
+
+  if (total == 0 || (max_seconds > 0 && total > static_cast<uint64_t>(max_seconds) * info.sample_rate)) {
+    return nullptr;
+  }
+
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  // every byte is about to be read -- have the kernel start on all of it
+  mapping->Prefetch(0, mapping->GetSize());
+  std::unique_ptr<OggSeekIndex> index(OggSeekIndex::Scan(mapping->GetData(), mapping->GetSize()));
+  if (index == nullptr) {
+    return nullptr;
+  }
+
+  const std::vector<OggPage>& pages = index->GetPages();
+
+  // cut at the last page boundary before each even split -- duplicates collapse, so
+  // very short streams may get fewer ranges than threads
+  std::vector<uint64_t> bounds = { 0 };
+  for (int k = 1; k < threads; k++) {
+    uint64_t target = total * k / threads;
+    auto page = std::upper_bound(pages.begin(), pages.end(), target,
+      [](uint64_t value, const OggPage& page) { return value < page.granule; });
+    if (page != pages.begin() && (page - 1)->granule > bounds.back() && (page - 1)->granule < total) {
+      bounds.push_back((page - 1)->granule);
+    }
+  }
+
+  bounds.push_back(total);
+
+  std::vector<float> samples(total * info.channels);
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i + 1 < bounds.size(); i++) {
+    float* output = samples.data() + bounds[i] * info.channels;
+    workers.emplace_back([&mapping, &index, &failed, start = bounds[i], frames = bounds[i + 1] - bounds[i], output] {
+      if (!DecodeRange(*mapping, *index, start, frames, output)) {
+        failed.store(true);
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  if (failed.load()) {
+    return nullptr;
+  }
+
+  return new MemoryReader(std::move(samples), info.channels, info.sample_rate);
+}
+
+uint64_t MemoryReader::Advance(int& frames) {
+  std::lock_guard lock(read_lock_);
+  uint64_t start = position_;
+  frames = static_cast<int>(std::min<uint64_t>(std::max(frames, 0), frame_count_ - start));
+  position_ += frames;
+  return start;
+}
+
+int MemoryReader::GetSamplesInterleaved(int count, float* output) {
+  int frames = count / channels_;
+  const float* data = samples_.data() + Advance(frames) * channels_;
+  std::copy(data, data + static_cast<size_t>(frames) * channels_, output);
+  return frames;
+}
+
+int MemoryReader::GetSamplesInterleaved(int count, int16_t* output) {
+  int frames = count / channels_;
+  const float* data = samples_.data() + Advance(frames) * channels_;
+  kernels::Convert(data, output, static_cast<size_t>(frames) * channels_);
+  return frames;
+}
+
+int MemoryReader::GetSamplesPlanar(int frames, float* const* output) {
+  const float* data = samples_.data() + Advance(frames) * channels_;
+  kernels::Deinterleave(data, output, channels_, static_cast<uint32_t>(frames));
+  return frames;
+}
+
+int MemoryReader::GetSampleRate() {
+  return sample_rate_;
+}
+
+int MemoryReader::GetChannelCount() {
+  return channels_;
+}
+
+void MemoryReader::Seek(int sample) {
+  std::lock_guard lock(read_lock_);
+  position_ = std::min<uint64_t>(std::max(sample, 0), frame_count_);
+}
+
+int64_t MemoryReader::GetLength() {
+  return static_cast<int64_t>(frame_count_);
+}
+
+const float* MemoryReader::GetData() const {
+  return samples_.data();
+}
+
+uint64_t MemoryReader::GetFrameCount() const {
+  return frame_count_;
+}
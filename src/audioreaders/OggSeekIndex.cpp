@@ -0,0 +1,254 @@
+#include <audioreaders/OggSeekIndex.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+// 27 byte header: "OggS", version, flags, granule (8, LE), serial, sequence, crc, segment count
+const size_t HEADER_SIZE = 27;
+
+// saved indices start with this, then the stream size, page count and pages -- all little-endian
+const char INDEX_MAGIC[8] = { 'O', 'g', 'g', 'I', 'd', 'x', '0', '1' };
+
+uint64_t ReadLE(const unsigned char* data, int bytes) {
+  uint64_t result = 0;
+  for (int i = bytes - 1; i >= 0; i--) {
+    result = (result << 8) | data[i];
+  }
+
+  return result;
+}
+
+void WriteLE(uint64_t value, unsigned char* data) {
+  for (int i = 0; i < 8; i++) {
+    data[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+}
+
+bool IsPage(const unsigned char* header) {
+  return (header[0] == 'O' && header[1] == 'g' && header[2] == 'g' && header[3] == 'S');
+}
+
+/**
+ *  Records a page if it belongs to the first stream and finishes a packet.
+ */
+void AddPage(const unsigned char* header, uint64_t offset, std::vector<OggPage>* pages, uint64_t* serial) {
+  uint64_t page_serial = ReadLE(header + 14, 4);
+  if (offset == 0) {
+    *serial = page_serial;
+  }
+
+  uint64_t granule = ReadLE(header + 6, 8);
+  // -1 means no packet finishes on this page
+  if (page_serial == *serial && granule != UINT64_MAX) {
+    pages->push_back({offset, granule});
+  }
+}
+
+uint64_t GetFileSize(FILE* file) {
+  std::fseek(file, 0, SEEK_END);
+  uint64_t size = static_cast<uint64_t>(std::ftell(file));
+  std::fseek(file, 0, SEEK_SET);
+  return size;
+}
+
+}  // namespace
+
+OggSeekIndex* OggSeekIndex::Scan(const unsigned char* data, size_t size) {
+  std::vector<OggPage> pages;
+  uint64_t serial = 0;
+  size_t offset = 0;
+  while (offset + HEADER_SIZE <= size && IsPage(data + offset)) {
+    const unsigned char* page = data + offset;
+    int segments = page[26];
+    if (offset + HEADER_SIZE + segments > size) {
+      break;
+    }
+
+    size_t body = 0;
+    for (int i = 0; i < segments; i++) {
+      body += page[HEADER_SIZE + i];
+    }
+
+    AddPage(page, offset, &pages, &serial);
+    offset += HEADER_SIZE + segments + body;
+  }
+
+  if (pages.empty()) {
+    return nullptr;
+  }
+
+  return new OggSeekIndex(std::move(pages), size);
+}
+
+OggSeekIndex* OggSeekIndex::Build(const std::string& file) {
+  FILE* input = std::fopen(file.c_str(), "rb");
+  if (input == NULL) {
+    return nullptr;
+  }
+
+  uint64_t size = GetFileSize(input);
+  std::vector<OggPage> pages;
+  uint64_t serial = 0;
+  uint64_t offset = 0;
+  unsigned char header[HEADER_SIZE + 255];
+  // headers only -- the bodies are skipped over
+  while (offset + HEADER_SIZE <= size) {
+    if (std::fread(header, 1, HEADER_SIZE, input) != HEADER_SIZE || !IsPage(header)) {
+      break;
+    }
+
+    int segments = header[26];
+    if (std::fread(header + HEADER_SIZE, 1, segments, input) != static_cast<size_t>(segments)) {
+      break;
+    }
+
+    long body = 0;
+    for (int i = 0; i < segments; i++) {
+      body += header[HEADER_SIZE + i];
+    }
+
+    AddPage(header, offset, &pages, &serial);
+    offset += HEADER_SIZE + segments + body;
+    std::fseek(input, body, SEEK_CUR);
+  }
+
+  std::fclose(input);
+  if (pages.empty()) {
+    return nullptr;
+  }
+
+  return new OggSeekIndex(std::move(pages), size);
+}
+
+OggSeekIndex* OggSeekIndex::Load(const std::string& index_file, const std::string& file) {
+  FILE* index = std::fopen(index_file.c_str(), "rb");
+  if (index == NULL) {
+    return nullptr;
+  }
+
+  unsigned char header[24];
+  std::vector<OggPage> pages;
+  uint64_t size = 0;
+  bool valid = (std::fread(header, 1, sizeof(header), index) == sizeof(header) &&
+                std::equal(INDEX_MAGIC, INDEX_MAGIC + 8, header));
+  if (valid) {
+    size = ReadLE(header + 8, 8);
+    uint64_t count = ReadLE(header + 16, 8);
+    // a page is at least a header long -- anything more is a corrupt count
+    valid = (count > 0 && count <= size / HEADER_SIZE);
+    if (valid) {
+      std::vector<unsigned char> raw(count * 16);
+      valid = (std::fread(raw.data(), 1, raw.size(), index) == raw.size());
+      for (uint64_t i = 0; valid && i < count; i++) {
+        pages.push_back({ReadLE(&raw[i * 16], 8), ReadLE(&raw[i * 16 + 8], 8)});
+        valid = (pages[i].offset < size && (i == 0 || pages[i].offset > pages[i - 1].offset));
+      }
+    }
+  }
+
+  std::fclose(index);
+  if (!valid) {
+    return nullptr;
+  }
+
+  // a stale index is worse than none -- check the pages are still where it says
+  FILE* input = std::fopen(file.c_str(), "rb");
+  if (input == NULL) {
+    return nullptr;
+  }
+
+  valid = (GetFileSize(input) == size);
+  for (size_t i : { static_cast<size_t>(0), pages.size() / 2, pages.size() - 1 }) {
+    unsigned char page[HEADER_SIZE];
+    valid = valid && std::fseek(input, static_cast<long>(pages[i].offset), SEEK_SET) == 0 &&
+            std::fread(page, 1, HEADER_SIZE, input) == HEADER_SIZE &&
+            IsPage(page) && ReadLE(page + 6, 8) == pages[i].granule;
+  }
+
+  std::fclose(input);
+  if (!valid) {
+    return nullptr;
+  }
+
+  return new OggSeekIndex(std::move(pages), size);
+}
+
+OggSeekIndex* OggSeekIndex::GetIndex(const std::string& file, const std::string& cache_dir) {
+  std::string path = GetIndexPath(file, cache_dir);
+  OggSeekIndex* index = Load(path, file);
+  if (index != nullptr) {
+    return index;
+  }
+
+  index = Build(file);
+  if (index != nullptr) {
+    index->Save(path);
+  }
+
+  return index;
+}
+
+std::string OggSeekIndex::GetIndexPath(const std::string& file, const std::string& cache_dir) {
+  if (cache_dir.empty()) {
+    return file + ".seekidx";
+  }
+
+  // files from different directories can share a name -- tell them apart by their full path
+  size_t slash = file.find_last_of("/\\");
+  std::string name = (slash == std::string::npos ? file : file.substr(slash + 1));
+  char hash[17];
+  std::snprintf(hash, sizeof(hash), "%016llx",
+                static_cast<unsigned long long>(std::hash<std::string>()(file)));
+  return cache_dir + "/" + name + "." + hash + ".seekidx";
+}
+
+bool OggSeekIndex::Save(const std::string& index_file) const {
+  std::vector<unsigned char> raw(24 + pages_.size() * 16);
+  std::copy(INDEX_MAGIC, INDEX_MAGIC + 8, raw.begin());
+  WriteLE(size_, &raw[8]);
+  WriteLE(pages_.size(), &raw[16]);
+  for (size_t i = 0; i < pages_.size(); i++) {
+    WriteLE(pages_[i].offset, &raw[24 + i * 16]);
+    WriteLE(pages_[i].granule, &raw[32 + i * 16]);
+  }
+
+  FILE* output = std::fopen(index_file.c_str(), "wb");
+  if (output == NULL) {
+    return false;
+  }
+
+  bool result = (std::fwrite(raw.data(), 1, raw.size(), output) == raw.size());
+  result = (std::fclose(output) == 0) && result;
+  if (!result) {
+    // don't leave a truncated index behind
+    std::remove(index_file.c_str());
+  }
+
+  return result;
+}
+
+void OggSeekIndex::FindPages(uint64_t frame, uint64_t margin, uint64_t* left, uint64_t* right) const {
+  auto after = std::upper_bound(pages_.begin(), pages_.end(), frame,
+    [](uint64_t value, const OggPage& page) { return value < page.granule; });
+  *right = (after == pages_.end() ? pages_.back().offset : after->offset);
+
+  auto before = std::lower_bound(pages_.begin(), pages_.end(), frame,
+    [margin](const OggPage& page, uint64_t value) { return page.granule + margin < value; });
+  *left = (before == pages_.begin() ? 0 : (before - 1)->offset);
+}
+
+const std::vector<OggPage>& OggSeekIndex::GetPages() const {
+  return pages_;
+}
+
+uint64_t OggSeekIndex::GetSize() const {
+  return size_;
+}
+
+// PRIVATE FUNCTIONS
+
+OggSeekIndex::OggSeekIndex(std::vector<OggPage> pages, uint64_t size)
+  : pages_(std::move(pages)), size_(size) { }
@@ -0,0 +1,79 @@
+#include <audioreaders/ResamplingReader.hpp>
+
+#include <algorithm>
+
+// input frames pulled from the source at a time
+const uint32_t resample_block = 1024;
+
+ResamplingReader::ResamplingReader(AudioReader* source, int out_rate, uint32_t taps)
+  : source_(source),
+    out_rate_(out_rate),
+    channels_(source->GetChannelCount()),
+    resampler_(source->GetSampleRate(), out_rate, source->GetChannelCount(), taps, resample_block),
+    input_(static_cast<size_t>(resample_block) * channels_),
+    pending_(static_cast<size_t>(resampler_.GetMaxOutput(resample_block) +
+                                 resampler_.GetMaxOutput(resampler_.GetDelay())) * channels_),
+    pending_offset_(0),
+    pending_size_(0),
+    flushed_(false) { }
+
+int ResamplingReader::GetSamplesInterleaved(int count, float* output) {
+  std::lock_guard lock(read_lock_);
+  size_t wanted = static_cast<size_t>(count / channels_) * channels_;
+  size_t written = 0;
+  while (written < wanted) {
+    if (pending_offset_ < pending_size_) {
+      size_t len = std::min(pending_size_ - pending_offset_, wanted - written);
+      std::copy(pending_.begin() + pending_offset_, pending_.begin() + pending_offset_ + len, output + written);
+      pending_offset_ += len;
+      written += len;
+      continue;
+    }
+
+    if (flushed_) {
+      break;
+    }
+
+    int read = source_->GetSamplesInterleaved(static_cast<int>(input_.size()), input_.data());
+    uint32_t frames = resampler_.Process(input_.data(), static_cast<uint32_t>(read), pending_.data());
+    if (read < static_cast<int>(resample_block)) {
+      // end of the source -- push out what the filter is holding back
+      frames += resampler_.Flush(pending_.data() + static_cast<size_t>(frames) * channels_);
+      flushed_ = true;
+    }
+
+    pending_offset_ = 0;
+    pending_size_ = static_cast<size_t>(frames) * channels_;
+  }
+
+  return static_cast<int>(written / channels_);
+}
+
+int ResamplingReader::GetSampleRate() {
+  return out_rate_;
+}
+
+int ResamplingReader::GetChannelCount() {
+  return channels_;
+}
+
+void ResamplingReader::Seek(int sample) {
+  std::lock_guard lock(read_lock_);
+  int64_t input_frame = static_cast<int64_t>(std::max(sample, 0)) * resampler_.GetDownFactor() / resampler_.GetUpFactor();
+  source_->Seek(static_cast<int>(input_frame));
+  resampler_.Reset();
+  pending_offset_ = 0;
+  pending_size_ = 0;
+  flushed_ = false;
+}
+
+int64_t ResamplingReader::GetLength() {
+  int64_t length = source_->GetLength();
+  if (length < 0) {
+    return -1;
+  }
+
+  uint64_t up = resampler_.GetUpFactor();
+  uint64_t down = resampler_.GetDownFactor();
+  return static_cast<int64_t>((static_cast<uint64_t>(length) * up + down - 1) / down);
+}
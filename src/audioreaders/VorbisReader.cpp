@@ -1,6 +1,12 @@
 #include <audioreaders/VorbisReader.hpp>
 
-VorbisReader::VorbisReader(stb_vorbis* file) {
+#include <climits>
+
+// bytes kept paged in ahead of the decode cursor, for mapped files -- topped up once the
+// cursor is halfway through it. at typical bitrates this is tens of seconds of audio
+const size_t prefetch_window = 512 * 1024;
+
+VorbisReader::VorbisReader(stb_vorbis* file) : prefetched_(0) {
   file_ = file;
   info_ = stb_vorbis_get_info(file_);
 }
@@ -19,11 +25,52 @@ VorbisReader* VorbisReader::GetVorbisReader(std::string file) {
   return new VorbisReader(vorbis_file);
 }
 
+VorbisReader* VorbisReader::GetIndexedVorbisReader(std::string file, std::string cache_dir) {
+  VorbisReader* reader = GetVorbisReader(file);
+  if (reader != nullptr) {
+    reader->index_.reset(OggSeekIndex::GetIndex(file, cache_dir));
+  }
+
+  return reader;
+}
+
+VorbisReader* VorbisReader::GetMappedVorbisReader(std::string file) {
+  std::unique_ptr<MappedFile> mapping(MappedFile::Open(file));
+  if (mapping == nullptr || !mapping->IsMapped() || mapping->GetSize() > static_cast<size_t>(INT_MAX)) {
+    return GetVorbisReader(file);
+  }
+
+  int err;
+  stb_vorbis* vorbis_file = stb_vorbis_open_memory(mapping->GetData(), static_cast<int>(mapping->GetSize()), &err, NULL);
+  if (vorbis_file == NULL) {
+    return nullptr;
+  }
+
+  VorbisReader* reader = new VorbisReader(vorbis_file);
+  reader->mapping_ = std::move(mapping);
+  reader->PrefetchAhead();
+  return reader;
+}
+
 int VorbisReader::GetSamplesInterleaved(int count, float* output) {
   std::lock_guard lock(read_lock_);
+  PrefetchAhead();
   return stb_vorbis_get_samples_float_interleaved(file_, info_.channels, output, count);
 }
 
+int VorbisReader::GetSamplesInterleaved(int count, int16_t* output) {
+  std::lock_guard lock(read_lock_);
+  PrefetchAhead();
+  return stb_vorbis_get_samples_short_interleaved(file_, info_.channels, output, count);
+}
+
+int VorbisReader::GetSamplesPlanar(int frames, float* const* output) {
+  std::lock_guard lock(read_lock_);
+  PrefetchAhead();
+  // stb_vorbis decodes planar internally -- this just copies each channel out
+  return stb_vorbis_get_samples_float(file_, info_.channels, const_cast<float**>(output), frames);
+}
+
 int VorbisReader::GetSampleRate() {
   return info_.sample_rate;
 }
@@ -34,9 +81,38 @@ int VorbisReader::GetChannelCount() {
 
 void VorbisReader::Seek(int sample) {
   std::lock_guard lock(read_lock_);
-  stb_vorbis_seek(file_, sample);
+  // wherever we land, the old window is no use
+  prefetched_ = 0;
+  if (index_ == nullptr) {
+    stb_vorbis_seek(file_, sample);
+    return;
+  }
+
+  // the decoder needs the packet before the target, so the left page has to end a frame early
+  uint64_t left, right;
+  index_->FindPages(static_cast<uint64_t>(sample), static_cast<uint64_t>(info_.max_frame_size), &left, &right);
+  stb_vorbis_seek_hinted(file_, sample, static_cast<unsigned int>(left), static_cast<unsigned int>(right));
+}
+
+int64_t VorbisReader::GetLength() {
+  std::lock_guard lock(read_lock_);
+  return stb_vorbis_stream_length_in_samples(file_);
 }
 
 VorbisReader::~VorbisReader() {
   stb_vorbis_close(file_);
+}
+
+// PRIVATE FUNCTIONS
+
+void VorbisReader::PrefetchAhead() {
+  if (mapping_ == nullptr) {
+    return;
+  }
+
+  size_t offset = stb_vorbis_get_file_offset(file_);
+  if (offset + prefetch_window / 2 > prefetched_ || offset + prefetch_window < prefetched_) {
+    mapping_->Prefetch(offset, prefetch_window);
+    prefetched_ = offset + prefetch_window;
+  }
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "audiosinks/NullSink.hpp"
+#include "audiohandlers/BlockTimeline.hpp"
+
+#include <chrono>
+
+NullSink::NullSink(SinkClock clock, uint32_t block_frames, double latency)
+  : clock_(clock),
+    block_frames_(block_frames),
+    latency_(latency),
+    channels_(0),
+    sample_rate_(0),
+    callback_(nullptr),
+    userdata_(nullptr),
+    open_(false),
+    running_(false),
+    finished_(false),
+    frames_played_(0) { }
+
+bool NullSink::Open(int channels, int sample_rate, SinkCallback callback, void* userdata) {
+  if (open_ || channels <= 0 || sample_rate <= 0 || block_frames_ == 0) {
+    return false;
+  }
+
+  channels_ = channels;
+  sample_rate_ = sample_rate;
+  callback_ = callback;
+  userdata_ = userdata;
+  block_.assign(static_cast<size_t>(block_frames_) * channels, 0.0f);
+  frames_played_.store(0);
+  finished_.store(false);
+  open_ = OnOpen(channels, sample_rate);
+  return open_;
+}
+
+bool NullSink::Start() {
+  if (!open_ || thread_.joinable()) {
+    return false;
+  }
+
+  running_.store(true);
+  thread_ = std::thread(&NullSink::ThreadFn, this);
+  return true;
+}
+
+void NullSink::Stop() {
+  running_.store(false);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void NullSink::Close() {
+  if (open_) {
+    Stop();
+    OnClose();
+    open_ = false;
+  }
+}
+
+uint64_t NullSink::GetFramesPlayed() const {
+  return frames_played_.load(std::memory_order_acquire);
+}
+
+bool NullSink::IsFinished() const {
+  return finished_.load(std::memory_order_acquire);
+}
+
+NullSink::~NullSink() {
+  // Close calls a virtual, and a derived sink is already gone by now -- they close themselves
+  Stop();
+}
+
+// PROTECTED FUNCTIONS
+
+bool NullSink::OnOpen(int channels, int sample_rate) {
+  return true;
+}
+
+void NullSink::OnBlock(const float* data, uint32_t frames) { }
+
+void NullSink::OnClose() { }
+
+// PRIVATE FUNCTIONS
+
+void NullSink::ThreadFn() {
+  // picks up where the last Start left off
+  uint64_t first = frames_played_.load(std::memory_order_relaxed);
+  double start = BlockTimeline::Now();
+  auto wall_start = std::chrono::steady_clock::now();
+
+  while (running_.load(std::memory_order_acquire) && !finished_.load(std::memory_order_relaxed)) {
+    uint64_t played = frames_played_.load(std::memory_order_relaxed) - first;
+    double offset = static_cast<double>(played) / sample_rate_;
+    double dac_time = start + offset;
+    if (clock_ == SinkClock::REALTIME) {
+      // a device asks for each block as the last one starts playing
+      std::this_thread::sleep_until(wall_start + std::chrono::duration<double>(offset));
+      dac_time += latency_;
+    }
+
+    bool more = callback_(block_.data(), block_frames_, dac_time, userdata_);
+    OnBlock(block_.data(), block_frames_);
+    frames_played_.fetch_add(block_frames_, std::memory_order_release);
+    if (!more) {
+      finished_.store(true, std::memory_order_release);
+    }
+  }
+}
@@ -0,0 +1,79 @@
+#include "audiosinks/PortAudioSink.hpp"
+#include "audiohandlers/BlockTimeline.hpp"
+
+PortAudioSink::PortAudioSink() : stream_(nullptr), started_(false), callback_(nullptr), userdata_(nullptr) { }
+
+bool PortAudioSink::Open(int channels, int sample_rate, SinkCallback callback, void* userdata) {
+  if (stream_ != nullptr) {
+    return false;
+  }
+
+  callback_ = callback;
+  userdata_ = userdata;
+  PaError err = Pa_OpenDefaultStream(&stream_,
+                                     0,
+                                     channels,
+                                     paFloat32,
+                                     sample_rate,
+                                     paFramesPerBufferUnspecified,
+                                     PortAudioSink::PaCallback,
+                                     reinterpret_cast<void*>(this));
+  if (err != paNoError) {
+    stream_ = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+bool PortAudioSink::Start() {
+  if (stream_ == nullptr || started_) {
+    return false;
+  }
+
+  started_ = (Pa_StartStream(stream_) == paNoError);
+  return started_;
+}
+
+void PortAudioSink::Stop() {
+  if (started_) {
+    // waits for the callback to return, and for what it's written to play out
+    Pa_StopStream(stream_);
+    started_ = false;
+  }
+}
+
+void PortAudioSink::Close() {
+  if (stream_ != nullptr) {
+    Stop();
+    Pa_CloseStream(stream_);
+    stream_ = nullptr;
+  }
+}
+
+PortAudioSink::~PortAudioSink() {
+  Close();
+}
+
+// PRIVATE FUNCTIONS
+
+int PortAudioSink::PaCallback(  const void* input,
+                                void* output,
+                                unsigned long frameCount,
+                                const PaStreamCallbackTimeInfo* info,
+                                PaStreamCallbackFlags statusFlags,
+                                void* userdata  )
+{
+  PortAudioSink* sink = reinterpret_cast<PortAudioSink*>(userdata);
+
+  // PA reports times on the stream's own clock -- shift the DAC time onto the steady clock
+  double now = BlockTimeline::Now();
+  double dac_time = now;
+  if (info != nullptr && info->currentTime > 0.0 && info->outputBufferDacTime >= info->currentTime) {
+    dac_time = now + (info->outputBufferDacTime - info->currentTime);
+  }
+
+  bool more = sink->callback_(reinterpret_cast<float*>(output), static_cast<uint32_t>(frameCount),
+                              dac_time, sink->userdata_);
+  return (more ? paContinue : paComplete);
+}
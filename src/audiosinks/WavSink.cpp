@@ -0,0 +1,96 @@
+#include "audiosinks/WavSink.hpp"
+
+#include <cstring>
+
+namespace {
+
+// RIFF header, fmt chunk (with cbSize, as non-PCM formats need), fact chunk, data chunk header
+const size_t HEADER_SIZE = 12 + 26 + 12 + 8;
+
+const uint16_t WAVE_FORMAT_IEEE_FLOAT = 3;
+
+void Put16(unsigned char* data, uint16_t value) {
+  data[0] = static_cast<unsigned char>(value);
+  data[1] = static_cast<unsigned char>(value >> 8);
+}
+
+void Put32(unsigned char* data, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    data[i] = static_cast<unsigned char>(value >> (8 * i));
+  }
+}
+
+void MakeHeader(unsigned char* header, int channels, int sample_rate, uint64_t data_bytes) {
+  uint32_t frame_bytes = static_cast<uint32_t>(channels) * 4;
+  std::memcpy(header, "RIFF", 4);
+  Put32(header + 4, static_cast<uint32_t>(HEADER_SIZE - 8 + data_bytes));
+  std::memcpy(header + 8, "WAVE", 4);
+
+  std::memcpy(header + 12, "fmt ", 4);
+  Put32(header + 16, 18);
+  Put16(header + 20, WAVE_FORMAT_IEEE_FLOAT);
+  Put16(header + 22, static_cast<uint16_t>(channels));
+  Put32(header + 24, static_cast<uint32_t>(sample_rate));
+  Put32(header + 28, static_cast<uint32_t>(sample_rate) * frame_bytes);
+  Put16(header + 32, static_cast<uint16_t>(frame_bytes));
+  Put16(header + 34, 32);
+  Put16(header + 36, 0);
+
+  std::memcpy(header + 38, "fact", 4);
+  Put32(header + 42, 4);
+  Put32(header + 46, static_cast<uint32_t>(data_bytes / frame_bytes));
+
+  std::memcpy(header + 50, "data", 4);
+  Put32(header + 54, static_cast<uint32_t>(data_bytes));
+}
+
+}  // namespace
+
+WavSink::WavSink(const std::string& path, SinkClock clock, uint32_t block_frames)
+  : NullSink(clock, block_frames), path_(path), file_(nullptr), channels_(0), sample_rate_(0), data_bytes_(0) { }
+
+WavSink::~WavSink() {
+  Close();
+}
+
+// PROTECTED FUNCTIONS
+
+bool WavSink::OnOpen(int channels, int sample_rate) {
+  file_ = std::fopen(path_.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+
+  // sizes are filled in on close
+  unsigned char header[HEADER_SIZE];
+  MakeHeader(header, channels, sample_rate, 0);
+  channels_ = channels;
+  sample_rate_ = sample_rate;
+  data_bytes_ = 0;
+  if (std::fwrite(header, 1, HEADER_SIZE, file_) != HEADER_SIZE) {
+    std::fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+
+  return true;
+}
+
+void WavSink::OnBlock(const float* data, uint32_t frames) {
+  // WAV is little-endian, as are the hosts we build for
+  size_t samples = static_cast<size_t>(frames) * channels_;
+  data_bytes_ += std::fwrite(data, sizeof(float), samples, file_) * sizeof(float);
+}
+
+void WavSink::OnClose() {
+  if (file_ == nullptr) {
+    return;
+  }
+
+  unsigned char header[HEADER_SIZE];
+  MakeHeader(header, channels_, sample_rate_, data_bytes_);
+  std::fseek(file_, 0, SEEK_SET);
+  std::fwrite(header, 1, HEADER_SIZE, file_);
+  std::fclose(file_);
+  file_ = nullptr;
+}
@@ -1,14 +1,50 @@
+#include <cstdlib>
 #include <iostream>
+#include <type_traits>
+#include <vector>
 
 #include "glad/glad.h"
 #include "GLFW/glfw3.h"
 
+#include "audiohandlers/Playlist.hpp"
+#include "audiohandlers/RealtimeCheck.hpp"
 #include "audiohandlers/VorbisManager.hpp"
+#include "audioreaders/MemoryReader.hpp"
 #include "audioreaders/VorbisReader.hpp"
 #include "portaudio.h"
+#include "threading/ThreadPolicy.hpp"
 
 #include "shaders/WaveShader.hpp"
 
+// reads a thread policy out of the environment, e.g. DINGO_DECODE_POLICY=fifo:20@1
+// see ThreadPolicy::Parse -- unset or malformed leaves the thread as it is
+ThreadPolicy GetPolicyFromEnvironment(const char* variable) {
+  ThreadPolicy policy;
+  const char* spec = std::getenv(variable);
+  if (spec != nullptr && !ThreadPolicy::Parse(spec, &policy)) {
+    std::cout << "ignoring bad " << variable << ": " << spec << std::endl;
+  }
+
+  return policy;
+}
+
+// the render thread only looks at the ring -- a view of one contiguous run of float samples is
+// drawn straight out of it, and anything else (a wrapped view, compact storage) goes via scratch
+template <typename S>
+const float* ChannelData(const FrameView<float, S>& view, float* scratch) {
+  if constexpr (std::is_same_v<S, float>) {
+    if (view.Length(1) == 0 && view.Stride() == 1) {
+      return view.Data(0, 0);
+    }
+  }
+
+  view.CopyTo(0, scratch);
+  return scratch;
+}
+
+// longest track worth holding in memory -- ten minutes of 44.1kHz stereo is about 200MB
+const int PREDECODE_MAX_SECONDS = 600;
+
 void SizeChangeCallback(GLFWwindow* window, int width, int height);
 
 int main(int argc, char** argv) {
@@ -25,7 +61,19 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
-  AudioReader* reader = VorbisReader::GetVorbisReader(argv[1]);
+  // every argument is a track -- played back to back through one stream
+  std::vector<std::string> files(argv + 1, argv + (argc < 2 ? 2 : argc));
+
+  // short tracks are decoded up front, on every core, so playback never waits on the decoder
+  // anything longer is streamed
+  AudioReader* reader = Playlist::GetPlaylist(files, [](const std::string& file) -> AudioReader* {
+    AudioReader* result = MemoryReader::PreDecodeVorbis(file, 0, PREDECODE_MAX_SECONDS);
+    return (result != nullptr ? result : VorbisReader::GetMappedVorbisReader(file));
+  });
+
+  if (reader == nullptr) {
+    return EXIT_FAILURE;
+  }
 
   std::unique_ptr<VorbisManager> vm(VorbisManager::GetVorbisManager(16, reader));
   if (vm == nullptr) {
@@ -63,10 +111,17 @@ int main(int argc, char** argv) {
   // todo: use UBO to get all of the sample data in there
   // or do it with a texture lol
 
+  // main thread is the render thread
+  GetPolicyFromEnvironment("DINGO_RENDER_POLICY").Apply("dingo-render");
+  vm->SetDecodePolicy(GetPolicyFromEnvironment("DINGO_DECODE_POLICY"));
   vm->StartWriteThread();
 
-  float** channeldata;
-  size_t samples_read;
+  for (const ThreadReport& report : ThreadPolicy::GetReports()) {
+    std::cout << report.ToString() << std::endl;
+  }
+
+  const uint32_t render_frames = 8192;
+  std::vector<float> scratch(render_frames);
 
   glfwSwapInterval(1);
 
@@ -75,11 +130,16 @@ int main(int argc, char** argv) {
   while (!glfwWindowShouldClose(window)) {
     framecount++;
     // todo: sometimes synchronization might fail
-    rob->Synchronize_Chunked(-0.2);
-    samples_read = rob->Peek_Chunked(8192, &channeldata);
+    int64_t playhead = rob->Synchronize_Chunked();
+    FrameView<float, SampleStorage> view = rob->View_Chunked(static_cast<uint64_t>(playhead < 0 ? 0 : playhead),
+                                                             render_frames);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    shader->Render(window, channeldata[0], samples_read);
-    glfwSwapBuffers(window);
+    shader->Render(window, ChannelData(view, scratch.data()), view.length);
+    // the writer lapped us mid-draw -- don't show a torn frame, just draw the next one
+    if (rob->IsRetained(view.frame)) {
+      glfwSwapBuffers(window);
+    }
+
     glfwPollEvents();
     if (!vm->IsThreadRunning()) {
       glfwSetWindowShouldClose(window, 1);
@@ -90,6 +150,10 @@ int main(int argc, char** argv) {
 
   vm->StopWriteThread();
 
+  if (RealtimeCheck::IsEnabled()) {
+    RealtimeCheck::PrintReport(std::cout);
+  }
+
   delete shader;
 
   glfwTerminate();
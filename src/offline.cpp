@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audiohandlers/OfflineAnalyzer.hpp"
+#include "audioreaders/VorbisReader.hpp"
+#include "threading/ThreadPolicy.hpp"
+
+// analyses files as fast as they decode -- no audio device, no window.
+// one CSV per file, one row per hop.
+
+static void PrintUsage() {
+  std::printf("usage: offline_dingo [--out DIR] [--window N] [--hop N] [--bands N] [--threads N] [--policy SPEC] file.ogg...\n");
+}
+
+static std::string GetOutputPath(const std::string& file, const std::string& out_dir) {
+  if (out_dir.empty()) {
+    return file + ".analysis.csv";
+  }
+
+  size_t slash = file.find_last_of("/\\");
+  return out_dir + "/" + (slash == std::string::npos ? file : file.substr(slash + 1)) + ".analysis.csv";
+}
+
+// analyses one file into `output` -- false if either can't be opened
+static bool AnalyseFile(const std::string& file, const std::string& output, const AnalysisOptions& options,
+                        AnalysisSummary* summary) {
+  std::unique_ptr<VorbisReader> reader(VorbisReader::GetMappedVorbisReader(file));
+  if (reader == nullptr) {
+    return false;
+  }
+
+  std::unique_ptr<OfflineAnalyzer> analyzer(OfflineAnalyzer::GetOfflineAnalyzer(reader->GetSampleRate(), options));
+  if (analyzer == nullptr) {
+    return false;
+  }
+
+  FILE* csv = std::fopen(output.c_str(), "w");
+  if (csv == NULL) {
+    return false;
+  }
+
+  std::fprintf(csv, "frame,seconds,rms,peak,zero_crossings,centroid,rolloff,flux");
+  const std::vector<float>& edges = analyzer->GetBandEdges();
+  for (int b = 0; b < options.bands; b++) {
+    std::fprintf(csv, ",band_%.0f_%.0f", edges[b], edges[b + 1]);
+  }
+
+  std::fprintf(csv, "\n");
+
+  double sample_rate = reader->GetSampleRate();
+  *summary = analyzer->Run(reader.get(), [csv, &options, sample_rate](const AnalysisFrame& frame) {
+    std::fprintf(csv, "%llu,%.6f,%.6f,%.6f,%.6f,%.2f,%.2f,%.6f",
+                 static_cast<unsigned long long>(frame.frame), frame.frame / sample_rate,
+                 frame.rms, frame.peak, frame.zero_crossings, frame.centroid, frame.rolloff, frame.flux);
+    for (int b = 0; b < options.bands; b++) {
+      std::fprintf(csv, ",%.2f", frame.bands[b]);
+    }
+
+    std::fprintf(csv, "\n");
+  });
+
+  return (std::fclose(csv) == 0);
+}
+
+int main(int argc, char** argv) {
+  AnalysisOptions options;
+  std::string out_dir;
+  int threads = 0;
+  ThreadPolicy policy;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = (i + 1 < argc);
+    if (arg == "--out" && has_value) {
+      out_dir = argv[++i];
+    } else if (arg == "--window" && has_value) {
+      options.window = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (arg == "--hop" && has_value) {
+      options.hop = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else if (arg == "--bands" && has_value) {
+      options.bands = std::atoi(argv[++i]);
+    } else if (arg == "--threads" && has_value) {
+      threads = std::atoi(argv[++i]);
+    } else if (arg == "--policy" && has_value) {
+      // e.g. "nice:10@2-5" -- see ThreadPolicy::Parse
+      if (!ThreadPolicy::Parse(argv[++i], &policy)) {
+        std::printf("bad policy: %s\n", argv[i]);
+        return EXIT_FAILURE;
+      }
+    } else if (arg.rfind("--", 0) == 0) {
+      PrintUsage();
+      return EXIT_FAILURE;
+    } else {
+      files.push_back(arg);
+    }
+  }
+
+  if (files.empty()) {
+    PrintUsage();
+    return EXIT_FAILURE;
+  }
+
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  threads = std::min(threads, static_cast<int>(files.size()));
+
+  // one file per thread at a time -- each has its own decoder and analyzer
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::mutex print_lock;
+  double audio_seconds = 0.0;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      policy.Apply("dingo-worker-" + std::to_string(t));
+      size_t index;
+      while ((index = next.fetch_add(1)) < files.size()) {
+        const std::string& file = files[index];
+        std::string output = GetOutputPath(file, out_dir);
+        AnalysisSummary summary;
+        bool result = AnalyseFile(file, output, options, &summary);
+
+        std::lock_guard<std::mutex> lock(print_lock);
+        if (!result) {
+          std::printf("%s: could not analyse\n", file.c_str());
+          failed.store(true);
+          continue;
+        }
+
+        audio_seconds += summary.audio_seconds;
+        std::printf("%s: %.1fs of audio in %.2fs (%.1fx realtime) -> %s\n", file.c_str(),
+                    summary.audio_seconds, summary.elapsed_seconds, summary.GetRealtimeFactor(), output.c_str());
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  for (const ThreadReport& report : ThreadPolicy::GetReports()) {
+    std::printf("%s\n", report.ToString().c_str());
+  }
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  std::printf("total: %.1fs of audio in %.2fs (%.1fx realtime) on %d threads\n",
+              audio_seconds, elapsed.count(), (elapsed.count() > 0.0 ? audio_seconds / elapsed.count() : 0.0), threads);
+  return (failed.load() ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -34,7 +34,7 @@ SimpleShader::SimpleShader() {
   uCoords_ = glGetUniformLocation(prog_, "uCoords");
 }
 
-void SimpleShader::Render(GLFWwindow* window, float* sample_data, size_t length) {
+void SimpleShader::Render(GLFWwindow* window, const float* sample_data, size_t length) {
   // get highest 2-pow available from length
   uint32_t maxlen = 1;
   while (maxlen <= length) {
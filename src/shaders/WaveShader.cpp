@@ -118,7 +118,7 @@ WaveShader::WaveShader() : y_offset_(0), screensize_(512, 256) {
   horizontal_ = glGetUniformLocation(buffprog_, "horizontal");
 }
 
-void WaveShader::Render(GLFWwindow* window, float* sample_data, size_t length) {
+void WaveShader::Render(GLFWwindow* window, const float* sample_data, size_t length) {
   // glEnable(GL_LINE_SMOOTH);
   // sumn
   glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
@@ -0,0 +1,335 @@
+#include "threading/ThreadPolicy.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// every Apply, for GetReports -- only touched while threads are being set up
+std::mutex reports_lock;
+std::vector<ThreadReport> reports;
+
+bool ParseInt(const std::string& text, int* output) {
+  if (text.empty()) {
+    return false;
+  }
+
+  char* end;
+  errno = 0;
+  long value = std::strtol(text.c_str(), &end, 10);
+  if (*end != '\0' || errno != 0 || value < -1000000 || value > 1000000) {
+    return false;
+  }
+
+  *output = static_cast<int>(value);
+  return true;
+}
+
+// "0,2,4-7"
+bool ParseCpus(const std::string& text, std::vector<int>* output) {
+  std::vector<int> cpus;
+  size_t start = 0;
+  while (start <= text.size()) {
+    size_t end = text.find(',', start);
+    if (end == std::string::npos) {
+      end = text.size();
+    }
+
+    std::string item = text.substr(start, end - start);
+    size_t dash = item.find('-', 1);
+    int first, last;
+    if (dash == std::string::npos) {
+      if (!ParseInt(item, &first)) {
+        return false;
+      }
+
+      last = first;
+    } else if (!ParseInt(item.substr(0, dash), &first) || !ParseInt(item.substr(dash + 1), &last)) {
+      return false;
+    }
+
+    if (first < 0 || last < first) {
+      return false;
+    }
+
+    for (int cpu = first; cpu <= last; cpu++) {
+      cpus.push_back(cpu);
+    }
+
+    start = end + 1;
+  }
+
+  *output = cpus;
+  return true;
+}
+
+const char* ClassName(SchedulingClass scheduling) {
+  switch (scheduling) {
+    case SchedulingClass::NICE:
+      return "nice";
+    case SchedulingClass::FIFO:
+      return "fifo";
+    case SchedulingClass::RR:
+      return "rr";
+    default:
+      return "default";
+  }
+}
+
+void AddNote(std::string* note, const std::string& text) {
+  if (!note->empty()) {
+    *note += "; ";
+  }
+
+  *note += text;
+}
+
+#if defined(__linux__)
+
+// the cpus the process may use, taken before main can narrow its own thread's affinity
+struct ProcessCpus {
+  cpu_set_t set;
+
+  ProcessCpus() {
+    CPU_ZERO(&set);
+    sched_getaffinity(0, sizeof(set), &set);
+  }
+} process_cpus;
+
+// nice levels are per-thread on linux, if you ask by thread id
+bool SetNice(int nice, std::string* note) {
+  pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+  if (setpriority(PRIO_PROCESS, tid, nice) != 0) {
+    AddNote(note, "nice " + std::to_string(nice) + " refused (" + std::strerror(errno) + ")");
+    return false;
+  }
+
+  return true;
+}
+
+int GetNice() {
+  pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+  errno = 0;
+  int nice = getpriority(PRIO_PROCESS, tid);
+  return (errno == 0 ? nice : 0);
+}
+
+#else
+
+bool SetNice(int nice, std::string* note) {
+  AddNote(note, "per-thread nice levels aren't supported here");
+  return false;
+}
+
+int GetNice() {
+  return 0;
+}
+
+#endif  // __linux__
+
+}  // namespace
+
+bool ThreadPolicy::Parse(const std::string& spec, ThreadPolicy* output) {
+  ThreadPolicy result;
+  std::string rest = spec;
+
+  size_t at = rest.find('@');
+  if (at != std::string::npos) {
+    if (!ParseCpus(rest.substr(at + 1), &result.cpus)) {
+      return false;
+    }
+
+    rest = rest.substr(0, at);
+  }
+
+  size_t colon = rest.find(':');
+  std::string name = rest.substr(0, colon);
+  if (name == "default") {
+    result.scheduling = SchedulingClass::DEFAULT;
+  } else if (name == "nice") {
+    result.scheduling = SchedulingClass::NICE;
+  } else if (name == "fifo") {
+    result.scheduling = SchedulingClass::FIFO;
+  } else if (name == "rr") {
+    result.scheduling = SchedulingClass::RR;
+  } else {
+    return false;
+  }
+
+  if (colon != std::string::npos) {
+    if (result.scheduling == SchedulingClass::DEFAULT || !ParseInt(rest.substr(colon + 1), &result.priority)) {
+      return false;
+    }
+  } else if (result.scheduling == SchedulingClass::FIFO || result.scheduling == SchedulingClass::RR) {
+    // a real-time class without a priority is almost certainly a mistake
+    return false;
+  }
+
+  if (result.scheduling == SchedulingClass::NICE && (result.priority < -20 || result.priority > 19)) {
+    return false;
+  }
+
+  if ((result.scheduling == SchedulingClass::FIFO || result.scheduling == SchedulingClass::RR)
+      && (result.priority < 1 || result.priority > 99)) {
+    return false;
+  }
+
+  *output = result;
+  return true;
+}
+
+std::string ThreadPolicy::ToString() const {
+  std::string result = ClassName(scheduling);
+  if (scheduling != SchedulingClass::DEFAULT) {
+    result += ":" + std::to_string(priority);
+  }
+
+  for (size_t i = 0; i < cpus.size(); i++) {
+    result += (i == 0 ? "@" : ",");
+    result += std::to_string(cpus[i]);
+  }
+
+  return result;
+}
+
+ThreadReport ThreadPolicy::Apply(const std::string& name) const {
+  ThreadReport report;
+  report.name = name;
+  report.requested = *this;
+  std::string note;
+
+#if defined(__linux__)
+  // the kernel keeps 15 characters of it
+  pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+  int current_policy;
+  sched_param param;
+  pthread_getschedparam(pthread_self(), &current_policy, &param);
+
+  if (scheduling == SchedulingClass::FIFO || scheduling == SchedulingClass::RR) {
+    param.sched_priority = priority;
+    int err = pthread_setschedparam(pthread_self(), (scheduling == SchedulingClass::FIFO ? SCHED_FIFO : SCHED_RR), &param);
+    if (err != 0) {
+      AddNote(&note, std::string(ClassName(scheduling)) + " refused (" + std::strerror(err) + ")");
+      SetNice(fallback_nice, &note);
+    }
+  } else if (scheduling == SchedulingClass::NICE) {
+    if (current_policy != SCHED_OTHER) {
+      // a real-time class inherited from whoever spawned us -- back to timesharing first
+      param.sched_priority = 0;
+      pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+    }
+
+    SetNice(priority, &note);
+  }
+#else
+  if (scheduling != SchedulingClass::DEFAULT) {
+    AddNote(&note, "scheduling classes aren't supported here");
+  }
+#endif
+
+  if (!cpus.empty()) {
+#if defined(__linux__)
+    // only what the process is allowed onto -- a cpuset or taskset may have narrowed it
+    const cpu_set_t& allowed = process_cpus.set;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    std::string dropped;
+    for (int cpu : cpus) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+        CPU_SET(cpu, &mask);
+      } else {
+        dropped += (dropped.empty() ? "" : ",") + std::to_string(cpu);
+      }
+    }
+
+    if (!dropped.empty()) {
+      AddNote(&note, "cpus " + dropped + " unavailable");
+    }
+
+    if (CPU_COUNT(&mask) == 0) {
+      AddNote(&note, "no usable cpus, affinity left alone");
+    } else {
+      int err = pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+      if (err != 0) {
+        AddNote(&note, std::string("affinity refused (") + std::strerror(err) + ")");
+      }
+    }
+#else
+    AddNote(&note, "cpu affinity isn't supported here");
+#endif
+  }
+
+  report.effective = GetCurrent();
+  report.effective.fallback_nice = fallback_nice;
+  report.degraded = !note.empty();
+  report.note = note;
+
+  std::lock_guard<std::mutex> lock(reports_lock);
+  reports.push_back(report);
+  return report;
+}
+
+ThreadPolicy ThreadPolicy::GetCurrent() {
+  ThreadPolicy result;
+
+#if defined(__unix__) || defined(__APPLE__)
+  int policy;
+  sched_param param;
+  if (pthread_getschedparam(pthread_self(), &policy, &param) == 0 && (policy == SCHED_FIFO || policy == SCHED_RR)) {
+    result.scheduling = (policy == SCHED_FIFO ? SchedulingClass::FIFO : SchedulingClass::RR);
+    result.priority = param.sched_priority;
+  } else {
+    int nice = GetNice();
+    if (nice != 0) {
+      result.scheduling = SchedulingClass::NICE;
+      result.priority = nice;
+    }
+  }
+#endif
+
+#if defined(__linux__)
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  pthread_getaffinity_np(pthread_self(), sizeof(mask), &mask);
+  if (!CPU_EQUAL(&process_cpus.set, &mask)) {
+    // only worth listing if it's narrower than the process
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &mask)) {
+        result.cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+
+  return result;
+}
+
+std::vector<ThreadReport> ThreadPolicy::GetReports() {
+  std::lock_guard<std::mutex> lock(reports_lock);
+  return reports;
+}
+
+std::string ThreadReport::ToString() const {
+  std::string result = name + ": " + effective.ToString();
+  if (degraded) {
+    result += " (asked for " + requested.ToString() + " -- " + note + ")";
+  }
+
+  return result;
+}
@@ -32,9 +32,11 @@ struct PaStreamCallbackFlags {
   char cum;
 };
 
-// unused
+// same layout as the real thing -- the stub passes nullptr anyway
 struct PaStreamCallbackTimeInfo {
-  char cumtwo;
+  double inputBufferAdcTime;
+  double currentTime;
+  double outputBufferDacTime;
 };
 
 // callback shit
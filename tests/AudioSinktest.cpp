@@ -0,0 +1,360 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/BlockTimeline.hpp"
+#include "audiohandlers/VorbisManager.hpp"
+#include "audioreaders/MemoryReader.hpp"
+#include "audiosinks/NullSink.hpp"
+#include "audiosinks/WavSink.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+const int rate = 48000;
+
+struct CountingPacket {
+  uint64_t frames;
+  uint64_t stop_after;
+  std::vector<double> dac_times;
+};
+
+// writes each frame's index into every channel, and stops after stop_after frames
+static bool CountingCallback(float* output, uint32_t frames, double dac_time, void* userdata) {
+  CountingPacket* packet = reinterpret_cast<CountingPacket*>(userdata);
+  for (uint32_t i = 0; i < frames; i++) {
+    output[2 * i] = output[2 * i + 1] = static_cast<float>(packet->frames + i);
+  }
+
+  packet->frames += frames;
+  packet->dac_times.push_back(dac_time);
+  return packet->frames < packet->stop_after;
+}
+
+static void WaitFinished(const NullSink& sink) {
+  while (!sink.IsFinished()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+static std::vector<unsigned char> ReadFile(const std::string& path) {
+  std::vector<unsigned char> result;
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    return result;
+  }
+
+  unsigned char block[4096];
+  size_t read;
+  while ((read = std::fread(block, 1, sizeof(block), file)) > 0) {
+    result.insert(result.end(), block, block + read);
+  }
+
+  std::fclose(file);
+  return result;
+}
+
+static uint32_t Get32(const unsigned char* data) {
+  return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+TEST(AudioSinkTests, RejectsBadOpen) {
+  CountingPacket packet{0, 1024, {}};
+  NullSink sink;
+  ASSERT_FALSE(sink.Start());
+  ASSERT_FALSE(sink.Open(0, rate, CountingCallback, &packet));
+  ASSERT_FALSE(sink.Open(2, 0, CountingCallback, &packet));
+  ASSERT_TRUE(sink.Open(2, rate, CountingCallback, &packet));
+  ASSERT_FALSE(sink.Open(2, rate, CountingCallback, &packet));
+  sink.Close();
+
+  NullSink empty(SinkClock::FREE_RUNNING, 0);
+  ASSERT_FALSE(empty.Open(2, rate, CountingCallback, &packet));
+}
+
+// free-running, blocks go back to back and are stamped by frame count rather than wall time
+TEST(AudioSinkTests, FreeRunningStopsWhenAsked) {
+  CountingPacket packet{0, 10 * 256, {}};
+  NullSink sink(SinkClock::FREE_RUNNING, 256);
+  ASSERT_TRUE(sink.Open(2, rate, CountingCallback, &packet));
+  ASSERT_TRUE(sink.Start());
+  WaitFinished(sink);
+  sink.Close();
+
+  ASSERT_EQ(packet.frames, 10 * 256);
+  ASSERT_EQ(sink.GetFramesPlayed(), 10 * 256);
+  ASSERT_EQ(packet.dac_times.size(), 10);
+  for (size_t i = 1; i < packet.dac_times.size(); i++) {
+    ASSERT_NEAR(packet.dac_times[i] - packet.dac_times[i - 1], 256.0 / rate, 1e-9);
+  }
+}
+
+// realtime, the sink takes about as long as the audio it asked for
+TEST(AudioSinkTests, RealtimePacing) {
+  // 0.2s
+  CountingPacket packet{0, rate / 5, {}};
+  NullSink sink(SinkClock::REALTIME, 480, 0.05);
+  ASSERT_TRUE(sink.Open(2, rate, CountingCallback, &packet));
+  auto start = std::chrono::steady_clock::now();
+  double start_time = BlockTimeline::Now();
+  ASSERT_TRUE(sink.Start());
+  WaitFinished(sink);
+  double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  sink.Close();
+
+  // the last block is asked for as the one before it starts
+  ASSERT_GE(elapsed, 0.18);
+  ASSERT_LT(elapsed, 1.0);
+  // DAC times lead the wall clock by the latency
+  ASSERT_GE(packet.dac_times.front(), start_time + 0.05);
+  ASSERT_LT(packet.dac_times.front(), start_time + 0.05 + 0.1);
+}
+
+// a sink can be opened again once closed
+TEST(AudioSinkTests, Reopen) {
+  for (int i = 0; i < 2; i++) {
+    CountingPacket packet{0, 1024, {}};
+    NullSink sink(SinkClock::FREE_RUNNING, 256);
+    ASSERT_TRUE(sink.Open(2, rate, CountingCallback, &packet));
+    ASSERT_TRUE(sink.Start());
+    WaitFinished(sink);
+    sink.Close();
+    ASSERT_TRUE(sink.Open(2, rate, CountingCallback, &packet));
+    packet.frames = 0;
+    ASSERT_TRUE(sink.Start());
+    WaitFinished(sink);
+    sink.Close();
+    ASSERT_EQ(sink.GetFramesPlayed(), 1024);
+  }
+}
+
+// the WAV holds exactly the blocks the callback filled, behind a float header
+TEST(AudioSinkTests, WavRecordsBlocks) {
+  const std::string path = "AudioSinktest_blocks.wav";
+  CountingPacket packet{0, 4 * 300, {}};
+  {
+    WavSink sink(path, SinkClock::FREE_RUNNING, 300);
+    ASSERT_TRUE(sink.Open(2, rate, CountingCallback, &packet));
+    ASSERT_TRUE(sink.Start());
+    WaitFinished(sink);
+  }
+
+  std::vector<unsigned char> wav = ReadFile(path);
+  std::remove(path.c_str());
+  const size_t header = 58;
+  const uint32_t data_bytes = 4 * 300 * 2 * sizeof(float);
+  ASSERT_EQ(wav.size(), header + data_bytes);
+  ASSERT_EQ(std::memcmp(wav.data(), "RIFF", 4), 0);
+  ASSERT_EQ(Get32(wav.data() + 4), wav.size() - 8);
+  ASSERT_EQ(std::memcmp(wav.data() + 8, "WAVEfmt ", 8), 0);
+  // IEEE float, stereo
+  ASSERT_EQ(wav[20], 3);
+  ASSERT_EQ(wav[22], 2);
+  ASSERT_EQ(Get32(wav.data() + 24), rate);
+  ASSERT_EQ(wav[34], 32);
+  ASSERT_EQ(std::memcmp(wav.data() + 38, "fact", 4), 0);
+  ASSERT_EQ(Get32(wav.data() + 46), 4 * 300);
+  ASSERT_EQ(std::memcmp(wav.data() + 50, "data", 4), 0);
+  ASSERT_EQ(Get32(wav.data() + 54), data_bytes);
+
+  const float* samples = reinterpret_cast<const float*>(wav.data() + header);
+  for (uint32_t i = 0; i < 4 * 300; i++) {
+    ASSERT_EQ(samples[2 * i], static_cast<float>(i));
+    ASSERT_EQ(samples[2 * i + 1], static_cast<float>(i));
+  }
+}
+
+// end to end: what the manager plays into a WAV sink is the stream, then silence
+TEST(AudioSinkTests, ManagerPlaysIntoWav) {
+  const std::string path = "AudioSinktest_manager.wav";
+  const uint32_t frames = rate / 2 + 123;
+  std::vector<float> samples(frames * 2);
+  for (uint32_t i = 0; i < frames; i++) {
+    samples[2 * i] = static_cast<float>(i) / frames;
+    samples[2 * i + 1] = -static_cast<float>(i) / frames;
+  }
+
+  MemoryReader* reader = new MemoryReader(samples, 2, rate);
+  VorbisManager* mgr = VorbisManager::GetVorbisManager(15, reader, 2, new WavSink(path));
+  ASSERT_NE(mgr, nullptr);
+  mgr->StartWriteThread();
+  mgr->ThreadWait();
+  delete mgr;
+
+  std::vector<unsigned char> wav = ReadFile(path);
+  std::remove(path.c_str());
+  const size_t header = 58;
+  ASSERT_GE(wav.size(), header);
+  size_t recorded = (wav.size() - header) / (2 * sizeof(float));
+  ASSERT_EQ(Get32(wav.data() + 54), recorded * 2 * sizeof(float));
+  ASSERT_GE(recorded, frames);
+
+  const float* played = reinterpret_cast<const float*>(wav.data() + header);
+  for (uint32_t i = 0; i < frames; i++) {
+    ASSERT_FLOAT_EQ(played[2 * i], samples[2 * i]) << "frame " << i;
+    ASSERT_FLOAT_EQ(played[2 * i + 1], samples[2 * i + 1]) << "frame " << i;
+  }
+
+  for (size_t i = frames * 2; i < recorded * 2; i++) {
+    ASSERT_EQ(played[i], 0.0f);
+  }
+}
+
+// mix sources land on top of the stream, frame for frame
+TEST(AudioSinkTests, ManagerMixesSources) {
+  const std::string path = "AudioSinktest_mix.wav";
+  const uint32_t frames = rate / 4;
+  const uint32_t mixed = 4096;
+  std::vector<float> samples(frames * 2, 0.5f);
+
+  MemoryReader* reader = new MemoryReader(samples, 2, rate);
+  VorbisManager* mgr = VorbisManager::GetVorbisManager(15, reader, 2, new WavSink(path));
+  ASSERT_NE(mgr, nullptr);
+
+  std::vector<float> overlay(mixed * 2, 0.25f);
+  std::shared_ptr<MixSource> source = mgr->CreateMixSource(0.5f);
+  ASSERT_EQ(source->Push(0, overlay.data(), mixed), mixed);
+  source->Close();
+
+  mgr->StartWriteThread();
+  mgr->ThreadWait();
+  delete mgr;
+
+  std::vector<unsigned char> wav = ReadFile(path);
+  std::remove(path.c_str());
+  const size_t header = 58;
+  ASSERT_GE(wav.size(), header + frames * 2 * sizeof(float));
+
+  const float* played = reinterpret_cast<const float*>(wav.data() + header);
+  for (uint32_t i = 0; i < frames * 2; i++) {
+    ASSERT_FLOAT_EQ(played[i], (i < mixed * 2 ? 0.625f : 0.5f)) << "sample " << i;
+  }
+
+  ASSERT_EQ(source->GetLateFrames(), 0);
+}
+
+// plays the whole stream before Start returns -- the callback finishes before the write
+// thread has even reached its wait
+class EagerSink : public AudioSink {
+ public:
+  bool Open(int channels, int sample_rate, SinkCallback callback, void* userdata) override {
+    block_.assign(256 * channels, 0.0f);
+    callback_ = callback;
+    userdata_ = userdata;
+    return true;
+  }
+
+  bool Start() override {
+    // bounded, in case the callback never asks to stop
+    for (int i = 0; i < 100000 && callback_(block_.data(), 256, 0.0, userdata_); i++);
+    return true;
+  }
+
+  void Stop() override { }
+  void Close() override { }
+
+ private:
+  std::vector<float> block_;
+  SinkCallback callback_;
+  void* userdata_;
+};
+
+// can't play anywhere
+class FailingSink : public AudioSink {
+ public:
+  bool Open(int channels, int sample_rate, SinkCallback callback, void* userdata) override { return false; }
+  bool Start() override { return false; }
+  void Stop() override { }
+  void Close() override { }
+};
+
+static bool WaitForThread(VorbisManager* mgr, double seconds) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+  while (mgr->IsThreadRunning()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return true;
+}
+
+// the whole stream fits in the first fill, and is played out before the write thread waits
+TEST(AudioSinkTests, ManagerFinishesWhenCallbackIsEarly) {
+  std::vector<float> samples(4096 * 2, 0.5f);
+  MemoryReader* reader = new MemoryReader(samples, 2, rate);
+  VorbisManager* mgr = VorbisManager::GetVorbisManager(15, reader, 2, new EagerSink());
+  ASSERT_NE(mgr, nullptr);
+  mgr->StartWriteThread();
+  ASSERT_TRUE(WaitForThread(mgr, 5.0));
+  delete mgr;
+}
+
+// nothing is playing, so the playhead shouldn't move
+TEST(AudioSinkTests, ManagerWithoutSinkDoesNotAdvance) {
+  std::vector<float> samples(rate * 2, 0.5f);
+  MemoryReader* reader = new MemoryReader(samples, 2, rate);
+  VorbisManager* mgr = VorbisManager::GetVorbisManager(15, reader, 2, new FailingSink());
+  ASSERT_NE(mgr, nullptr);
+  std::unique_ptr<ReadOnlyBuffer> buf(mgr->CreateBufferInstance());
+  mgr->StartWriteThread();
+  ASSERT_TRUE(WaitForThread(mgr, 5.0));
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  ASSERT_LE(buf->Synchronize_Chunked(), 0);
+  buf.reset();
+  delete mgr;
+}
+
+// counts calls into the decoder
+class CountingReader : public MemoryReader {
+ public:
+  using MemoryReader::MemoryReader;
+
+  int GetSamplesInterleaved(int count, float* output) override {
+    calls++;
+    return MemoryReader::GetSamplesInterleaved(count, output);
+  }
+
+  int GetSamplesInterleaved(int count, int16_t* output) override {
+    calls++;
+    return MemoryReader::GetSamplesInterleaved(count, output);
+  }
+
+  int GetSamplesPlanar(int frames, float* const* output) override {
+    calls++;
+    return MemoryReader::GetSamplesPlanar(frames, output);
+  }
+
+  std::atomic<int> calls{0};
+};
+
+// small blocks into a big ring -- the write thread tops the ring up in a few big batches,
+// not a block at a time, and never lets it get anywhere near empty
+TEST(AudioSinkTests, ManagerRefillsInBatches) {
+  std::vector<float> samples(rate * 4 * 2, 0.5f);
+  CountingReader* reader = new CountingReader(samples, 2, rate);
+  VorbisManager* mgr = VorbisManager::GetVorbisManager(15, reader, 2, new NullSink(SinkClock::REALTIME, 64));
+  ASSERT_NE(mgr, nullptr);
+  mgr->StartWriteThread();
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  int primed = reader->calls.load();
+  // about 0.6 of a ring
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  int refills = reader->calls.load() - primed;
+  BufferStats stats = mgr->GetCriticalBufferStats();
+
+  mgr->StopWriteThread();
+  delete mgr;
+
+  // a refill is at most two decodes -- one each side of the wrap
+  ASSERT_GT(refills, 0);
+  ASSERT_LE(refills, 8);
+  ASSERT_EQ(stats.underruns, 0);
+  // in samples -- half of the 2^15 frame ring
+  ASSERT_GE(stats.low_water, 1u << 15);
+}
@@ -0,0 +1,94 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/BlockTimeline.hpp"
+
+#include <atomic>
+#include <thread>
+
+// blocks of 256 frames, one every 10ms
+static BlockStamp MakeStamp(uint64_t index) {
+  return {index * 256, 256, index * 0.01, 1.0 + index * 0.01};
+}
+
+TEST(BlockTimelineTests, FindFrameAndTime) {
+  BlockTimeline timeline(4);
+  BlockStamp stamp;
+  ASSERT_FALSE(timeline.Latest(&stamp));
+  ASSERT_FALSE(timeline.FindFrame(0, &stamp));
+
+  for (uint64_t i = 0; i < 10; i++) {
+    timeline.Publish(MakeStamp(i));
+  }
+
+  ASSERT_EQ(timeline.GetPublished(), 10);
+  ASSERT_TRUE(timeline.Latest(&stamp));
+  ASSERT_EQ(stamp.frame, 9 * 256);
+
+  ASSERT_TRUE(timeline.FindFrame(0, &stamp));
+  ASSERT_EQ(stamp.frame, 0);
+  ASSERT_TRUE(timeline.FindFrame(1000, &stamp));
+  ASSERT_EQ(stamp.frame, 768);
+  ASSERT_FALSE(timeline.FindFrame(2560, &stamp));
+
+  ASSERT_FALSE(timeline.FindTime(0.5, &stamp));
+  ASSERT_TRUE(timeline.FindTime(1.055, &stamp));
+  ASSERT_EQ(stamp.frame, 5 * 256);
+  ASSERT_DOUBLE_EQ(stamp.decode_time, 0.05);
+  ASSERT_TRUE(timeline.FindTime(100.0, &stamp));
+  ASSERT_EQ(stamp.frame, 9 * 256);
+}
+
+// once wrapped, only the last 2^twopow blocks can be found
+TEST(BlockTimelineTests, WrapAndClear) {
+  BlockTimeline timeline(4);
+  for (uint64_t i = 0; i < 40; i++) {
+    timeline.Publish(MakeStamp(i));
+  }
+
+  BlockStamp stamp;
+  ASSERT_FALSE(timeline.FindFrame(23 * 256, &stamp));
+  ASSERT_TRUE(timeline.FindFrame(24 * 256, &stamp));
+  ASSERT_EQ(stamp.frame, 24 * 256);
+  ASSERT_TRUE(timeline.FindTime(1.395, &stamp));
+  ASSERT_EQ(stamp.frame, 39 * 256);
+
+  timeline.Clear();
+  ASSERT_EQ(timeline.GetPublished(), 0);
+  ASSERT_FALSE(timeline.Latest(&stamp));
+  ASSERT_FALSE(timeline.FindFrame(39 * 256, &stamp));
+
+  timeline.Publish(MakeStamp(0));
+  ASSERT_TRUE(timeline.FindFrame(100, &stamp));
+  ASSERT_EQ(stamp.frame, 0);
+}
+
+// readers never see a torn block while the writer laps them
+TEST(BlockTimelineTests, ConcurrentReaders) {
+  BlockTimeline timeline(3);
+  const uint64_t blocks = 200000;
+  std::atomic<bool> done(false);
+
+  auto reader = [&timeline, &done] {
+    BlockStamp stamp;
+    while (!done.load(std::memory_order_acquire)) {
+      if (timeline.Latest(&stamp)) {
+        uint64_t index = stamp.frame / 256;
+        ASSERT_EQ(stamp.frames, 256);
+        ASSERT_DOUBLE_EQ(stamp.dac_time, 1.0 + index * 0.01);
+        if (timeline.FindFrame(stamp.frame + 10, &stamp)) {
+          ASSERT_EQ(stamp.frame / 256, index);
+        }
+      }
+    }
+  };
+
+  std::thread a(reader);
+  std::thread b(reader);
+  for (uint64_t i = 0; i < blocks; i++) {
+    timeline.Publish(MakeStamp(i));
+  }
+
+  done.store(true, std::memory_order_release);
+  a.join();
+  b.join();
+  ASSERT_EQ(timeline.GetPublished(), blocks);
+}
@@ -0,0 +1,166 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/ChannelMatrix.hpp"
+#include "audiohandlers/AudioBufferSPSC.hpp"
+
+#include <cmath>
+#include <vector>
+
+// straightforward reference, one output at a time
+template <typename S>
+static std::vector<float> ReferenceMix(const ChannelMatrix& matrix, const std::vector<S>& input) {
+  int in = matrix.GetInputChannels();
+  int out = matrix.GetOutputChannels();
+  size_t frames = input.size() / in;
+  std::vector<float> result(frames * out);
+  for (size_t f = 0; f < frames; f++) {
+    for (int o = 0; o < out; o++) {
+      float sum = 0.0f;
+      for (int i = 0; i < in; i++) {
+        sum += kernels::ConvertSample<S, float>(input[f * in + i]) * matrix.GetGain(o, i);
+      }
+
+      result[f * out + o] = sum;
+    }
+  }
+
+  return result;
+}
+
+TEST(ChannelMatrixTests, MonoToStereo) {
+  ChannelMatrix matrix(1, 2);
+  ASSERT_FALSE(matrix.IsIdentity());
+  ASSERT_EQ(matrix.GetGain(0, 0), 1.0f);
+  ASSERT_EQ(matrix.GetGain(1, 0), 1.0f);
+
+  std::vector<float> input = { 0.1f, 0.2f, 0.3f, 0.4f, 0.5f };
+  std::vector<float> output(10);
+  matrix.Apply(input.data(), output.data(), 5);
+  for (int i = 0; i < 5; i++) {
+    ASSERT_EQ(output[2 * i], input[i]);
+    ASSERT_EQ(output[2 * i + 1], input[i]);
+  }
+}
+
+TEST(ChannelMatrixTests, StereoIsIdentity) {
+  ChannelMatrix matrix(2, 2);
+  ASSERT_TRUE(matrix.IsIdentity());
+  ASSERT_FALSE(ChannelMatrix(6, 6).IsIdentity());  // vorbis and device orders differ
+
+  // a whole vector's worth, so the int16 conversion kernel runs its SIMD path
+  std::vector<int16_t> input = { 16384, -16384, 8192, 0, -8192, 4096, 0, -32768 };
+  std::vector<float> output(8);
+  matrix.Apply(input.data(), output.data(), 4);
+  ASSERT_EQ(output[0], 0.5f);
+  ASSERT_EQ(output[1], -0.5f);
+  ASSERT_EQ(output[2], 0.25f);
+  ASSERT_EQ(output[4], -0.25f);
+  ASSERT_EQ(output[5], 0.125f);
+  ASSERT_EQ(output[7], -1.0f);
+}
+
+// vorbis 5.1 is L C R BL BR LFE -- centre and surrounds fold into the fronts, LFE is dropped,
+// and the result is scaled so that nothing clips
+TEST(ChannelMatrixTests, SurroundToStereo) {
+  ChannelMatrix matrix(6, 2);
+  float norm = 1.0f + 2.0f * 0.70710678f;
+  ASSERT_NEAR(matrix.GetGain(0, 0), 1.0f / norm, 1e-6);
+  ASSERT_NEAR(matrix.GetGain(0, 1), 0.70710678f / norm, 1e-6);
+  ASSERT_NEAR(matrix.GetGain(0, 3), 0.70710678f / norm, 1e-6);
+  ASSERT_EQ(matrix.GetGain(0, 2), 0.0f);
+  ASSERT_EQ(matrix.GetGain(0, 4), 0.0f);
+  ASSERT_EQ(matrix.GetGain(0, 5), 0.0f);
+  ASSERT_NEAR(matrix.GetGain(1, 2), 1.0f / norm, 1e-6);
+  ASSERT_NEAR(matrix.GetGain(1, 4), 0.70710678f / norm, 1e-6);
+  ASSERT_EQ(matrix.GetGain(1, 5), 0.0f);
+
+  // and into a 5.1 device, everything is just reordered
+  ChannelMatrix reorder(6, 6);
+  ASSERT_EQ(reorder.GetGain(2, 1), 1.0f);   // C
+  ASSERT_EQ(reorder.GetGain(1, 2), 1.0f);   // R
+  ASSERT_EQ(reorder.GetGain(3, 5), 1.0f);   // LFE
+}
+
+TEST(ChannelMatrixTests, StereoToMono) {
+  ChannelMatrix matrix(2, 1);
+  ASSERT_NEAR(matrix.GetGain(0, 0), 0.5f, 1e-6);
+  ASSERT_NEAR(matrix.GetGain(0, 1), 0.5f, 1e-6);
+}
+
+// the vector paths agree with the reference for every layout up to 8 channels,
+// including frame counts which leave a scalar tail
+TEST(ChannelMatrixTests, MatchesReference) {
+  for (int in = 1; in <= 8; in++) {
+    for (int out = 1; out <= 8; out++) {
+      ChannelMatrix matrix(in, out);
+      for (uint32_t frames : { 1u, 2u, 3u, 17u, 256u }) {
+        std::vector<float> input(frames * in);
+        std::vector<int16_t> compact(frames * in);
+        for (size_t i = 0; i < input.size(); i++) {
+          input[i] = static_cast<float>(sin(i * 0.37));
+          compact[i] = static_cast<int16_t>(input[i] * 32000);
+        }
+
+        // a guard sample past the end catches overruns
+        std::vector<float> output(frames * out + 1, 12345.0f);
+        matrix.Apply(input.data(), output.data(), frames);
+        std::vector<float> expected = ReferenceMix(matrix, input);
+        for (size_t i = 0; i < expected.size(); i++) {
+          ASSERT_NEAR(output[i], expected[i], 1e-5) << in << " -> " << out << ", " << frames << " frames";
+        }
+
+        ASSERT_EQ(output.back(), 12345.0f);
+
+        matrix.Apply(compact.data(), output.data(), frames);
+        expected = ReferenceMix(matrix, compact);
+        for (size_t i = 0; i < expected.size(); i++) {
+          ASSERT_NEAR(output[i], expected[i], 1e-5);
+        }
+      }
+    }
+  }
+}
+
+TEST(ChannelMatrixTests, CustomGains) {
+  // swap left and right, and put their average in a third channel
+  ChannelMatrix matrix(2, 3, { 0.0f, 1.0f,
+                               1.0f, 0.0f,
+                               0.5f, 0.5f });
+  std::vector<float> input = { 0.25f, 0.75f };
+  std::vector<float> output(3);
+  matrix.Apply(input.data(), output.data(), 1);
+  ASSERT_EQ(output[0], 0.75f);
+  ASSERT_EQ(output[1], 0.25f);
+  ASSERT_EQ(output[2], 0.5f);
+}
+
+// reading in place hands out the ring's storage in at most two runs, and a short read is an underrun
+TEST(ChannelMatrixTests, ReadInPlace) {
+  AudioBufferSPSC<float> buf(4, 2);   // 16 frames
+  std::vector<float> input(12 * 2);
+  for (size_t i = 0; i < input.size(); i++) {
+    input[i] = static_cast<float>(i);
+  }
+
+  ASSERT_TRUE(buf.Write(input.data(), 12 * 2));
+  ASSERT_EQ(buf.ReadInPlace(10, [](const float*, uint32_t) { }), 10);
+  ASSERT_TRUE(buf.Write(input.data(), 12 * 2));
+
+  // 14 frames available, from frame 10 -- wraps after 6
+  ChannelMatrix matrix(2, 1);
+  std::vector<float> mono(16, -1.0f);
+  float* cursor = mono.data();
+  int runs = 0;
+  uint32_t read = buf.ReadInPlace(16, [&](const float* data, uint32_t frames) {
+    matrix.Apply(data, cursor, frames);
+    cursor += frames;
+    runs++;
+  });
+
+  ASSERT_EQ(read, 14);
+  ASSERT_EQ(runs, 2);
+  ASSERT_EQ(buf.GetStats().underruns, 1);
+  ASSERT_EQ(mono[0], (20.0f + 21.0f) * 0.5f);
+  ASSERT_EQ(mono[2], (0.0f + 1.0f) * 0.5f);
+  ASSERT_EQ(mono[14], -1.0f);
+  ASSERT_TRUE(buf.Empty());
+}
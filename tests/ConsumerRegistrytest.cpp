@@ -0,0 +1,103 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/ConsumerRegistry.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(ConsumerRegistryTests, AddVisitPrune) {
+  ConsumerRegistry<int> registry;
+  ASSERT_EQ(registry.Size(), 0);
+  ASSERT_FALSE(registry.HasOrphans());
+
+  std::vector<std::shared_ptr<int>> held;
+  for (int i = 0; i < 5; i++) {
+    held.push_back(std::make_shared<int>(i));
+    registry.Add(held.back());
+  }
+
+  ASSERT_EQ(registry.Size(), 5);
+  int sum = 0;
+  registry.ForEach([&sum](int* item) { sum += *item; });
+  ASSERT_EQ(sum, 10);
+
+  // let go of two neighbours -- both should go, not just every other one
+  held.erase(held.begin() + 1, held.begin() + 3);
+  ASSERT_TRUE(registry.HasOrphans());
+  ASSERT_EQ(registry.Prune(), 2);
+  ASSERT_FALSE(registry.HasOrphans());
+  ASSERT_EQ(registry.Prune(), 0);
+
+  std::vector<int> seen;
+  registry.ForEach([&seen](int* item) { seen.push_back(*item); });
+  ASSERT_EQ(seen, std::vector<int>({0, 3, 4}));
+}
+
+// a change made mid-walk leaves the old snapshot on the retired list -- that mustn't keep
+// its entries from looking orphaned once their holders let go
+TEST(ConsumerRegistryTests, AddDuringForEachThenDrop) {
+  ConsumerRegistry<int> registry;
+  std::shared_ptr<int> first = std::make_shared<int>(1);
+  std::shared_ptr<int> second = std::make_shared<int>(2);
+  std::weak_ptr<int> watch = first;
+  registry.Add(first);
+
+  registry.ForEach([&registry, &second](int*) { registry.Add(second); });
+  ASSERT_EQ(registry.Size(), 2);
+
+  first.reset();
+  ASSERT_TRUE(registry.HasOrphans());
+
+  // pruned under a reader: dropped from the snapshot, but not freed until the reader is out
+  registry.ForEach([&registry, &watch](int*) {
+    if (registry.Size() == 2) {
+      ASSERT_EQ(registry.Prune(), 1);
+      ASSERT_FALSE(watch.expired());
+    }
+  });
+
+  ASSERT_FALSE(registry.HasOrphans());
+  registry.Reclaim();
+  ASSERT_TRUE(watch.expired());
+
+  std::vector<int> seen;
+  registry.ForEach([&seen](int* item) { seen.push_back(*item); });
+  ASSERT_EQ(seen, std::vector<int>({2}));
+}
+
+// readers walk snapshots while a writer keeps swapping them out
+TEST(ConsumerRegistryTests, ConcurrentReaders) {
+  ConsumerRegistry<std::atomic<int>> registry;
+  std::atomic<bool> done(false);
+
+  auto reader = [&registry, &done] {
+    while (!done.load(std::memory_order_acquire)) {
+      registry.ForEach([](std::atomic<int>* item) {
+        item->fetch_add(1, std::memory_order_relaxed);
+      });
+    }
+  };
+
+  std::thread a(reader);
+  std::thread b(reader);
+
+  std::shared_ptr<std::atomic<int>> keeper = std::make_shared<std::atomic<int>>(0);
+  registry.Add(keeper);
+  for (int i = 0; i < 2000; i++) {
+    // added, then orphaned straight away
+    registry.Add(std::make_shared<std::atomic<int>>(0));
+    registry.Prune();
+  }
+
+  // make sure the readers got a look in, even on one core
+  while (keeper->load() == 0) {
+    std::this_thread::yield();
+  }
+
+  done.store(true, std::memory_order_release);
+  a.join();
+  b.join();
+
+  registry.Reclaim();
+  ASSERT_EQ(registry.Size(), 1);
+}
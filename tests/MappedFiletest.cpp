@@ -0,0 +1,90 @@
+#include "gtest/gtest.h"
+#include "audioreaders/MappedFile.hpp"
+#include "audioreaders/VorbisReader.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+const std::string mappedfile = "resources/flap_jack_scream.ogg";
+
+static std::vector<float> DecodeSequential(VorbisReader* reader) {
+  int channels = reader->GetChannelCount();
+  std::vector<float> result;
+  std::vector<float> block(4096 * channels);
+  int read;
+  while ((read = reader->GetSamplesInterleaved(4096 * channels, block.data())) > 0) {
+    result.insert(result.end(), block.begin(), block.begin() + read * channels);
+  }
+
+  return result;
+}
+
+// the mapping holds the file, byte for byte
+TEST(MappedFileTests, MatchesFile) {
+  std::ifstream stream(mappedfile, std::ios::binary);
+  ASSERT_TRUE(stream);
+  std::vector<unsigned char> expected((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+  std::unique_ptr<MappedFile> mapping(MappedFile::Open(mappedfile));
+  ASSERT_NE(mapping, nullptr);
+#if defined(__unix__) || defined(__APPLE__)
+  ASSERT_TRUE(mapping->IsMapped());
+#endif
+  ASSERT_EQ(mapping->GetSize(), expected.size());
+  ASSERT_TRUE(std::equal(expected.begin(), expected.end(), mapping->GetData()));
+
+  // prefetching past the end is clamped, not an error
+  mapping->Prefetch(0, mapping->GetSize() * 2);
+  mapping->Prefetch(mapping->GetSize() - 1, 4096);
+  mapping->Prefetch(mapping->GetSize() + 4096, 4096);
+}
+
+TEST(MappedFileTests, RejectsMissingAndEmpty) {
+  ASSERT_EQ(MappedFile::Open(""), nullptr);
+  ASSERT_EQ(MappedFile::Open("resources/does_not_exist.ogg"), nullptr);
+
+  const std::string empty = "MappedFiletest_empty.bin";
+  std::fclose(std::fopen(empty.c_str(), "wb"));
+  ASSERT_EQ(MappedFile::Open(empty), nullptr);
+  std::remove(empty.c_str());
+}
+
+// decoding out of the mapping gives the same samples as decoding through stdio, seeks included
+TEST(MappedFileTests, MappedReaderMatchesStdio) {
+  std::unique_ptr<VorbisReader> stdio(VorbisReader::GetVorbisReader(mappedfile));
+  std::unique_ptr<VorbisReader> mapped(VorbisReader::GetMappedVorbisReader(mappedfile));
+  ASSERT_NE(stdio, nullptr);
+  ASSERT_NE(mapped, nullptr);
+  ASSERT_EQ(mapped->GetChannelCount(), stdio->GetChannelCount());
+  ASSERT_EQ(mapped->GetSampleRate(), stdio->GetSampleRate());
+  ASSERT_EQ(mapped->GetLength(), stdio->GetLength());
+
+  std::vector<float> expected = DecodeSequential(stdio.get());
+  std::vector<float> actual = DecodeSequential(mapped.get());
+  ASSERT_EQ(actual, expected);
+
+  int channels = mapped->GetChannelCount();
+  for (int frame : { 30000, 1000, 70000 }) {
+    stdio->Seek(frame);
+    mapped->Seek(frame);
+    std::vector<float> a(512 * channels), b(512 * channels);
+    ASSERT_EQ(mapped->GetSamplesInterleaved(512 * channels, a.data()),
+              stdio->GetSamplesInterleaved(512 * channels, b.data()));
+    ASSERT_EQ(a, b) << "after seeking to " << frame;
+  }
+}
+
+TEST(MappedFileTests, MappedReaderRejectsGarbage) {
+  const std::string garbage = "MappedFiletest_garbage.ogg";
+  FILE* file = std::fopen(garbage.c_str(), "wb");
+  std::vector<unsigned char> bytes(8192, 0x5a);
+  std::fwrite(bytes.data(), 1, bytes.size(), file);
+  std::fclose(file);
+
+  ASSERT_EQ(VorbisReader::GetMappedVorbisReader(garbage), nullptr);
+  ASSERT_EQ(VorbisReader::GetMappedVorbisReader("resources/does_not_exist.ogg"), nullptr);
+  std::remove(garbage.c_str());
+}
@@ -0,0 +1,77 @@
+#include "gtest/gtest.h"
+#include "audioreaders/MemoryReader.hpp"
+#include "audioreaders/VorbisReader.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+const std::string predecodefile = "resources/flap_jack_scream.ogg";
+
+static std::vector<float> DecodeSequential(VorbisReader* reader) {
+  int channels = reader->GetChannelCount();
+  std::vector<float> result;
+  std::vector<float> block(4096 * channels);
+  int read;
+  while ((read = reader->GetSamplesInterleaved(4096 * channels, block.data())) > 0) {
+    result.insert(result.end(), block.begin(), block.begin() + read * channels);
+  }
+
+  return result;
+}
+
+// the stitched buffer should match one decoder reading straight through, however it's split
+TEST(MemoryReaderTests, MatchesSequentialDecode) {
+  std::unique_ptr<VorbisReader> reader(VorbisReader::GetVorbisReader(predecodefile));
+  ASSERT_NE(reader, nullptr);
+  std::vector<float> expected = DecodeSequential(reader.get());
+  int channels = reader->GetChannelCount();
+
+  for (int threads : { 1, 2, 4, 7 }) {
+    std::unique_ptr<MemoryReader> mem(MemoryReader::PreDecodeVorbis(predecodefile, threads));
+    ASSERT_NE(mem, nullptr);
+    ASSERT_EQ(mem->GetChannelCount(), channels);
+    ASSERT_EQ(mem->GetSampleRate(), reader->GetSampleRate());
+    ASSERT_EQ(mem->GetFrameCount() * channels, expected.size());
+
+    const float* data = mem->GetData();
+    for (size_t i = 0; i < expected.size(); i++) {
+      ASSERT_NEAR(data[i], expected[i], 1e-6) << "threads " << threads << ", sample " << i;
+    }
+  }
+}
+
+TEST(MemoryReaderTests, ReadSeekEnd) {
+  std::vector<float> samples(100 * 2);
+  for (size_t i = 0; i < samples.size(); i++) {
+    samples[i] = static_cast<float>(i) / 256.0f;
+  }
+
+  MemoryReader mem(samples, 2, 44100);
+  std::vector<float> out(64 * 2);
+  ASSERT_EQ(mem.GetSamplesInterleaved(64 * 2, out.data()), 64);
+  ASSERT_EQ(out[127], samples[127]);
+
+  // 36 left
+  ASSERT_EQ(mem.GetSamplesInterleaved(64 * 2, out.data()), 36);
+  ASSERT_EQ(out[0], samples[128]);
+  ASSERT_EQ(mem.GetSamplesInterleaved(64 * 2, out.data()), 0);
+
+  mem.Seek(90);
+  std::vector<float> left(64), right(64);
+  float* planes[2] = { left.data(), right.data() };
+  ASSERT_EQ(mem.GetSamplesPlanar(64, planes), 10);
+  ASSERT_EQ(left[0], samples[180]);
+  ASSERT_EQ(right[9], samples[199]);
+
+  mem.Seek(1);
+  std::vector<int16_t> shorts(4);
+  ASSERT_EQ(mem.GetSamplesInterleaved(4, shorts.data()), 2);
+  ASSERT_EQ(shorts[0], 256);
+}
+
+TEST(MemoryReaderTests, RejectsLongStreams) {
+  // the test file is a little over two seconds long
+  ASSERT_EQ(MemoryReader::PreDecodeVorbis(predecodefile, 2, 1), nullptr);
+  ASSERT_EQ(MemoryReader::PreDecodeVorbis("resources/does_not_exist.ogg"), nullptr);
+}
@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/MixingRing.hpp"
+
+#include <thread>
+#include <vector>
+
+const int mix_channels = 2;
+const int mix_power = 12;
+
+// two sources, one starting partway through the first block
+TEST(MixingRingTests, SumsSources) {
+  MixingRing ring(mix_channels, mix_power);
+  auto a = ring.CreateSource(1.0f);
+  auto b = ring.CreateSource(0.5f);
+  ASSERT_EQ(ring.GetSourceCount(), 2);
+
+  std::vector<float> ones(512 * mix_channels, 0.25f);
+  std::vector<float> halves(512 * mix_channels, 0.5f);
+  ASSERT_EQ(a->Push(0, ones.data(), 512), 512);
+  ASSERT_EQ(b->Push(100, halves.data(), 512), 512);
+
+  std::vector<float> output(256 * mix_channels);
+  ASSERT_EQ(ring.Mix(output.data(), 256), 0);
+  for (int i = 0; i < 256 * mix_channels; i++) {
+    ASSERT_FLOAT_EQ(output[i], (i < 100 * mix_channels ? 0.25f : 0.5f));
+  }
+
+  // b started late -- that's not an underrun
+  ASSERT_EQ(a->GetUnderruns(), 0);
+  ASSERT_EQ(b->GetUnderruns(), 0);
+
+  b->SetGain(1.0f);
+  ASSERT_EQ(ring.Mix(output.data(), 256), 256);
+  for (int i = 0; i < 256 * mix_channels; i++) {
+    ASSERT_FLOAT_EQ(output[i], 0.75f);
+  }
+
+  // a runs out partway through
+  ASSERT_EQ(ring.Mix(output.data(), 256), 512);
+  for (int i = 0; i < 256 * mix_channels; i++) {
+    ASSERT_FLOAT_EQ(output[i], (i < 100 * mix_channels ? 0.5f : 0.0f));
+  }
+
+  ASSERT_EQ(a->GetUnderruns(), 1);
+  ASSERT_EQ(b->GetUnderruns(), 1);
+  ASSERT_EQ(ring.GetMixFrame(), 768);
+}
+
+// gaps are padded with silence, overlaps and late frames are dropped
+TEST(MixingRingTests, GapsAndLateFrames) {
+  MixingRing ring(mix_channels, mix_power);
+  auto src = ring.CreateSource();
+
+  std::vector<float> block(64 * mix_channels, 1.0f);
+  ASSERT_EQ(src->Push(0, block.data(), 64), 64);
+  ASSERT_EQ(src->Push(128, block.data(), 64), 64);
+  ASSERT_EQ(src->GetEndFrame(), 192);
+
+  // overlaps frames 160 - 191, which are already queued
+  ASSERT_EQ(src->Push(160, block.data(), 64), 64);
+  ASSERT_EQ(src->GetEndFrame(), 224);
+
+  std::vector<float> output(256 * mix_channels);
+  ring.Mix(output.data(), 256);
+  for (int i = 0; i < 256; i++) {
+    float expected = ((i < 64 || (i >= 128 && i < 224)) ? 1.0f : 0.0f);
+    ASSERT_FLOAT_EQ(output[i * mix_channels], expected);
+    ASSERT_FLOAT_EQ(output[i * mix_channels + 1], expected);
+  }
+
+  // the mixer has passed 256 -- the first half of this block is too late
+  ASSERT_EQ(src->Push(224, block.data(), 64), 64);
+  ASSERT_EQ(src->Push(288, block.data(), 64), 64);
+  ring.Mix(output.data(), 256);
+  ASSERT_EQ(src->GetLateFrames(), 32);
+  for (int i = 0; i < 256; i++) {
+    ASSERT_FLOAT_EQ(output[i * mix_channels], (i < 96 ? 1.0f : 0.0f));
+  }
+}
+
+// a full lane pushes back, and the ring drops closed sources once drained
+TEST(MixingRingTests, BoundedAndClosed) {
+  MixingRing ring(mix_channels, 8);
+  auto src = ring.CreateSource();
+
+  std::vector<float> block(1024 * mix_channels, 0.125f);
+  ASSERT_EQ(src->Push(block.data(), 1024), 256);
+  ASSERT_EQ(src->Push(block.data(), 1024), 0);
+  src->Close();
+
+  std::vector<float> output(128 * mix_channels);
+  ring.Mix(output.data(), 128);
+  ASSERT_EQ(ring.GetSourceCount(), 1);
+  ASSERT_EQ(src->Push(block.data(), 1024), 128);
+
+  ring.Mix(output.data(), 128);
+  ring.Mix(output.data(), 128);
+  ASSERT_EQ(ring.GetSourceCount(), 0);
+  ASSERT_FLOAT_EQ(output[0], 0.125f);
+}
+
+// the audio thread never frees a source -- it's only let go from Collect
+TEST(MixingRingTests, DrainedSourcesFreedByCollect) {
+  MixingRing ring(mix_channels, 8);
+  std::weak_ptr<MixSource> watch;
+  {
+    auto src = ring.CreateSource();
+    std::vector<float> block(64 * mix_channels, 0.25f);
+    ASSERT_EQ(src->Push(block.data(), 64), 64);
+    src->Close();
+    watch = src;
+  }
+
+  std::vector<float> output(128 * mix_channels);
+  ring.Mix(output.data(), 128);
+  ASSERT_FLOAT_EQ(output[0], 0.25f);
+  ASSERT_FLOAT_EQ(output[64 * mix_channels], 0.0f);
+  ring.Mix(output.data(), 128);
+  ASSERT_FALSE(watch.expired());
+
+  ASSERT_EQ(ring.Collect(), 1);
+  ASSERT_TRUE(watch.expired());
+  ASSERT_EQ(ring.GetSourceCount(), 0);
+  ASSERT_EQ(ring.Collect(), 0);
+}
+
+// several producer threads against one consumer
+TEST(MixingRingTests, MultiProducer) {
+  const int producers = 4;
+  const uint32_t total_frames = 65536;
+  const uint32_t block = 300;
+
+  MixingRing ring(mix_channels, mix_power);
+  std::vector<std::shared_ptr<MixSource>> sources;
+  for (int i = 0; i < producers; i++) {
+    sources.push_back(ring.CreateSource(1.0f));
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < producers; i++) {
+    threads.emplace_back([&sources, i, total_frames, block] {
+      std::vector<float> data(block * mix_channels);
+      uint64_t frame = 0;
+      while (frame < total_frames) {
+        uint32_t len = std::min<uint64_t>(block, total_frames - frame);
+        for (uint32_t j = 0; j < len; j++) {
+          float value = static_cast<float>((frame + j) % 512) * (i + 1);
+          data[j * mix_channels] = value;
+          data[j * mix_channels + 1] = -value;
+        }
+
+        uint32_t done = 0;
+        while (done < len) {
+          done += sources[i]->Push(frame + done, data.data() + done * mix_channels, len - done);
+          if (done < len) {
+            std::this_thread::yield();
+          }
+        }
+
+        frame += len;
+      }
+
+      sources[i]->Close();
+    });
+  }
+
+  // only mix once every producer has the block ready, so that nothing is dropped
+  const uint32_t mix_block = 256;
+  std::vector<float> output(mix_block * mix_channels);
+  uint64_t mixed = 0;
+  while (mixed < total_frames) {
+    bool ready = true;
+    for (auto& src : sources) {
+      ready = ready && (src->GetEndFrame() >= mixed + mix_block);
+    }
+
+    if (!ready) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    ASSERT_EQ(ring.Mix(output.data(), mix_block), mixed);
+    for (uint32_t j = 0; j < mix_block; j++) {
+      // 1 + 2 + 3 + 4
+      float expected = static_cast<float>((mixed + j) % 512) * 10;
+      ASSERT_FLOAT_EQ(output[j * mix_channels], expected);
+      ASSERT_FLOAT_EQ(output[j * mix_channels + 1], -expected);
+    }
+
+    mixed += mix_block;
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // sources which closed after the last mix are let go on the next one
+  float tail[mix_channels];
+  ring.Mix(tail, 1);
+  ASSERT_EQ(ring.GetSourceCount(), 0);
+  for (auto& src : sources) {
+    ASSERT_EQ(src->GetLateFrames(), 0);
+    ASSERT_LE(src->GetUnderruns(), 1);
+  }
+}
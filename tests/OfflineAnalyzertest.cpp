@@ -0,0 +1,130 @@
+#define _USE_MATH_DEFINES
+#include "gtest/gtest.h"
+#include "audiohandlers/OfflineAnalyzer.hpp"
+#include "audioreaders/MemoryReader.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+const int rate = 48000;
+
+// stereo sine, the same in both channels
+static std::vector<float> MakeSine(float frequency, float amplitude, uint32_t frames) {
+  std::vector<float> result(frames * 2);
+  for (uint32_t i = 0; i < frames; i++) {
+    result[2 * i] = result[2 * i + 1] = amplitude * static_cast<float>(std::sin(2.0 * M_PI * frequency * i / rate));
+  }
+
+  return result;
+}
+
+TEST(OfflineAnalyzerTests, RejectsBadOptions) {
+  AnalysisOptions options;
+  options.window = 1000;
+  ASSERT_EQ(OfflineAnalyzer::GetOfflineAnalyzer(rate, options), nullptr);
+  options.window = 1024;
+  options.hop = 2048;
+  ASSERT_EQ(OfflineAnalyzer::GetOfflineAnalyzer(rate, options), nullptr);
+  options.hop = 0;
+  ASSERT_EQ(OfflineAnalyzer::GetOfflineAnalyzer(rate, options), nullptr);
+  options.hop = 512;
+  options.bands = 0;
+  ASSERT_EQ(OfflineAnalyzer::GetOfflineAnalyzer(rate, options), nullptr);
+
+  options.bands = 8;
+  std::unique_ptr<OfflineAnalyzer> analyzer(OfflineAnalyzer::GetOfflineAnalyzer(rate, options));
+  ASSERT_NE(analyzer, nullptr);
+  const std::vector<float>& edges = analyzer->GetBandEdges();
+  ASSERT_EQ(edges.size(), 9);
+  ASSERT_FLOAT_EQ(edges.front(), options.min_frequency);
+  ASSERT_FLOAT_EQ(edges.back(), rate / 2.0f);
+}
+
+// a sine's features land where they should: level, centroid, and the band holding it
+TEST(OfflineAnalyzerTests, SineFeatures) {
+  AnalysisOptions options;
+  std::unique_ptr<OfflineAnalyzer> analyzer(OfflineAnalyzer::GetOfflineAnalyzer(rate, options));
+  const float frequency = 1000.0f;
+  std::vector<float> sine = MakeSine(frequency, 0.5f, rate);
+  const std::vector<float>& edges = analyzer->GetBandEdges();
+
+  int windows = 0;
+  analyzer->Process(sine.data(), 2, rate, [&](const AnalysisFrame& frame) {
+    ASSERT_EQ(frame.frame, static_cast<uint64_t>(windows) * options.hop);
+    ASSERT_NEAR(frame.rms, 0.5f / std::sqrt(2.0f), 0.01f);
+    ASSERT_NEAR(frame.peak, 0.5f, 0.01f);
+    ASSERT_NEAR(frame.zero_crossings, 2.0f * frequency / rate, 0.001f);
+    ASSERT_NEAR(frame.centroid, frequency, 50.0f);
+    ASSERT_NEAR(frame.rolloff, frequency, 50.0f);
+
+    int loudest = 0;
+    for (int b = 1; b < options.bands; b++) {
+      loudest = (frame.bands[b] > frame.bands[loudest] ? b : loudest);
+    }
+
+    ASSERT_LE(edges[loudest], frequency);
+    ASSERT_GT(edges[loudest + 1], frequency);
+    if (windows > 0) {
+      // a steady tone barely changes from window to window
+      ASSERT_LT(frame.flux, 0.01f);
+    }
+
+    windows++;
+  });
+
+  // every complete window, and nothing past the end
+  ASSERT_EQ(windows, (rate - options.window) / options.hop + 1);
+}
+
+// feeding in odd-sized pieces finds the same windows as feeding it all at once
+TEST(OfflineAnalyzerTests, ChunkingDoesNotMatter) {
+  AnalysisOptions options;
+  options.window = 1024;
+  options.hop = 300;
+  std::vector<float> sine = MakeSine(440.0f, 0.8f, 20000);
+
+  std::vector<float> whole;
+  std::unique_ptr<OfflineAnalyzer> analyzer(OfflineAnalyzer::GetOfflineAnalyzer(rate, options));
+  analyzer->Process(sine.data(), 2, 20000, [&whole](const AnalysisFrame& frame) {
+    whole.push_back(frame.centroid);
+    whole.push_back(frame.flux);
+  });
+
+  analyzer->Reset();
+  std::vector<float> pieces;
+  uint32_t done = 0;
+  for (uint32_t len : { 1u, 777u, 4096u, 13u }) {
+    while (done < 20000) {
+      uint32_t n = std::min(len, 20000 - done);
+      analyzer->Process(sine.data() + done * 2, 2, n, [&pieces](const AnalysisFrame& frame) {
+        pieces.push_back(frame.centroid);
+        pieces.push_back(frame.flux);
+      });
+
+      done += n;
+      if (done % 5000 < n) {
+        break;
+      }
+    }
+  }
+
+  ASSERT_EQ(done, 20000);
+  ASSERT_EQ(pieces, whole);
+}
+
+// Run reads a reader to the end and reports how much went through
+TEST(OfflineAnalyzerTests, RunReader) {
+  MemoryReader reader(MakeSine(200.0f, 0.25f, rate * 2), 2, rate);
+  std::unique_ptr<OfflineAnalyzer> analyzer(OfflineAnalyzer::GetOfflineAnalyzer(rate));
+  int windows = 0;
+  AnalysisSummary summary = analyzer->Run(&reader, [&windows](const AnalysisFrame& frame) {
+    windows++;
+  });
+
+  ASSERT_EQ(summary.frames, rate * 2);
+  ASSERT_EQ(summary.windows, windows);
+  ASSERT_EQ(windows, (rate * 2 - 2048) / 1024 + 1);
+  ASSERT_DOUBLE_EQ(summary.audio_seconds, 2.0);
+  ASSERT_GT(summary.GetRealtimeFactor(), 1.0);
+}
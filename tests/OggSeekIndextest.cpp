@@ -0,0 +1,137 @@
+#include "gtest/gtest.h"
+#include "audioreaders/OggSeekIndex.hpp"
+#include "audioreaders/VorbisReader.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+const std::string indexfile = "resources/flap_jack_scream.ogg";
+
+// pages come out in stream order, and scanning in memory agrees with scanning the file
+TEST(OggSeekIndexTests, BuildAndScan) {
+  std::unique_ptr<OggSeekIndex> index(OggSeekIndex::Build(indexfile));
+  ASSERT_NE(index, nullptr);
+  const std::vector<OggPage>& pages = index->GetPages();
+  ASSERT_GT(pages.size(), 2);
+  for (size_t i = 1; i < pages.size(); i++) {
+    ASSERT_GT(pages[i].offset, pages[i - 1].offset);
+    ASSERT_GE(pages[i].granule, pages[i - 1].granule);
+  }
+
+  std::unique_ptr<VorbisReader> reader(VorbisReader::GetVorbisReader(indexfile));
+  ASSERT_EQ(pages.back().granule, static_cast<uint64_t>(reader->GetLength()));
+
+  std::ifstream file(indexfile, std::ios::binary);
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  ASSERT_EQ(index->GetSize(), data.size());
+  std::unique_ptr<OggSeekIndex> scanned(OggSeekIndex::Scan(data.data(), data.size()));
+  ASSERT_NE(scanned, nullptr);
+  ASSERT_EQ(scanned->GetPages().size(), pages.size());
+  for (size_t i = 0; i < pages.size(); i++) {
+    ASSERT_EQ(scanned->GetPages()[i].offset, pages[i].offset);
+    ASSERT_EQ(scanned->GetPages()[i].granule, pages[i].granule);
+  }
+
+  ASSERT_EQ(OggSeekIndex::Build("resources/not_a_file.ogg"), nullptr);
+}
+
+TEST(OggSeekIndexTests, FindPages) {
+  std::unique_ptr<OggSeekIndex> index(OggSeekIndex::Build(indexfile));
+  const std::vector<OggPage>& pages = index->GetPages();
+  uint64_t left, right;
+
+  // right on a page boundary -- the left page has to end a margin before it
+  size_t mid = pages.size() / 2;
+  index->FindPages(pages[mid].granule, 0, &left, &right);
+  ASSERT_EQ(left, pages[mid - 1].offset);
+  ASSERT_EQ(right, pages[mid + 1].offset);
+
+  index->FindPages(pages[mid].granule + 1, 0, &left, &right);
+  ASSERT_EQ(left, pages[mid].offset);
+  ASSERT_EQ(right, pages[mid + 1].offset);
+
+  index->FindPages(0, 1024, &left, &right);
+  ASSERT_EQ(left, 0);
+
+  index->FindPages(pages.back().granule + 100, 0, &left, &right);
+  ASSERT_EQ(right, pages.back().offset);
+}
+
+// indexed seeks land on exactly the same samples as bisecting ones
+// (the long file matters -- stb_vorbis scans anything under 64KB without bisecting)
+TEST(OggSeekIndexTests, SeeksMatchUnindexed) {
+  for (const std::string& file : { indexfile, std::string("resources/shawty.ogg") }) {
+    std::unique_ptr<VorbisReader> plain(VorbisReader::GetVorbisReader(file));
+    std::unique_ptr<VorbisReader> indexed(VorbisReader::GetIndexedVorbisReader(file, testing::TempDir()));
+    ASSERT_NE(plain, nullptr);
+    ASSERT_NE(indexed, nullptr);
+
+    int channels = plain->GetChannelCount();
+    int64_t length = plain->GetLength();
+    std::vector<float> expected(256 * channels);
+    std::vector<float> actual(256 * channels);
+    for (int64_t target : { int64_t(0), int64_t(1), int64_t(100), length / 7, length / 3, length / 2,
+                            length / 2 + 1, length - 5000, length - 256 }) {
+      plain->Seek(static_cast<int>(target));
+      indexed->Seek(static_cast<int>(target));
+      int a = plain->GetSamplesInterleaved(256 * channels, expected.data());
+      int b = indexed->GetSamplesInterleaved(256 * channels, actual.data());
+      ASSERT_EQ(a, b) << file << ", target " << target;
+      for (int i = 0; i < a * channels; i++) {
+        ASSERT_FLOAT_EQ(actual[i], expected[i]) << file << ", target " << target << ", sample " << i;
+      }
+    }
+
+    std::remove(OggSeekIndex::GetIndexPath(file, testing::TempDir()).c_str());
+  }
+}
+
+// saved indices come back intact, and are refused once they no longer match the file
+TEST(OggSeekIndexTests, SaveAndLoad) {
+  std::string dir = testing::TempDir();
+  std::string path = OggSeekIndex::GetIndexPath(indexfile, dir);
+  ASSERT_NE(path, OggSeekIndex::GetIndexPath("elsewhere/flap_jack_scream.ogg", dir));
+  ASSERT_EQ(OggSeekIndex::GetIndexPath(indexfile), indexfile + ".seekidx");
+
+  std::unique_ptr<OggSeekIndex> built(OggSeekIndex::Build(indexfile));
+  ASSERT_TRUE(built->Save(path));
+  std::unique_ptr<OggSeekIndex> loaded(OggSeekIndex::Load(path, indexfile));
+  ASSERT_NE(loaded, nullptr);
+  ASSERT_EQ(loaded->GetSize(), built->GetSize());
+  ASSERT_EQ(loaded->GetPages().size(), built->GetPages().size());
+  for (size_t i = 0; i < built->GetPages().size(); i++) {
+    ASSERT_EQ(loaded->GetPages()[i].offset, built->GetPages()[i].offset);
+    ASSERT_EQ(loaded->GetPages()[i].granule, built->GetPages()[i].granule);
+  }
+
+  // an index for a different file is stale
+  std::string other = dir + "/other.ogg";
+  {
+    std::ifstream in(indexfile, std::ios::binary);
+    std::ofstream out(other, std::ios::binary);
+    out << in.rdbuf() << "trailing junk";
+  }
+
+  ASSERT_EQ(OggSeekIndex::Load(path, other), nullptr);
+
+  // as is a truncated one
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << "OggIdx01";
+  }
+
+  ASSERT_EQ(OggSeekIndex::Load(path, indexfile), nullptr);
+
+  // GetIndex rebuilds it
+  std::unique_ptr<OggSeekIndex> rebuilt(OggSeekIndex::GetIndex(indexfile, dir));
+  ASSERT_NE(rebuilt, nullptr);
+  ASSERT_EQ(rebuilt->GetPages().size(), built->GetPages().size());
+  std::unique_ptr<OggSeekIndex> reloaded(OggSeekIndex::Load(path, indexfile));
+  ASSERT_NE(reloaded, nullptr);
+
+  std::remove(path.c_str());
+  std::remove(other.c_str());
+}
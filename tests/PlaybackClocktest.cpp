@@ -0,0 +1,120 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/PlaybackClock.hpp"
+
+#include <atomic>
+#include <thread>
+
+const double rate = 48000.0;
+const uint32_t block = 480;
+
+TEST(PlaybackClockTests, ExtrapolatesFromLatestAnchor) {
+  PlaybackClock clock;
+  clock.Reset(rate);
+  ClockAnchor anchor;
+  ASSERT_FALSE(clock.GetAnchor(&anchor));
+  ASSERT_EQ(clock.GetFrame(1.0), -1);
+
+  // first block reaches the DAC 50ms after t=1
+  clock.Publish(0, block, 1.05);
+  ASSERT_TRUE(clock.GetAnchor(&anchor));
+  ASSERT_EQ(anchor.frame, 0);
+  ASSERT_EQ(anchor.frames, block);
+  ASSERT_DOUBLE_EQ(anchor.rate, rate);
+
+  // nothing audible before the first frame, and never past the last one published
+  ASSERT_EQ(clock.GetFrame(1.0), 0);
+  ASSERT_NEAR(clock.GetFrame(1.055), 240, 1);
+  ASSERT_EQ(clock.GetFrame(2.0), block);
+
+  clock.Publish(block, block, 1.06);
+  ASSERT_NEAR(clock.GetFrame(1.065), block + 240, 1);
+
+  clock.Reset(rate);
+  ASSERT_FALSE(clock.GetAnchor(&anchor));
+  ASSERT_EQ(clock.GetFrame(1.065), -1);
+}
+
+// a device running 0.5% fast -- after a second of unbroken playback the clock runs fast with it
+TEST(PlaybackClockTests, MeasuresDrift) {
+  PlaybackClock clock;
+  clock.Reset(rate);
+  double device_rate = rate * 1.005;
+  uint64_t frame = 0;
+  for (int i = 0; i < 300; i++) {
+    clock.Publish(frame, block, frame / device_rate);
+    frame += block;
+  }
+
+  ClockAnchor anchor;
+  ASSERT_TRUE(clock.GetAnchor(&anchor));
+  ASSERT_NEAR(anchor.rate, device_rate, 0.5);
+
+  double mid = anchor.time + (block / 2) / device_rate;
+  ASSERT_NEAR(clock.GetFrame(mid), anchor.frame + block / 2, 1);
+}
+
+// an underrun leaves a hole in the DAC times -- the rate measurement starts over from there
+TEST(PlaybackClockTests, RebaselinesOnGlitch) {
+  PlaybackClock clock;
+  clock.Reset(rate);
+  uint64_t frame = 0;
+  double time = 0.0;
+  for (int i = 0; i < 150; i++) {
+    clock.Publish(frame, block, time);
+    frame += block;
+    time += block / (rate * 1.005);
+  }
+
+  ClockAnchor anchor;
+  ASSERT_TRUE(clock.GetAnchor(&anchor));
+  ASSERT_GT(anchor.rate, rate);
+
+  // 100ms of silence, then playback picks up where it left off
+  time += 0.1;
+  clock.Publish(frame, block, time);
+  ASSERT_TRUE(clock.GetAnchor(&anchor));
+  ASSERT_DOUBLE_EQ(anchor.rate, rate);
+  ASSERT_DOUBLE_EQ(anchor.time, time);
+  ASSERT_NEAR(clock.GetFrame(time + 0.005), frame + 240, 1);
+
+  // implausible rates are put down to something other than drift
+  frame += block;
+  time += block / (rate * 1.5);
+  for (int i = 0; i < 150; i++) {
+    clock.Publish(frame, block, time);
+    frame += block;
+    time += block / (rate * 1.5);
+  }
+
+  ASSERT_TRUE(clock.GetAnchor(&anchor));
+  ASSERT_DOUBLE_EQ(anchor.rate, rate);
+}
+
+// readers must never see one anchor's frame with another's time
+TEST(PlaybackClockTests, ConcurrentReadersSeeWholeAnchors) {
+  PlaybackClock clock;
+  clock.Reset(rate);
+  const int blocks = 100000;
+  std::atomic<bool> done(false);
+  std::atomic<int> torn(0);
+
+  std::thread reader([&] {
+    ClockAnchor anchor;
+    while (!done.load(std::memory_order_acquire)) {
+      if (clock.GetAnchor(&anchor)) {
+        uint64_t index = anchor.frame / block;
+        if (anchor.frame % block != 0 || anchor.time != index * 0.01 || anchor.frames != block) {
+          torn++;
+        }
+      }
+    }
+  });
+
+  for (uint64_t i = 0; i < blocks; i++) {
+    clock.Publish(i * block, block, i * 0.01);
+  }
+
+  done.store(true, std::memory_order_release);
+  reader.join();
+  ASSERT_EQ(torn.load(), 0);
+}
@@ -0,0 +1,198 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/Playlist.hpp"
+#include "audioreaders/MemoryReader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// a low sample rate keeps the preload window small -- 2 seconds is 200 frames
+const int playlist_rate = 100;
+
+struct FakeTrack {
+  int frames;
+  int channels;
+  float base;   // sample i of the track holds base + i
+  int rate = playlist_rate;
+};
+
+static std::map<std::string, FakeTrack> fake_tracks = {
+  { "a", { 1000, 2, 0.0f } },
+  { "b", { 700, 2, 10000.0f } },
+  { "mono", { 300, 1, 20000.0f } },
+  { "d", { 500, 2, 30000.0f } },
+  { "e", { 50, 2, 40000.0f } },
+  { "half", { 100, 2, 0.0f, playlist_rate / 2 } }
+};
+
+static std::atomic<int> opens(0);
+
+static AudioReader* OpenFake(const std::string& file) {
+  opens++;
+  auto track = fake_tracks.find(file);
+  if (track == fake_tracks.end()) {
+    return nullptr;
+  }
+
+  std::vector<float> samples(track->second.frames * track->second.channels);
+  for (size_t i = 0; i < samples.size(); i++) {
+    samples[i] = track->second.base + i;
+  }
+
+  return new MemoryReader(samples, track->second.channels, track->second.rate);
+}
+
+static std::vector<float> Expected(std::vector<std::string> files) {
+  std::vector<float> result;
+  for (const std::string& file : files) {
+    const FakeTrack& track = fake_tracks[file];
+    for (int i = 0; i < track.frames * track.channels; i++) {
+      result.push_back(track.base + i);
+    }
+  }
+
+  return result;
+}
+
+// tracks run straight into one another, whatever the read size -- and tracks which can't be
+// opened, or don't match the stream's format, are skipped
+TEST(PlaylistTests, GaplessSplice) {
+  std::unique_ptr<Playlist> playlist(Playlist::GetPlaylist({ "missing", "a", "b", "mono", "missing", "d" }, OpenFake, 2));
+  ASSERT_NE(playlist, nullptr);
+  ASSERT_EQ(playlist->GetChannelCount(), 2);
+  ASSERT_EQ(playlist->GetSampleRate(), playlist_rate);
+
+  std::vector<float> expected = Expected({ "a", "b", "d" });
+  std::vector<float> output;
+  std::vector<float> block(333 * 2);
+  int read;
+  while ((read = playlist->GetSamplesInterleaved(333 * 2, block.data())) == 333) {
+    output.insert(output.end(), block.begin(), block.end());
+  }
+
+  // 2200 frames, so the last read comes up short
+  ASSERT_EQ(read, 2200 % 333);
+  output.insert(output.end(), block.begin(), block.begin() + read * 2);
+  ASSERT_EQ(output, expected);
+
+  std::vector<TrackSplice> splices = playlist->GetSplices();
+  ASSERT_EQ(splices.size(), 3);
+  ASSERT_EQ(splices[0].frame, 0);
+  ASSERT_EQ(splices[0].file, "a");
+  ASSERT_EQ(splices[1].frame, 1000);
+  ASSERT_EQ(splices[1].file, "b");
+  ASSERT_EQ(splices[2].frame, 1700);
+  ASSERT_EQ(splices[2].file, "d");
+
+  ASSERT_EQ(playlist->GetSamplesInterleaved(333 * 2, block.data()), 0);
+}
+
+// the next track is opened in the background as soon as the current one starts --
+// reads carry on meanwhile, however long the open takes
+TEST(PlaylistTests, PreloadsWhilePlaying) {
+  opens = 0;
+  std::atomic<bool> release(false);
+  Playlist::Opener opener = [&release](const std::string& file) -> AudioReader* {
+    while (file == "b" && !release.load()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return OpenFake(file);
+  };
+
+  std::unique_ptr<Playlist> playlist(Playlist::GetPlaylist({ "a", "b" }, opener, 2));
+  ASSERT_NE(playlist, nullptr);
+  ASSERT_EQ(opens, 1);
+  ASSERT_EQ(playlist->GetQueuedCount(), 1);
+
+  std::vector<float> block(1000 * 2);
+  ASSERT_EQ(playlist->GetSamplesInterleaved(100 * 2, block.data()), 100);
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (playlist->GetQueuedCount() > 0 && std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // b is still opening, and a plays on regardless
+  ASSERT_EQ(playlist->GetQueuedCount(), 0);
+  ASSERT_EQ(playlist->GetSamplesInterleaved(800 * 2, block.data()), 800);
+  ASSERT_EQ(opens, 1);
+
+  // the rest of a, then all of b
+  release = true;
+  ASSERT_EQ(playlist->GetSamplesInterleaved(1000 * 2, block.data()), 800);
+  ASSERT_EQ(opens, 2);
+  std::vector<float> expected = Expected({ "a", "b" });
+  for (int i = 0; i < 800 * 2; i++) {
+    ASSERT_EQ(block[i], expected[900 * 2 + i]);
+  }
+}
+
+// a track queued after the playlist has run dry still plays
+TEST(PlaylistTests, EnqueueAfterEnd) {
+  std::unique_ptr<Playlist> playlist(Playlist::GetPlaylist({ "e" }, OpenFake, 2));
+  ASSERT_NE(playlist, nullptr);
+
+  std::vector<float> block(100 * 2);
+  ASSERT_EQ(playlist->GetSamplesInterleaved(100 * 2, block.data()), 50);
+  ASSERT_EQ(playlist->GetSamplesInterleaved(100 * 2, block.data()), 0);
+
+  playlist->Enqueue("e");
+  ASSERT_EQ(playlist->GetSamplesInterleaved(100 * 2, block.data()), 50);
+  ASSERT_EQ(block[0], 40000.0f);
+
+  std::vector<TrackSplice> splices = playlist->GetSplices();
+  ASSERT_EQ(splices.size(), 2);
+  ASSERT_EQ(splices[1].frame, 50);
+}
+
+// seeking back to 0 replays every track -- finished or not, and enqueued ones included
+TEST(PlaylistTests, SeekRewinds) {
+  std::unique_ptr<Playlist> playlist(Playlist::GetPlaylist({ "e", "d" }, OpenFake, 2));
+  ASSERT_NE(playlist, nullptr);
+  playlist->Enqueue("e");
+
+  std::vector<float> expected = Expected({ "e", "d", "e" });
+  std::vector<float> block(1000 * 2);
+  for (int pass = 0; pass < 2; pass++) {
+    ASSERT_EQ(playlist->GetSamplesInterleaved(1000 * 2, block.data()), 600);
+    ASSERT_TRUE(std::equal(expected.begin(), expected.end(), block.begin()));
+    ASSERT_EQ(playlist->GetSamplesInterleaved(1000 * 2, block.data()), 0);
+
+    std::vector<TrackSplice> splices = playlist->GetSplices();
+    ASSERT_EQ(splices.size(), 3);
+    ASSERT_EQ(splices[1].frame, 50);
+    ASSERT_EQ(splices[2].frame, 550);
+    playlist->Seek(0);
+  }
+
+  // partway into the first track, it's only seeked back
+  ASSERT_EQ(playlist->GetSamplesInterleaved(20 * 2, block.data()), 20);
+  playlist->Seek(0);
+  ASSERT_EQ(playlist->GetSamplesInterleaved(1000 * 2, block.data()), 600);
+  ASSERT_TRUE(std::equal(expected.begin(), expected.end(), block.begin()));
+  ASSERT_EQ(playlist->GetSplices().size(), 3);
+}
+
+// a track at another rate is converted to the stream's rate, rather than skipped
+TEST(PlaylistTests, ResamplesMismatchedRate) {
+  std::unique_ptr<Playlist> playlist(Playlist::GetPlaylist({ "e", "half", "e" }, OpenFake, 2));
+  ASSERT_NE(playlist, nullptr);
+
+  std::vector<float> block(1000 * 2);
+  ASSERT_EQ(playlist->GetSamplesInterleaved(1000 * 2, block.data()), 50 + 200 + 50);
+
+  std::vector<TrackSplice> splices = playlist->GetSplices();
+  ASSERT_EQ(splices.size(), 3);
+  ASSERT_EQ(splices[1].frame, 50);
+  ASSERT_EQ(splices[2].frame, 250);
+  ASSERT_EQ(block[250 * 2], 40000.0f);
+}
+
+TEST(PlaylistTests, NothingPlayable) {
+  ASSERT_EQ(Playlist::GetPlaylist({ "missing" }, OpenFake), nullptr);
+  ASSERT_EQ(Playlist::GetPlaylist({ }, OpenFake), nullptr);
+}
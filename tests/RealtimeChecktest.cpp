@@ -0,0 +1,172 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/MixingRing.hpp"
+#include "audiohandlers/RealtimeCheck.hpp"
+#include "audiohandlers/VorbisManager.hpp"
+#include "audioreaders/MemoryReader.hpp"
+#include "audiosinks/NullSink.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// the tests below only mean anything with the interposers built in (set rtcheck ON)
+
+static uint64_t Count(const RealtimeReport& report, RealtimeViolation kind) {
+  return report.violations[static_cast<int>(kind)];
+}
+
+// somewhere for allocations to go, so they can't be optimized out
+static std::vector<int>* volatile sink_vector;
+
+TEST(RealtimeCheckTests, DisabledReportsNothing) {
+  if (RealtimeCheck::IsEnabled()) {
+    GTEST_SKIP();
+  }
+
+  {
+    RealtimeScope scope;
+    sink_vector = new std::vector<int>(64);
+    delete sink_vector;
+  }
+
+  RealtimeReport report = RealtimeCheck::GetReport();
+  ASSERT_FALSE(report.enabled);
+  ASSERT_EQ(report.scopes, 0);
+  ASSERT_EQ(Count(report, RealtimeViolation::ALLOCATION), 0);
+}
+
+TEST(RealtimeCheckTests, CatchesAllocation) {
+  if (!RealtimeCheck::IsEnabled()) {
+    GTEST_SKIP();
+  }
+
+  RealtimeCheck::Reset();
+  // outside a scope, anything goes
+  sink_vector = new std::vector<int>(64);
+  delete sink_vector;
+  ASSERT_EQ(Count(RealtimeCheck::GetReport(), RealtimeViolation::ALLOCATION), 0);
+
+  {
+    RealtimeScope scope;
+    sink_vector = new std::vector<int>(64);
+  }
+
+  RealtimeReport report = RealtimeCheck::GetReport();
+  // the vector, and its storage
+  ASSERT_EQ(Count(report, RealtimeViolation::ALLOCATION), 2);
+  ASSERT_EQ(report.records.size(), 2);
+  ASSERT_EQ(report.records[0].kind, RealtimeViolation::ALLOCATION);
+  ASSERT_GT(report.records[0].depth, 2);
+  delete sink_vector;
+}
+
+TEST(RealtimeCheckTests, CatchesLocksAndWrites) {
+  if (!RealtimeCheck::IsEnabled()) {
+    GTEST_SKIP();
+  }
+
+  std::mutex mutex;
+  FILE* null = std::fopen("/dev/null", "w");
+  ASSERT_NE(null, nullptr);
+  // the first write allocates the stream's buffer -- get it out of the way
+  std::fwrite("dingo", 1, 5, null);
+  RealtimeCheck::Reset();
+  {
+    RealtimeScope scope;
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fwrite("dingo", 1, 5, null);
+  }
+
+  RealtimeReport report = RealtimeCheck::GetReport();
+  std::fclose(null);
+  ASSERT_EQ(Count(report, RealtimeViolation::LOCK), 1);
+  ASSERT_GE(Count(report, RealtimeViolation::WRITE), 1);
+  ASSERT_EQ(Count(report, RealtimeViolation::ALLOCATION), 0);
+}
+
+// only the outermost scope is timed, and the percentiles come out of those times
+TEST(RealtimeCheckTests, TimesScopes) {
+  if (!RealtimeCheck::IsEnabled()) {
+    GTEST_SKIP();
+  }
+
+  RealtimeCheck::Reset();
+  for (int i = 0; i < 20; i++) {
+    RealtimeScope scope;
+    RealtimeScope nested;
+  }
+
+  {
+    RealtimeScope scope;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  RealtimeReport report = RealtimeCheck::GetReport();
+  ASSERT_EQ(report.scopes, 21);
+  ASSERT_LT(report.p50, 0.001);
+  ASSERT_GE(report.max, 0.005);
+  ASSERT_GE(report.p999, 0.005);
+  ASSERT_LE(report.p50, report.p99);
+  ASSERT_LE(report.p99, report.p999);
+  ASSERT_LE(report.p999, report.max);
+}
+
+// mixing takes no lock and frees nothing, even as sources drain
+TEST(RealtimeCheckTests, MixIsClean) {
+  if (!RealtimeCheck::IsEnabled()) {
+    GTEST_SKIP();
+  }
+
+  MixingRing ring(2, 10);
+  std::vector<float> block(256 * 2, 0.5f);
+  std::vector<float> output(256 * 2);
+  std::shared_ptr<MixSource> kept = ring.CreateSource();
+  {
+    std::shared_ptr<MixSource> dropped = ring.CreateSource();
+    dropped->Push(block.data(), 256);
+    dropped->Close();
+  }
+
+  RealtimeCheck::Reset();
+  for (int i = 0; i < 4; i++) {
+    kept->Push(block.data(), 256);
+    RealtimeScope scope;
+    ring.Mix(output.data(), 256);
+  }
+
+  RealtimeReport report = RealtimeCheck::GetReport();
+  ASSERT_EQ(report.scopes, 4);
+  ASSERT_EQ(Count(report, RealtimeViolation::ALLOCATION), 0);
+  ASSERT_EQ(Count(report, RealtimeViolation::LOCK), 0);
+  ASSERT_EQ(ring.Collect(), 1);
+}
+
+// the manager's callback stays clean end to end
+TEST(RealtimeCheckTests, ManagerCallbackIsClean) {
+  if (!RealtimeCheck::IsEnabled()) {
+    GTEST_SKIP();
+  }
+
+  const int rate = 48000;
+  std::vector<float> samples(rate * 2, 0.25f);
+  MemoryReader* reader = new MemoryReader(samples, 2, rate);
+  VorbisManager* mgr = VorbisManager::GetVorbisManager(15, reader, 2, new NullSink(SinkClock::FREE_RUNNING, 256));
+  ASSERT_NE(mgr, nullptr);
+  // something for the callback to mix in, which drains partway through
+  std::shared_ptr<MixSource> source = mgr->CreateMixSource();
+  source->Push(samples.data(), 4096);
+  source->Close();
+
+  RealtimeCheck::Reset();
+  mgr->StartWriteThread();
+  mgr->ThreadWait();
+  RealtimeReport report = RealtimeCheck::GetReport();
+  delete mgr;
+
+  ASSERT_GE(report.scopes, rate / 256);
+  ASSERT_EQ(Count(report, RealtimeViolation::ALLOCATION), 0);
+  ASSERT_EQ(Count(report, RealtimeViolation::WRITE), 0);
+  ASSERT_EQ(Count(report, RealtimeViolation::LOCK), 0);
+}
@@ -0,0 +1,74 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/RefillScheduler.hpp"
+
+#include <thread>
+
+TEST(RefillSchedulerTests, AdaptsToBursts) {
+  RefillScheduler refill(8192);
+  ASSERT_EQ(refill.GetBurst(), 0);
+  ASSERT_EQ(refill.GetRefillFrames(5000), 5000);
+
+  refill.OnConsumed(256, 8000);
+  ASSERT_EQ(refill.GetBurst(), 256);
+  ASSERT_EQ(refill.GetWatermark(), 6144);
+  ASSERT_EQ(refill.GetRefillFrames(1000), 768);
+  ASSERT_EQ(refill.GetRefillFrames(200), 0);
+
+  // a big block raises the burst straight away
+  refill.OnConsumed(1024, 7000);
+  ASSERT_EQ(refill.GetBurst(), 1024);
+  ASSERT_EQ(refill.GetRefillFrames(3000), 2048);
+
+  // ...and smaller ones bring it back down gradually
+  for (int i = 0; i < 200; i++) {
+    refill.OnConsumed(256, 7000);
+  }
+
+  ASSERT_LT(refill.GetBurst(), 300);
+  ASSERT_GE(refill.GetBurst(), 256);
+
+  // the watermark is a share of the ring, whatever the burst
+  refill.OnConsumed(4096, 8000);
+  ASSERT_EQ(refill.GetWatermark(), 6144);
+}
+
+TEST(RefillSchedulerTests, FlagsWriter) {
+  RefillScheduler refill(8192);
+  ASSERT_FALSE(refill.Wait(std::chrono::milliseconds(1)));
+
+  // above the watermark -- nothing flagged
+  refill.OnConsumed(512, 6500);
+  ASSERT_FALSE(refill.Wait(std::chrono::milliseconds(1)));
+  ASSERT_EQ(refill.GetWakeups(), 0);
+
+  // below it -- the consumer only flags, so the writer finds out when its wait runs out
+  std::thread writer([&refill] {
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(refill.Wait(std::chrono::milliseconds(100)));
+    ASSERT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  refill.OnConsumed(512, 6000);
+  writer.join();
+  ASSERT_EQ(refill.GetWakeups(), 1);
+
+  // consumed, so a second wait times out
+  ASSERT_FALSE(refill.Wait(std::chrono::milliseconds(1)));
+
+  // flagged before the writer waits -- no sleep at all
+  refill.OnConsumed(512, 1000);
+  ASSERT_TRUE(refill.Wait(std::chrono::seconds(10)));
+  ASSERT_EQ(refill.GetWakeups(), 2);
+}
+
+TEST(RefillSchedulerTests, SignalWakesWriter) {
+  RefillScheduler refill(8192);
+  std::thread writer([&refill] {
+    ASSERT_TRUE(refill.Wait(std::chrono::seconds(10)));
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  refill.Signal();
+  writer.join();
+}
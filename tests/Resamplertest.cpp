@@ -0,0 +1,109 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/Resampler.hpp"
+#include "audioreaders/MemoryReader.hpp"
+#include "audioreaders/ResamplingReader.hpp"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+const double resample_pi = 3.14159265358979323846;
+
+// stereo -- a sine on the left, and a quieter one an octave up on the right
+static std::vector<float> MakeSines(int rate, uint32_t frames) {
+  std::vector<float> result(frames * 2);
+  for (uint32_t i = 0; i < frames; i++) {
+    double t = static_cast<double>(i) / rate;
+    result[2 * i] = static_cast<float>(0.8 * sin(2 * resample_pi * 1000.0 * t));
+    result[2 * i + 1] = static_cast<float>(0.4 * sin(2 * resample_pi * 2000.0 * t));
+  }
+
+  return result;
+}
+
+static std::vector<float> Resample(Resampler& resampler, const std::vector<float>& input, uint32_t block) {
+  uint32_t frames = static_cast<uint32_t>(input.size() / 2);
+  std::vector<float> output;
+  std::vector<float> scratch(resampler.GetMaxOutput(block) * 2);
+  for (uint32_t i = 0; i < frames; i += block) {
+    uint32_t len = std::min(block, frames - i);
+    uint32_t written = resampler.Process(input.data() + 2 * i, len, scratch.data());
+    output.insert(output.end(), scratch.begin(), scratch.begin() + written * 2);
+  }
+
+  scratch.resize(resampler.GetMaxOutput(resampler.GetDelay()) * 2);
+  uint32_t written = resampler.Flush(scratch.data());
+  output.insert(output.end(), scratch.begin(), scratch.begin() + written * 2);
+  return output;
+}
+
+// output should be the same sines sampled at the new rate -- including ratios too awkward
+// for one filter per phase
+TEST(ResamplerTests, SineAcrossRatios) {
+  const int rates[][2] = { { 44100, 48000 }, { 48000, 44100 }, { 96000, 44100 }, { 22050, 44100 },
+                           { 44100, 44100 }, { 44100, 44101 } };
+  const uint32_t frames = 8000;
+  for (auto& rate : rates) {
+    Resampler resampler(rate[0], rate[1], 2);
+    std::vector<float> output = Resample(resampler, MakeSines(rate[0], frames), 300);
+    uint64_t expected_frames = (static_cast<uint64_t>(frames) * rate[1] + rate[0] - 1) / rate[0];
+    ASSERT_EQ(output.size(), expected_frames * 2) << rate[0] << " -> " << rate[1];
+
+    // the ends are filtered against silence -- skip them
+    std::vector<float> reference = MakeSines(rate[1], static_cast<uint32_t>(expected_frames));
+    uint32_t edge = 128;
+    double worst = 0.0;
+    for (size_t i = edge * 2; i < output.size() - edge * 2; i++) {
+      worst = std::max(worst, static_cast<double>(std::fabs(output[i] - reference[i])));
+    }
+
+    ASSERT_LT(worst, 1e-3) << rate[0] << " -> " << rate[1];
+  }
+}
+
+// splitting the input differently doesn't change the output at all
+TEST(ResamplerTests, BlockSizeIndependent) {
+  std::vector<float> input = MakeSines(44100, 5000);
+  Resampler whole(44100, 48000, 2, 64, 4096);
+  Resampler small(44100, 48000, 2, 64, 4096);
+  Resampler chunked(44100, 48000, 2, 64, 100);
+  std::vector<float> expected = Resample(whole, input, 5000);
+  ASSERT_EQ(Resample(small, input, 7), expected);
+  ASSERT_EQ(Resample(chunked, input, 5000), expected);
+
+  // and a reset starts over from scratch
+  whole.Reset();
+  ASSERT_EQ(Resample(whole, input, 333), expected);
+}
+
+TEST(ResamplerTests, ReducesRatio) {
+  Resampler resampler(44100, 48000, 1);
+  ASSERT_EQ(resampler.GetUpFactor(), 160);
+  ASSERT_EQ(resampler.GetDownFactor(), 147);
+}
+
+TEST(ResamplerTests, ReaderMatchesResampler) {
+  std::vector<float> input = MakeSines(48000, 3000);
+  Resampler resampler(48000, 44100, 2);
+  std::vector<float> expected = Resample(resampler, input, 1024);
+
+  ResamplingReader reader(new MemoryReader(input, 2, 48000), 44100);
+  ASSERT_EQ(reader.GetSampleRate(), 44100);
+  ASSERT_EQ(reader.GetChannelCount(), 2);
+  ASSERT_EQ(reader.GetLength() * 2, expected.size());
+
+  std::vector<float> output;
+  std::vector<float> block(250 * 2);
+  int read;
+  while ((read = reader.GetSamplesInterleaved(250 * 2, block.data())) > 0) {
+    output.insert(output.end(), block.begin(), block.begin() + read * 2);
+  }
+
+  ASSERT_EQ(output, expected);
+
+  reader.Seek(0);
+  ASSERT_EQ(reader.GetSamplesInterleaved(250 * 2, block.data()), 250);
+  for (int i = 0; i < 250 * 2; i++) {
+    ASSERT_EQ(block[i], expected[i]);
+  }
+}
@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "audiohandlers/RingDecoder.hpp"
+#include "audioreaders/VorbisReader.hpp"
+
+#include <memory>
+#include <vector>
+
+const std::string decodefile = "resources/flap_jack_scream.ogg";
+
+// reserve hands out free space in place, and nothing shows up until it's committed
+TEST(RingDecoderTests, ReserveCommit) {
+  AudioBufferSPSC<float> buf(8, 2);   // 256 frames
+  std::vector<float> filler(200 * 2, 0.0f);
+  ASSERT_TRUE(buf.Write(filler.data(), 200 * 2));
+  ASSERT_TRUE(buf.Skip_Chunked(150));
+
+  // 206 frames free, starting at 200 -- wraps after 56
+  WriteRegion<float> region = buf.Reserve(300);
+  ASSERT_EQ(region.frame, 200);
+  ASSERT_EQ(region.length, 206);
+  ASSERT_EQ(region.Length(0), 56);
+  ASSERT_EQ(region.Length(1), 150);
+
+  for (int part = 0; part < 2; part++) {
+    float* data = region.Data(0, part);
+    for (uint32_t i = 0; i < region.Length(part) * 2; i++) {
+      data[i] = static_cast<float>(part * 1000 + i);
+    }
+  }
+
+  ASSERT_EQ(buf.Size(), 100);
+  buf.Commit(100);
+  ASSERT_EQ(buf.Size(), 300);
+  ASSERT_TRUE(buf.Skip_Chunked(50));
+
+  float* out = buf.Read(200);
+  ASSERT_NE(out, nullptr);
+  for (uint32_t i = 0; i < 112; i++) {
+    ASSERT_EQ(out[i], static_cast<float>(i));
+  }
+
+  for (uint32_t i = 112; i < 200; i++) {
+    ASSERT_EQ(out[i], static_cast<float>(1000 + i - 112));
+  }
+}
+
+template <typename S>
+void DecodeMatchesReference(BufferLayout layout) {
+  std::unique_ptr<VorbisReader> reference(VorbisReader::GetVorbisReader(decodefile));
+  std::unique_ptr<VorbisReader> reader(VorbisReader::GetVorbisReader(decodefile));
+  ASSERT_NE(reference, nullptr);
+  int channels = reference->GetChannelCount();
+
+  // small ring, so that decodes wrap around its end
+  AudioBufferSPSC<float, S> buf(12, channels, layout);
+  std::vector<float> expected(1500 * channels);
+
+  uint32_t total = 0;
+  for (;;) {
+    uint32_t decoded = DecodeToRing(reader.get(), &buf, 1500);
+    int ref = reference->GetSamplesInterleaved(1500 * channels, expected.data());
+    ASSERT_EQ(decoded, static_cast<uint32_t>(ref));
+    if (decoded == 0) {
+      break;
+    }
+
+    float* actual = buf.Read(decoded * channels);
+    ASSERT_NE(actual, nullptr);
+    for (uint32_t i = 0; i < decoded * channels; i++) {
+      // int16 storage rounds to the nearest step
+      ASSERT_NEAR(actual[i], expected[i], (std::is_same_v<S, float> ? 1e-6 : 1.0 / 32768)) << "sample " << total * channels + i;
+    }
+
+    total += decoded;
+  }
+
+  ASSERT_EQ(total, 94464);
+}
+
+TEST(RingDecoderTests, DecodeInterleaved) {
+  DecodeMatchesReference<float>(BufferLayout::INTERLEAVED);
+}
+
+TEST(RingDecoderTests, DecodePlanar) {
+  DecodeMatchesReference<float>(BufferLayout::PLANAR);
+}
+
+TEST(RingDecoderTests, DecodeCompact) {
+  DecodeMatchesReference<int16_t>(BufferLayout::INTERLEAVED);
+  DecodeMatchesReference<int16_t>(BufferLayout::PLANAR);
+}
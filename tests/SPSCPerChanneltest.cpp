@@ -6,6 +6,7 @@
 
 #include <chrono>
 #include <thread>
+#include <vector>
 
 TEST(ChannelBufferTests, SimpleReadWriteTest) {
   uint32_t data[1024];
@@ -30,6 +31,201 @@ TEST(ChannelBufferTests, SimpleReadWriteTest) {
   }
 }
 
+// planar buffers should hand back the same frames as interleaved ones, across wraparound
+TEST(ChannelBufferTests, PlanarWrapTest) {
+  const int channels[] = {1, 2, 3, 4};
+  for (int ch : channels) {
+    AudioBufferSPSC<float> buf(8, ch, BufferLayout::PLANAR);   // 256 frames
+    float data[192 * 4];
+    float** result;
+    int frame = 0;
+
+    // offsets 0, 192, 128, 64 ... keep crossing the end of the buffer
+    for (int run = 0; run < 16; run++) {
+      for (int i = 0; i < 192 * ch; i++) {
+        data[i] = static_cast<float>(frame * ch + i);
+      }
+
+      ASSERT_TRUE(buf.Write(data, 192 * ch));
+      ASSERT_EQ(buf.Peek_Chunked(192, &result), 192);
+      for (int i = 0; i < 192; i++) {
+        for (int c = 0; c < ch; c++) {
+          ASSERT_EQ(result[c][i], data[i * ch + c]);
+        }
+      }
+
+      result = buf.Read_Chunked(192);
+      ASSERT_NE(result, nullptr);
+      for (int i = 0; i < 192; i++) {
+        for (int c = 0; c < ch; c++) {
+          ASSERT_EQ(result[c][i], data[i * ch + c]);
+        }
+      }
+
+      frame += 192;
+    }
+  }
+}
+
+// a forced write which runs over a peeked region mustn't change what the peek handed back
+TEST(ChannelBufferTests, PlanarPeekSurvivesForceWrite) {
+  AudioBufferSPSC<float> buf(8, 2, BufferLayout::PLANAR);   // 256 frames
+  std::vector<float> data(512);
+  for (int i = 0; i < 512; i++) {
+    data[i] = static_cast<float>(i);
+  }
+
+  ASSERT_TRUE(buf.Write(data.data(), 512));
+  float** result;
+  ASSERT_EQ(buf.Peek_Chunked(256, &result), 256);
+
+  std::vector<float> other(512, -1.0f);
+  buf.Force_Write(other.data(), 512);
+  for (int i = 0; i < 256; i++) {
+    ASSERT_EQ(result[0][i], data[2 * i]);
+    ASSERT_EQ(result[1][i], data[2 * i + 1]);
+  }
+}
+
+// interleaved reads on a planar buffer should give back exactly what went in
+TEST(ChannelBufferTests, PlanarInterleavedReadTest) {
+  AudioBufferSPSC<float> buf(10, 2, BufferLayout::PLANAR);
+  float data[1536];
+  float output[1536];
+  float* peeked = nullptr;
+
+  for (int run = 0; run < 8; run++) {
+    for (int i = 0; i < 1536; i++) {
+      data[i] = static_cast<float>(run * 1536 + i);
+    }
+
+    ASSERT_TRUE(buf.Write(data, 1536));
+    ASSERT_EQ(buf.Peek(1536, &peeked), 1536);
+    for (int i = 0; i < 1536; i++) {
+      ASSERT_EQ(peeked[i], data[i]);
+    }
+
+    ASSERT_TRUE(buf.ReadToBuffer(768, output, 2));
+    ASSERT_NE(buf.Read(768), nullptr);
+    for (int i = 0; i < 768; i++) {
+      ASSERT_EQ(output[i], data[i]);
+    }
+  }
+}
+
+// frames behind the read head should stay reachable by absolute frame number
+TEST(ChannelBufferTests, HistoryViewTest) {
+  const BufferLayout layouts[] = {BufferLayout::INTERLEAVED, BufferLayout::PLANAR};
+  for (BufferLayout layout : layouts) {
+    AudioBufferSPSC<float> buf(8, 2, layout, 64);   // 256 frames, 64 of which are history
+    float data[512];
+    for (int i = 0; i < 512; i++) {
+      data[i] = static_cast<float>(i);
+    }
+
+    ASSERT_TRUE(buf.Write(data, 512));
+    ASSERT_NE(buf.Read_Chunked(128), nullptr);
+    ASSERT_EQ(buf.GetOldestFrame(), 64);
+    ASSERT_EQ(buf.GetReadFrame(), 128);
+    ASSERT_EQ(buf.GetWriteFrame(), 256);
+
+    // clipped to what's held
+    FrameView<float> view = buf.View_Chunked(0, 300);
+    ASSERT_EQ(view.frame, 64);
+    ASSERT_EQ(view.length, 192);
+    for (uint32_t i = 0; i < view.length; i++) {
+      ASSERT_EQ(view.At(0, i), 2 * (64 + i));
+      ASSERT_EQ(view.At(1, i), 2 * (64 + i) + 1);
+    }
+
+    // history is off limits to the writer
+    ASSERT_EQ(buf.GetMaximumWriteSize(), 128);
+    for (int i = 0; i < 128; i++) {
+      data[i] = static_cast<float>(512 + i);
+    }
+
+    ASSERT_TRUE(buf.Write(data, 128));
+    ASSERT_EQ(buf.GetMaximumWriteSize(), 0);
+
+    // wraps around the end of the buffer
+    view = buf.View_Chunked(200, 200);
+    ASSERT_EQ(view.frame, 200);
+    ASSERT_EQ(view.length, 120);
+    ASSERT_EQ(view.Length(0), 56);
+    ASSERT_EQ(view.Length(1), 64);
+
+    float left[120];
+    view.CopyTo(0, left);
+    for (uint32_t i = 0; i < view.length; i++) {
+      ASSERT_EQ(left[i], 2 * (200 + i));
+      ASSERT_EQ(view.At(1, i), 2 * (200 + i) + 1);
+    }
+
+    // forcing a write drags the history window along with the read head
+    buf.Force_Write(data, 64);
+    ASSERT_EQ(buf.GetReadFrame(), 160);
+    ASSERT_EQ(buf.GetOldestFrame(), 96);
+    ASSERT_FALSE(buf.IsRetained(64));
+    ASSERT_TRUE(buf.IsRetained(96));
+  }
+}
+
+// 16-bit storage should read back as floats, whichever type was written
+TEST(ChannelBufferTests, CompactStorageTest) {
+  const BufferLayout layouts[] = {BufferLayout::INTERLEAVED, BufferLayout::PLANAR};
+  for (BufferLayout layout : layouts) {
+    AudioBufferSPSC<float, int16_t> buf(10, 2, layout);
+    float data[1536];
+    int16_t shorts[1536];
+    float output[1536];
+    float** result;
+
+    for (int run = 0; run < 4; run++) {
+      for (int i = 0; i < 1536; i++) {
+        shorts[i] = static_cast<int16_t>((run * 1536 + i) * 7 - 32768);
+        data[i] = shorts[i] / 32768.0f;
+      }
+
+      ASSERT_TRUE(buf.Write(data, 1536));
+      ASSERT_EQ(buf.Peek_Chunked(768, &result), 768);
+      for (int i = 0; i < 768; i++) {
+        ASSERT_EQ(result[0][i], data[2 * i]);
+        ASSERT_EQ(result[1][i], data[2 * i + 1]);
+      }
+
+      ASSERT_TRUE(buf.ReadToBuffer(768, output, 2));
+      float* rest = buf.Read(768);
+      ASSERT_NE(rest, nullptr);
+      for (int i = 0; i < 768; i++) {
+        ASSERT_EQ(output[i], data[i]);
+        ASSERT_EQ(rest[i], data[768 + i]);
+      }
+
+      // short input goes straight in
+      ASSERT_TRUE(buf.Write(shorts, 1536));
+      FrameView<float, int16_t> view = buf.View_Chunked(buf.GetReadFrame(), 768);
+      ASSERT_EQ(view.length, 768);
+      view.CopyTo(1, output);
+      for (int i = 0; i < 768; i++) {
+        ASSERT_EQ(view.At(0, i), data[2 * i]);
+        ASSERT_EQ(output[i], data[2 * i + 1]);
+      }
+
+      ASSERT_NE(buf.Read_Chunked(768), nullptr);
+    }
+
+    // out of range input saturates
+    float loud[16] = {1.5f, -1.5f, 1.0f, -1.0f};
+    ASSERT_TRUE(buf.Write(loud, 16));
+    float* peeked = nullptr;
+    ASSERT_EQ(buf.Peek(4, &peeked), 4);
+    ASSERT_EQ(peeked[0], 32767 / 32768.0f);
+    ASSERT_EQ(peeked[1], -1.0f);
+    ASSERT_EQ(peeked[2], 32767 / 32768.0f);
+    ASSERT_EQ(peeked[3], -1.0f);
+  }
+}
+
 const static int contents_length = 705600;
 // setting this too much higher breaks the test.
 // it already fucks up in valgrind
@@ -44,6 +240,7 @@ struct BufferPair {
   AudioBufferSPSC<uint32_t>* crit;  // the "critical buffer"
   AudioBufferSPSC<uint32_t>* aux;   // some other buffer
   AudioBufferSPSC<uint32_t>* mono;   // some other buffer
+  AudioBufferSPSC<uint32_t>* planar;  // same as aux, stored per-channel
   hrctp pt; // origin time
 };
 
@@ -64,6 +261,7 @@ void WriteThread(BufferPair* buf, uint32_t contents[]) {
     while (!buf->crit->Write(contents + offset, max_read));
     buf->aux->Write(contents + offset, max_read);
     buf->mono->Write(contents + offset, max_read);
+    buf->planar->Write(contents + offset, max_read);
     offset += max_read;
     std::cout << "offset: " << offset << std::endl;
   }
@@ -165,6 +363,7 @@ TEST(ChannelBufferTests, MultiThreadVoyage) {
   buf.crit = new AudioBufferSPSC<uint32_t>(14, 2);  // 16384 frames in stereo (32768 samples)
   buf.aux = new AudioBufferSPSC<uint32_t>(15, 2);   // 32768 frames in stereo (65536 samples)
   buf.mono = new AudioBufferSPSC<uint32_t>(16, 1);  // 65536 samples in mono
+  buf.planar = new AudioBufferSPSC<uint32_t>(15, 2, BufferLayout::PLANAR);
 
   ASSERT_EQ(buf.crit->Capacity(), 32768);
   ASSERT_EQ(buf.aux->Capacity(), 65536);
@@ -175,14 +374,18 @@ TEST(ChannelBufferTests, MultiThreadVoyage) {
   std::thread reader_one(ReadThread_STEREO, buf.crit, contents, buf.pt, 3);
   // std::thread reader_two(ReadThread_STEREO, buf.aux, contents, buf.pt, 2);
   std::thread reader_mono(ReadThread_MONO, buf.mono, contents, buf.pt, 1);
+  std::thread reader_planar(ReadThread_STEREO, buf.planar, contents, buf.pt, 4);
 
   writer.join();
   reader_one.join();
   // reader_two.join();
   reader_mono.join();
+  reader_planar.join();
 
   delete buf.crit;
   delete buf.aux;
+  delete buf.mono;
+  delete buf.planar;
 }
 
 // next big
@@ -4,6 +4,13 @@
 #include <random>
 
 #include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 class BufferTests : public testing::Test {
  protected:
@@ -147,6 +154,60 @@ TEST_F(BufferTests, RandomReadWrite) {
   }
 }
 
+// syncing to a point behind the read head should leave the buffer alone
+TEST_F(BufferTests, SynchronizeBackwards) {
+  int16_t prepped[1024];
+  for (int16_t i = 0; i < 1024; i++) {
+    prepped[i] = i;
+  }
+
+  ASSERT_TRUE(q->Write(prepped, 1024));
+  q->Synchronize(512);
+  ASSERT_EQ(q->Size(), 512);
+  ASSERT_EQ(q->GetItemsRead(), 512);
+
+  q->Synchronize(256);
+  ASSERT_EQ(q->Size(), 512);
+
+  int16_t* output = nullptr;
+  ASSERT_EQ(q->Peek(1, &output), 1);
+  ASSERT_EQ(output[0], 512);
+
+  // syncing past the end empties the buffer, but doesn't go past the write head
+  q->Synchronize(1ull << 33);
+  ASSERT_TRUE(q->Empty());
+  ASSERT_EQ(q->GetItemsRead(), 1024);
+}
+
+// counters should track failed reads, forced writes and fill levels
+TEST_F(BufferTests, StatsCounters) {
+  int16_t prepped[size];
+  for (int i = 0; i < size; i++) {
+    prepped[i] = static_cast<int16_t>(i);
+  }
+
+  BufferStats stats = q->GetStats();
+  ASSERT_EQ(stats.underruns, 0);
+  ASSERT_EQ(stats.writes, 0);
+
+  ASSERT_EQ(q->Read(16), nullptr);
+  ASSERT_TRUE(q->Write(prepped, 1024));   // empty going in
+  ASSERT_NE(q->Read(512), nullptr);
+  ASSERT_TRUE(q->Write(prepped, 2048));   // 512 going in
+  q->Force_Write(prepped, 2048);          // 512 samples dropped to make room, 2048 going in
+
+  stats = q->GetStats();
+  ASSERT_EQ(stats.underruns, 1);
+  ASSERT_EQ(stats.forced_writes, 1);
+  ASSERT_EQ(stats.dropped_frames, 512);
+  ASSERT_EQ(stats.writes, 3);
+  ASSERT_EQ(stats.high_water, size);
+  ASSERT_EQ(stats.low_water, 512);
+  ASSERT_EQ(stats.fill_histogram[0], 1);
+  ASSERT_EQ(stats.fill_histogram[2], 1);
+  ASSERT_EQ(stats.fill_histogram[8], 1);
+}
+
 // thread functions
 void WriterThread(int16_t* write_contents, AudioBufferSPSC<int16_t>* q) {
   int32_t counter = 0;
@@ -284,6 +345,98 @@ void ReadThread(AudioBufferSPSC<uint32_t>* buf, uint32_t contents[], hrctp time,
   std::cout << "thread is over!" << std::endl;
 }
 
+// every storage policy should behave the same, and hand out aligned memory
+template <typename POLICY>
+void StoragePolicyRoundTrip(int power) {
+  AudioBufferSPSC<float, float, POLICY> buf(power, 2, BufferLayout::PLANAR);
+  uint32_t frames = buf.Capacity() / 2;
+
+  float** planes;
+  ASSERT_EQ(buf.Peek_Chunked(frames, &planes), 0);
+
+  float* data = new float[frames * 2];
+  for (uint32_t i = 0; i < frames * 2; i++) {
+    data[i] = static_cast<float>(i);
+  }
+
+  ASSERT_TRUE(buf.Write(data, frames * 2));
+  ASSERT_EQ(buf.Peek_Chunked(frames, &planes), frames);
+
+  // peeks are copied out, but the copy is aligned like the storage
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(planes[0]) % 64, 0);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(planes[1]) % 64, 0);
+  for (uint32_t i = 0; i < frames; i++) {
+    ASSERT_EQ(planes[0][i], data[2 * i]);
+    ASSERT_EQ(planes[1][i], data[2 * i + 1]);
+  }
+
+  float* interleaved = nullptr;
+  ASSERT_EQ(buf.Peek(64, &interleaved), 64);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(interleaved) % 64, 0);
+
+  delete[] data;
+}
+
+TEST(BufferStorageTests, StoragePolicies) {
+  StoragePolicyRoundTrip<AlignedStorage>(10);
+  StoragePolicyRoundTrip<HugePageStorage>(20);
+  StoragePolicyRoundTrip<SharedStorage>(10);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+// a forked child writes, the parent reads -- the cursors have to be shared along with the samples
+TEST(BufferStorageTests, SharedAcrossFork) {
+  const uint32_t block = 256 * 2;
+  const uint32_t blocks = 256;   // well past the ring's 1024 frames, so it has to wrap
+  AudioBufferSPSC<float, float, SharedStorage> buf(10, 2);
+
+  pid_t child = fork();
+  ASSERT_GE(child, 0);
+  if (child == 0) {
+    std::vector<float> data(block);
+    for (uint32_t b = 0; b < blocks; b++) {
+      for (uint32_t i = 0; i < block; i++) {
+        data[i] = static_cast<float>(b * block + i);
+      }
+
+      while (!buf.Write(data.data(), block)) {
+        std::this_thread::yield();
+      }
+    }
+
+    _exit(0);
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+  uint32_t received = 0;
+  bool matched = true;
+  while (received < blocks * block && std::chrono::steady_clock::now() < deadline) {
+    float* samples = buf.Read(block);
+    if (samples == nullptr) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    for (uint32_t i = 0; i < block; i++) {
+      matched = matched && (samples[i] == static_cast<float>(received + i));
+    }
+
+    received += block;
+  }
+
+  int status = 0;
+  if (received < blocks * block) {
+    kill(child, SIGKILL);
+  }
+
+  waitpid(child, &status, 0);
+  ASSERT_EQ(received, blocks * block);
+  ASSERT_TRUE(matched);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+}
+#endif
+
 // idea for implementation: populate the critical buffer to avoid
 // discrepencies between buffers
 TEST(ThreadBufferTest, MultiThreadVoyage) {
@@ -294,6 +447,8 @@ TEST(ThreadBufferTest, MultiThreadVoyage) {
 
   BufferPair buf;
   buf.crit = new AudioBufferSPSC<uint32_t>(12); // 4096
+  // like the manager's critical buffer: one reader, never force-written -- reads take no lock
+  buf.crit->SetSingleConsumer();
   buf.aux = new AudioBufferSPSC<uint32_t>(13);  // 8192
   buf.pt = std::chrono::high_resolution_clock::now();
 
@@ -0,0 +1,131 @@
+#include "gtest/gtest.h"
+#include "threading/ThreadPolicy.hpp"
+
+#include <thread>
+
+// runs `fn` on a fresh thread, so nothing here sticks to the test's own
+template <typename FUNC>
+static void OnThread(FUNC&& fn) {
+  std::thread thread(fn);
+  thread.join();
+}
+
+TEST(ThreadPolicyTests, Parse) {
+  ThreadPolicy policy;
+  ASSERT_TRUE(ThreadPolicy::Parse("fifo:20@2,3", &policy));
+  ASSERT_EQ(policy.scheduling, SchedulingClass::FIFO);
+  ASSERT_EQ(policy.priority, 20);
+  ASSERT_EQ(policy.cpus, std::vector<int>({ 2, 3 }));
+
+  ASSERT_TRUE(ThreadPolicy::Parse("rr:10@0-2,5", &policy));
+  ASSERT_EQ(policy.scheduling, SchedulingClass::RR);
+  ASSERT_EQ(policy.cpus, std::vector<int>({ 0, 1, 2, 5 }));
+
+  ASSERT_TRUE(ThreadPolicy::Parse("nice:-5", &policy));
+  ASSERT_EQ(policy.scheduling, SchedulingClass::NICE);
+  ASSERT_EQ(policy.priority, -5);
+  ASSERT_TRUE(policy.cpus.empty());
+
+  ASSERT_TRUE(ThreadPolicy::Parse("default@1", &policy));
+  ASSERT_EQ(policy.scheduling, SchedulingClass::DEFAULT);
+  ASSERT_EQ(policy.cpus, std::vector<int>({ 1 }));
+
+  // round trip
+  ASSERT_TRUE(ThreadPolicy::Parse("fifo:20@2,3", &policy));
+  ASSERT_EQ(policy.ToString(), "fifo:20@2,3");
+  ASSERT_TRUE(ThreadPolicy::Parse("default", &policy));
+  ASSERT_EQ(policy.ToString(), "default");
+
+  // malformed leaves the output alone
+  ThreadPolicy before = policy;
+  for (const char* spec : { "", "fast", "fifo", "fifo:0", "rr:100", "nice:20", "nice:x",
+                            "default:3", "nice:1@", "nice:1@3-1", "nice:1@a", "nice:1@1,,2" }) {
+    ASSERT_FALSE(ThreadPolicy::Parse(spec, &policy)) << spec;
+    ASSERT_EQ(policy.ToString(), before.ToString());
+  }
+}
+
+TEST(ThreadPolicyTests, DefaultLeavesThreadAlone) {
+  OnThread([] {
+    ThreadPolicy before = ThreadPolicy::GetCurrent();
+    ThreadReport report = ThreadPolicy().Apply("default");
+    ASSERT_FALSE(report.degraded);
+    ASSERT_EQ(report.effective.ToString(), before.ToString());
+  });
+}
+
+// raising a nice level needs no privileges
+TEST(ThreadPolicyTests, NiceApplies) {
+  OnThread([] {
+    ThreadPolicy policy;
+    ASSERT_TRUE(ThreadPolicy::Parse("nice:5", &policy));
+    ThreadReport report = policy.Apply("nice");
+#if defined(__linux__)
+    ASSERT_FALSE(report.degraded) << report.note;
+    ASSERT_EQ(report.effective.scheduling, SchedulingClass::NICE);
+    ASSERT_EQ(report.effective.priority, 5);
+    ASSERT_EQ(ThreadPolicy::GetCurrent().priority, 5);
+#endif
+  });
+}
+
+// real-time either applies, or falls back with a note -- never fails outright
+TEST(ThreadPolicyTests, RealtimeDegradesGracefully) {
+  OnThread([] {
+    ThreadPolicy policy;
+    ASSERT_TRUE(ThreadPolicy::Parse("fifo:10", &policy));
+    policy.fallback_nice = 3;
+    ThreadReport report = policy.Apply("fifo");
+    if (report.degraded) {
+      ASSERT_FALSE(report.note.empty());
+      ASSERT_NE(report.effective.scheduling, SchedulingClass::FIFO);
+    } else {
+      ASSERT_EQ(report.effective.scheduling, SchedulingClass::FIFO);
+      ASSERT_EQ(report.effective.priority, 10);
+    }
+  });
+}
+
+TEST(ThreadPolicyTests, Affinity) {
+  OnThread([] {
+    ThreadPolicy policy;
+    ASSERT_TRUE(ThreadPolicy::Parse("default@0", &policy));
+    ThreadReport report = policy.Apply("pinned");
+#if defined(__linux__)
+    // cpu 0 may be outside our cpuset -- then it's dropped, and said so
+    if (!report.degraded) {
+      ASSERT_TRUE(report.effective.cpus.empty() || report.effective.cpus == std::vector<int>({ 0 }));
+    } else {
+      ASSERT_NE(report.note.find("unavailable"), std::string::npos);
+    }
+#endif
+  });
+
+  // a cpu nobody has is dropped, and the rest of the policy still applies
+  OnThread([] {
+    ThreadPolicy policy;
+    ASSERT_TRUE(ThreadPolicy::Parse("nice:2@100000", &policy));
+    ThreadReport report = policy.Apply("nowhere");
+    ASSERT_TRUE(report.degraded);
+#if defined(__linux__)
+    ASSERT_NE(report.note.find("cpus 100000 unavailable"), std::string::npos) << report.note;
+    ASSERT_TRUE(report.effective.cpus.empty());
+    ASSERT_EQ(report.effective.priority, 2);
+#endif
+  });
+}
+
+TEST(ThreadPolicyTests, Reports) {
+  size_t before = ThreadPolicy::GetReports().size();
+  OnThread([] {
+    ThreadPolicy policy;
+    ThreadPolicy::Parse("nice:1", &policy);
+    policy.Apply("reported");
+  });
+
+  std::vector<ThreadReport> reports = ThreadPolicy::GetReports();
+  ASSERT_EQ(reports.size(), before + 1);
+  ASSERT_EQ(reports.back().name, "reported");
+  ASSERT_EQ(reports.back().requested.ToString(), "nice:1");
+  ASSERT_EQ(reports.back().ToString().rfind("reported: ", 0), 0);
+}